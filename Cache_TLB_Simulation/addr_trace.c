@@ -0,0 +1,585 @@
+/*!
+ * \file addr_trace.c
+ * \brief Implementation of the trace readers (mmap and double-buffered
+ *        streaming) and writers.
+ */
+
+#include "addr_trace.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*! \brief Magic of TRACE_VTR files. */
+static const unsigned char vtr_magic[4] = { 'C', 'T', 'V', 'T' };
+
+/*! \brief Version written in TRACE_VTR headers. */
+#define VTR_VERSION 1
+
+/*! \brief TRACE_VTR header flag: every access carries a PC varint. */
+#define VTR_HAS_PC 1
+
+/*! \brief Bytes before each streaming chunk, where the incomplete record of the previous chunk is copied. */
+#define CARRY TRACE_MAX_LINE
+
+/*! \brief Mapped bytes already decoded are dropped from memory in steps of this size. */
+#define RELEASE_STEP (64u << 20)
+
+struct addr_trace {
+    int format;
+    int has_pc;
+    int mapped;
+    int skip_line;               /*!< Discarding the rest of an overlong text line */
+    uint64_t bytes;
+    uint64_t errors;
+    uint64_t prev_addr, prev_pc; /*!< Delta bases of TRACE_VTR */
+
+    /* Window being decoded; final is set when no data follows it. */
+    const unsigned char *p, *end;
+    int final;
+
+    /* mmap reader */
+    unsigned char *map;
+    size_t map_len, released;
+
+    /* streaming reader */
+    int fd;
+    int thread_running;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    unsigned char *buf[2];
+    size_t len[2];
+    int full[2], last[2];
+    int cur, stop;
+};
+
+struct trace_writer {
+    FILE *f;
+    int format;
+    int has_pc;
+    uint64_t prev_addr, prev_pc;
+};
+
+/* ----------------------------------------------------------------
+   Formats
+   ---------------------------------------------------------------- */
+
+int trace_parse_format(const char *name) {
+    if (strcmp(name, "auto") == 0) return TRACE_AUTO;
+    if (strcmp(name, "text") == 0) return TRACE_TEXT;
+    if (strcmp(name, "bin") == 0) return TRACE_BIN;
+    if (strcmp(name, "vtr") == 0) return TRACE_VTR;
+    return -2;
+}
+
+const char *trace_format_name(int format) {
+    switch (format) {
+    case TRACE_TEXT: return "text";
+    case TRACE_BIN:  return "bin";
+    case TRACE_VTR:  return "vtr";
+    default:         return "auto";
+    }
+}
+
+static inline uint64_t zigzag(uint64_t delta) {
+    return (delta << 1) ^ (uint64_t)((int64_t)delta >> 63);
+}
+
+static inline uint64_t unzigzag(uint64_t z) {
+    return (z >> 1) ^ (uint64_t)-(int64_t)(z & 1);
+}
+
+/*!
+ * \brief Decodes one LEB128 varint of up to 65 bits from [*s, e); bit 64 goes to *top if not NULL.
+ * \return 0 on success, -1 if the varint is incomplete or longer than 10 bytes.
+ */
+static inline int get_varint(const unsigned char **s, const unsigned char *e, uint64_t *v, unsigned *top) {
+    const unsigned char *p = *s;
+    uint64_t x = 0;
+    for (int shift = 0; p < e && shift < 70; shift += 7) {
+        unsigned char c = *p++;
+        x |= (uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            *s = p;
+            *v = x;
+            if (top) {
+                *top = shift == 63 ? (c >> 1) & 1 : 0;
+            }
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/*!
+ * \brief Parses a decimal or 0x-prefixed hexadecimal number from [*s, e).
+ * \return 0 on success, -1 if there is no digit.
+ */
+static int parse_u64(const unsigned char **s, const unsigned char *e, uint64_t *v) {
+    const unsigned char *p = *s;
+    uint64_t x = 0;
+    int base = 10;
+
+    if (e - p > 2 && p[0] == '0' && (p[1] | 0x20) == 'x') {
+        base = 16;
+        p += 2;
+    }
+    const unsigned char *digits = p;
+    for (; p < e; p++) {
+        int c = *p, d;
+        if (c >= '0' && c <= '9') {
+            d = c - '0';
+        } else if (base == 16 && (c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+            d = (c | 0x20) - 'a' + 10;
+        } else {
+            break;
+        }
+        x = x * base + d;
+    }
+    if (p == digits) {
+        return -1;
+    }
+    *s = p;
+    *v = x;
+    return 0;
+}
+
+static inline const unsigned char *skip_blanks(const unsigned char *p, const unsigned char *e) {
+    while (p < e && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    return p;
+}
+
+/*!
+ * \brief Parses one text line [p, e).
+ * \return 1 for an access, 0 for a blank or comment line, -1 if malformed.
+ */
+static int parse_line(const unsigned char *p, const unsigned char *e, mem_access *a) {
+    p = skip_blanks(p, e);
+    if (p == e || *p == '#') {
+        return 0;
+    }
+    a->write = 0;
+    a->pc = 0;
+    if (e - p > 1 && (p[1] == ' ' || p[1] == '\t')) {
+        /* Only R/W/L/S are opcodes: "5 6" is address 5 with PC 6. */
+        const int op = *p | 0x20;
+        if (op == 'w' || op == 's' || op == 'r' || op == 'l') {
+            a->write = op == 'w' || op == 's';
+            p = skip_blanks(p + 1, e);
+        }
+    }
+    if (parse_u64(&p, e, &a->addr) != 0) {
+        return -1;
+    }
+    p = skip_blanks(p, e);
+    if (p < e && parse_u64(&p, e, &a->pc) != 0) {
+        return -1;
+    }
+    return skip_blanks(p, e) == e ? 1 : -1;
+}
+
+/* ----------------------------------------------------------------
+   Decoders: consume complete records of the current window
+   ---------------------------------------------------------------- */
+
+static size_t decode_text(addr_trace *t, mem_access *out, size_t max) {
+    size_t n = 0;
+
+    while (n < max && t->p < t->end) {
+        const unsigned char *nl = memchr(t->p, '\n', (size_t)(t->end - t->p));
+        if (t->skip_line) {
+            t->p = nl ? nl + 1 : t->end;
+            t->skip_line = !nl;
+            continue;
+        }
+        if (!nl) {
+            if (!t->final) {
+                if (t->end - t->p >= TRACE_MAX_LINE) {
+                    t->errors++;
+                    t->skip_line = 1;
+                    t->p = t->end;
+                }
+                break;
+            }
+            nl = t->end;
+        }
+        int r = parse_line(t->p, nl, &out[n]);
+        if (r > 0) {
+            n++;
+        } else if (r < 0) {
+            t->errors++;
+        }
+        t->p = nl < t->end ? nl + 1 : nl;
+    }
+    return n;
+}
+
+static size_t decode_bin(addr_trace *t, mem_access *out, size_t max) {
+    size_t n = 0;
+
+    while (n < max && t->end - t->p >= 8) {
+        uint64_t a;
+        memcpy(&a, t->p, 8);
+        out[n].addr = a;
+        out[n].pc = 0;
+        out[n].write = 0;
+        n++;
+        t->p += 8;
+    }
+    if (t->final && t->p < t->end && t->end - t->p < 8) {
+        t->errors++;
+        t->p = t->end;
+    }
+    return n;
+}
+
+static size_t decode_vtr(addr_trace *t, mem_access *out, size_t max) {
+    size_t n = 0;
+
+    while (n < max && t->p < t->end) {
+        const unsigned char *p = t->p;
+        uint64_t v, pc = 0;
+        unsigned top;
+        if (get_varint(&p, t->end, &v, &top) != 0 || (t->has_pc && get_varint(&p, t->end, &pc, NULL) != 0)) {
+            if (t->final || t->end - t->p > 20) {
+                t->errors++;
+                t->p = t->end;
+            }
+            break;
+        }
+        t->prev_addr += unzigzag(v >> 1 | (uint64_t)top << 63);
+        out[n].addr = t->prev_addr;
+        out[n].write = (int)(v & 1);
+        if (t->has_pc) {
+            t->prev_pc += unzigzag(pc);
+        }
+        out[n].pc = t->prev_pc;
+        n++;
+        t->p = p;
+    }
+    return n;
+}
+
+/* ----------------------------------------------------------------
+   Streaming reader
+   ---------------------------------------------------------------- */
+
+/*!
+ * \brief Helper thread: fills the chunks alternately until the end of the input.
+ */
+static void *stream_fill(void *arg) {
+    addr_trace *t = arg;
+
+    for (int i = 0;; i ^= 1) {
+        pthread_mutex_lock(&t->lock);
+        while (t->full[i] && !t->stop) {
+            pthread_cond_wait(&t->cond, &t->lock);
+        }
+        int stop = t->stop;
+        pthread_mutex_unlock(&t->lock);
+        if (stop) {
+            break;
+        }
+
+        size_t got = 0;
+        int last = 0;
+        while (got < TRACE_CHUNK) {
+            ssize_t r = read(t->fd, t->buf[i] + CARRY + got, TRACE_CHUNK - got);
+            if (r < 0 && errno == EINTR) {
+                continue;
+            }
+            if (r <= 0) {
+                if (r < 0) {
+                    fprintf(stderr, "Trace read error: %s\n", strerror(errno));
+                }
+                last = 1;
+                break;
+            }
+            got += (size_t)r;
+        }
+
+        pthread_mutex_lock(&t->lock);
+        t->len[i] = got;
+        t->last[i] = last;
+        t->full[i] = 1;
+        pthread_cond_broadcast(&t->cond);
+        pthread_mutex_unlock(&t->lock);
+        if (last) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/*!
+ * \brief Moves to the next chunk, carrying the incomplete record left in the current one.
+ * \return 0 on success, -1 at the end of the input.
+ */
+static int next_window(addr_trace *t) {
+    if (t->final || t->mapped) {
+        return -1;
+    }
+    const int next = t->cur < 0 ? 0 : t->cur ^ 1;
+    size_t left = (size_t)(t->end - t->p);
+
+    pthread_mutex_lock(&t->lock);
+    while (!t->full[next]) {
+        pthread_cond_wait(&t->cond, &t->lock);
+    }
+    pthread_mutex_unlock(&t->lock);
+
+    if (left > CARRY) {
+        t->errors++;
+        left = 0;
+    }
+    unsigned char *start = t->buf[next] + CARRY - left;
+    if (left > 0) {
+        memmove(start, t->p, left);
+    }
+    if (t->cur >= 0) {
+        pthread_mutex_lock(&t->lock);
+        t->full[t->cur] = 0;
+        pthread_cond_broadcast(&t->cond);
+        pthread_mutex_unlock(&t->lock);
+    }
+    t->cur = next;
+    t->p = start;
+    t->end = t->buf[next] + CARRY + t->len[next];
+    t->final = t->last[next];
+    return 0;
+}
+
+static int stream_start(addr_trace *t) {
+    t->buf[0] = malloc(CARRY + TRACE_CHUNK);
+    t->buf[1] = malloc(CARRY + TRACE_CHUNK);
+    if (!t->buf[0] || !t->buf[1]) {
+        return -1;
+    }
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->cond, NULL);
+    t->cur = -1;
+    if (pthread_create(&t->thread, NULL, stream_fill, t) != 0) {
+        return -1;
+    }
+    t->thread_running = 1;
+    return next_window(t);
+}
+
+/* ----------------------------------------------------------------
+   Input traces
+   ---------------------------------------------------------------- */
+
+static int has_suffix(const char *path, const char *suffix) {
+    size_t lp = strlen(path), ls = strlen(suffix);
+    return lp >= ls && strcmp(path + lp - ls, suffix) == 0;
+}
+
+addr_trace *addr_trace_open(const char *path, int format, int mode) {
+    addr_trace *t = calloc(1, sizeof(*t));
+    struct stat st;
+
+    if (!t) {
+        return NULL;
+    }
+    t->fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY);
+    if (t->fd < 0 || fstat(t->fd, &st) != 0) {
+        fprintf(stderr, "Cannot open trace %s: %s\n", path, strerror(errno));
+        free(t);
+        return NULL;
+    }
+
+    if (mode == TRACE_MMAP && t->fd != STDIN_FILENO && S_ISREG(st.st_mode)) {
+        t->mapped = 1;
+        t->final = 1;
+        t->map_len = (size_t)st.st_size;
+        if (t->map_len > 0) {
+            t->map = mmap(NULL, t->map_len, PROT_READ, MAP_PRIVATE, t->fd, 0);
+            if (t->map == MAP_FAILED) {
+                fprintf(stderr, "Cannot map trace %s: %s\n", path, strerror(errno));
+                t->map = NULL;
+                addr_trace_close(t);
+                return NULL;
+            }
+            madvise(t->map, t->map_len, MADV_SEQUENTIAL);
+        }
+        t->p = t->map;
+        t->end = t->map + t->map_len;
+    } else if (stream_start(t) != 0) {
+        fprintf(stderr, "Cannot start the trace reader for %s\n", path);
+        addr_trace_close(t);
+        return NULL;
+    }
+
+    const int magic = t->end - t->p >= 8 && memcmp(t->p, vtr_magic, 4) == 0;
+    if (format == TRACE_AUTO) {
+        format = magic ? TRACE_VTR : (has_suffix(path, ".bin") || has_suffix(path, ".u64")) ? TRACE_BIN : TRACE_TEXT;
+    }
+    t->format = format;
+    if (format == TRACE_VTR) {
+        if (!magic || t->p[4] != VTR_VERSION) {
+            fprintf(stderr, "%s is not a version %d vtr trace\n", path, VTR_VERSION);
+            addr_trace_close(t);
+            return NULL;
+        }
+        t->has_pc = t->p[5] & VTR_HAS_PC;
+        t->p += 8;
+        t->bytes = 8;
+    } else {
+        t->has_pc = format == TRACE_TEXT;
+    }
+    return t;
+}
+
+size_t addr_trace_read(addr_trace *t, mem_access *buf, size_t max) {
+    size_t n = 0;
+
+    while (n < max) {
+        const unsigned char *before = t->p;
+        switch (t->format) {
+        case TRACE_BIN: n += decode_bin(t, buf + n, max - n); break;
+        case TRACE_VTR: n += decode_vtr(t, buf + n, max - n); break;
+        default:        n += decode_text(t, buf + n, max - n); break;
+        }
+        t->bytes += (uint64_t)(t->p - before);
+        if (n == max || next_window(t) != 0) {
+            break;
+        }
+    }
+    if (t->mapped && (size_t)(t->p - t->map) >= t->released + 2 * RELEASE_STEP) {
+        /* Decoded pages are clean file pages: drop them so RSS stays bounded on huge traces. */
+        madvise(t->map + t->released, RELEASE_STEP, MADV_DONTNEED);
+        t->released += RELEASE_STEP;
+    }
+    return n;
+}
+
+int addr_trace_format(const addr_trace *t) {
+    return t->format;
+}
+
+int addr_trace_has_pc(const addr_trace *t) {
+    return t->has_pc;
+}
+
+uint64_t addr_trace_bytes(const addr_trace *t) {
+    return t->bytes;
+}
+
+uint64_t addr_trace_errors(const addr_trace *t) {
+    return t->errors;
+}
+
+int addr_trace_mapped(const addr_trace *t) {
+    return t->mapped;
+}
+
+void addr_trace_close(addr_trace *t) {
+    if (!t) {
+        return;
+    }
+    if (t->thread_running) {
+        pthread_mutex_lock(&t->lock);
+        t->stop = 1;
+        pthread_cond_broadcast(&t->cond);
+        pthread_mutex_unlock(&t->lock);
+        if (!t->final) {
+            pthread_cancel(t->thread); /* may be blocked in read() on a pipe */
+        }
+        pthread_join(t->thread, NULL);
+    }
+    if (t->map) {
+        munmap(t->map, t->map_len);
+    }
+    if (t->fd > STDIN_FILENO) {
+        close(t->fd);
+    }
+    free(t->buf[0]);
+    free(t->buf[1]);
+    free(t);
+}
+
+/* ----------------------------------------------------------------
+   Output traces
+   ---------------------------------------------------------------- */
+
+/*!
+ * \brief Writes the LEB128 varint of the 65-bit value \p top:\p v.
+ */
+static int put_varint(FILE *f, uint64_t v, unsigned top) {
+    unsigned char b[10];
+    int n = 0;
+    do {
+        b[n] = v & 0x7f;
+        v = v >> 7 | (uint64_t)top << 57;
+        top = 0;
+        if (v) b[n] |= 0x80;
+        n++;
+    } while (v);
+    return fwrite(b, 1, (size_t)n, f) == (size_t)n ? 0 : -1;
+}
+
+trace_writer *trace_writer_open(const char *path, int format, int has_pc) {
+    trace_writer *w = calloc(1, sizeof(*w));
+
+    if (!w) {
+        return NULL;
+    }
+    w->format = format;
+    w->has_pc = has_pc && format != TRACE_BIN;
+    w->f = strcmp(path, "-") == 0 ? stdout : fopen(path, format == TRACE_TEXT ? "w" : "wb");
+    if (!w->f) {
+        fprintf(stderr, "Cannot create trace %s: %s\n", path, strerror(errno));
+        free(w);
+        return NULL;
+    }
+    setvbuf(w->f, NULL, _IOFBF, 1 << 20);
+    if (format == TRACE_VTR) {
+        unsigned char header[8] = { 'C', 'T', 'V', 'T', VTR_VERSION, w->has_pc ? VTR_HAS_PC : 0, 0, 0 };
+        fwrite(header, 1, sizeof(header), w->f);
+    }
+    return w;
+}
+
+int trace_writer_put(trace_writer *w, const mem_access *a) {
+    switch (w->format) {
+    case TRACE_BIN:
+        return fwrite(&a->addr, 8, 1, w->f) == 1 ? 0 : -1;
+    case TRACE_VTR: {
+        /* The shifted delta needs 65 bits when the address jumps across half the space. */
+        uint64_t z = zigzag(a->addr - w->prev_addr);
+        w->prev_addr = a->addr;
+        if (put_varint(w->f, z << 1 | (a->write != 0), (unsigned)(z >> 63)) != 0) {
+            return -1;
+        }
+        if (w->has_pc) {
+            uint64_t pc = zigzag(a->pc - w->prev_pc);
+            w->prev_pc = a->pc;
+            return put_varint(w->f, pc, 0);
+        }
+        return 0;
+    }
+    default:
+        if (w->has_pc && a->pc) {
+            return fprintf(w->f, "%c 0x%llx 0x%llx\n", a->write ? 'W' : 'R', (unsigned long long)a->addr,
+                           (unsigned long long)a->pc) > 0 ? 0 : -1;
+        }
+        return fprintf(w->f, "%c 0x%llx\n", a->write ? 'W' : 'R', (unsigned long long)a->addr) > 0 ? 0 : -1;
+    }
+}
+
+int trace_writer_close(trace_writer *w) {
+    int err = ferror(w->f);
+    if (w->f == stdout) {
+        err |= fflush(w->f);
+    } else {
+        err |= fclose(w->f);
+    }
+    free(w);
+    return err ? -1 : 0;
+}
@@ -0,0 +1,150 @@
+/*!
+ * \file addr_trace.h
+ * \brief Readers and writers of memory address traces.
+ *
+ * Three formats are supported:
+ *  - TRACE_TEXT: one access per line, "[R|W] <addr> [<pc>]", numbers in
+ *    decimal or 0x-prefixed hex; blank lines and lines starting with '#'
+ *    are ignored.
+ *  - TRACE_BIN: raw little-endian u64 addresses (all reads, no PC).
+ *  - TRACE_VTR: compact trace, an 8-byte header ("CTVT", version, flags)
+ *    followed by one varint per access holding the zigzag-encoded delta to
+ *    the previous address shifted left once with the write flag in bit 0
+ *    (a 65-bit value, so its tenth byte may carry two bits),
+ *    plus a second varint with the PC delta if the header says so.
+ *    Sequential and strided streams take one or two bytes per access.
+ *
+ * Regular files are memory-mapped and decoded in place. Pipes (and any file
+ * with TRACE_STREAM) go through a double-buffered reader: a helper thread
+ * fills one chunk while the caller decodes the other. Neither path ever holds
+ * more than a few chunks of the trace in memory.
+ */
+
+#ifndef ADDR_TRACE_H
+#define ADDR_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*! \brief Bytes per chunk of the streaming reader. */
+#ifndef TRACE_CHUNK
+#define TRACE_CHUNK (4u << 20)
+#endif
+
+/*! \brief Longest text line accepted (longer lines are counted as malformed). */
+#define TRACE_MAX_LINE 256
+
+/*! \brief Default number of accesses decoded per addr_trace_read() call by the drivers. */
+#define TRACE_BATCH 4096
+
+/*!
+ * \brief Trace encodings.
+ */
+typedef enum {
+    TRACE_AUTO = -1, /*!< Detect: VTR by its header, BIN by a .bin/.u64 suffix, TEXT otherwise */
+    TRACE_TEXT = 0,
+    TRACE_BIN = 1,
+    TRACE_VTR = 2
+} trace_format;
+
+/*!
+ * \brief How the input is read.
+ */
+typedef enum {
+    TRACE_MMAP = 0,  /*!< mmap() regular files, stream anything else */
+    TRACE_STREAM = 1 /*!< Always use the double-buffered reader */
+} trace_mode;
+
+/*!
+ * \brief One memory access.
+ */
+typedef struct {
+    uint64_t addr; /*!< Byte address */
+    uint64_t pc;   /*!< Address of the instruction, 0 if the trace has none */
+    int write;     /*!< 1 for a store, 0 for a load */
+} mem_access;
+
+/*! \brief Open input trace (opaque). */
+typedef struct addr_trace addr_trace;
+
+/*! \brief Open output trace (opaque). */
+typedef struct trace_writer trace_writer;
+
+/*!
+ * \brief Parses "text", "bin", "vtr" or "auto".
+ * \return The trace_format, or -2 if unknown.
+ */
+int trace_parse_format(const char *name);
+
+/*!
+ * \brief Name of a trace_format.
+ */
+const char *trace_format_name(int format);
+
+/*!
+ * \brief Opens a trace.
+ * \param path File name, or "-" for stdin (always streamed).
+ * \param format A trace_format (TRACE_AUTO to detect it).
+ * \param mode A trace_mode.
+ * \return The trace, or NULL with a message on stderr.
+ */
+addr_trace *addr_trace_open(const char *path, int format, int mode);
+
+/*!
+ * \brief Decodes up to \p max accesses into \p buf.
+ * \return The number of accesses decoded, 0 at the end of the trace.
+ */
+size_t addr_trace_read(addr_trace *t, mem_access *buf, size_t max);
+
+/*!
+ * \brief Format of an open trace (after detection).
+ */
+int addr_trace_format(const addr_trace *t);
+
+/*!
+ * \brief 1 if the trace carries PCs.
+ */
+int addr_trace_has_pc(const addr_trace *t);
+
+/*!
+ * \brief Bytes of the trace decoded so far.
+ */
+uint64_t addr_trace_bytes(const addr_trace *t);
+
+/*!
+ * \brief Malformed text lines or truncated records skipped so far.
+ */
+uint64_t addr_trace_errors(const addr_trace *t);
+
+/*!
+ * \brief 1 if the trace is memory-mapped, 0 if streamed.
+ */
+int addr_trace_mapped(const addr_trace *t);
+
+/*!
+ * \brief Closes the trace and releases its buffers.
+ */
+void addr_trace_close(addr_trace *t);
+
+/*!
+ * \brief Creates an output trace.
+ * \param path File name, or "-" for stdout.
+ * \param format TRACE_TEXT, TRACE_BIN or TRACE_VTR.
+ * \param has_pc Whether PCs are written (TEXT and VTR only).
+ * \return The writer, or NULL with a message on stderr.
+ */
+trace_writer *trace_writer_open(const char *path, int format, int has_pc);
+
+/*!
+ * \brief Appends one access.
+ * \return 0 on success, -1 on a write error or an address delta that does not fit in 62 bits (VTR).
+ */
+int trace_writer_put(trace_writer *w, const mem_access *a);
+
+/*!
+ * \brief Flushes and closes the output trace.
+ * \return 0 on success, -1 on a write error.
+ */
+int trace_writer_close(trace_writer *w);
+
+#endif
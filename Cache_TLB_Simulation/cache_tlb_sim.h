@@ -2,81 +2,186 @@
  * \file cache_tlb_sim.h
  * \brief Header for cache and TLB simulation routines.
  *
- * This file contains global variables and function prototypes
- * for simulating a data cache (with a given associativity, line size,
- * etc.) and a TLB (with a given number of entries, associativity, page size).
+ * This file contains the cache object, which simulates a data cache
+ * (with a given associativity, line size, etc.) or a TLB (with a given
+ * number of entries, associativity, page size), and the global variables
+ * and functions of the original interface, which drive one default data
+ * cache and one default TLB.
  */
 
 #ifndef CACHE_TLB_SIM_H
 #define CACHE_TLB_SIM_H
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
 
 /* ----------------------------------------------------------------
-   Data Cache Definitions
+   Cache Objects
    ---------------------------------------------------------------- */
 
-/*! \brief Maximum associativity for data cache. */
-#define mway    4
+/*! \brief Alignment of the tag and recency arrays (one cache line). */
+#define CACHE_ALIGN 64
 
-/*! \brief Maximum number of sets for data cache. */
-#define mnsets  1024
+/*! \brief Tag of an empty way. */
+#define CACHE_INVALID (~(uint64_t)0)
 
-/* ----------------------------------------------------------------
-   TLB Definitions
-   ---------------------------------------------------------------- */
+/*!
+ * \brief Default page size in bytes for TLB simulation.
+ *        Used to divide addresses into pageNumber + offset.
+ */
+#define pagesize 1024
 
-/*! \brief Maximum associativity for TLB. */
-#define mtway   4
+/*! \brief Maximum associativity (recency ranks are 16-bit). */
+#define CACHE_MAX_WAYS 65536
 
-/*! \brief Maximum number of sets for TLB. */
-#define mtnsets 32
+/*! \brief Replacement policies (see replacement.h). */
+typedef enum {
+    REPL_LRU = 0,
+    REPL_FIFO,
+    REPL_RANDOM,
+    REPL_PLRU,
+    REPL_SRRIP,
+    REPL_BRRIP,
+    REPL_DRRIP,
+    REPL_OPT,
+    REPL_COUNT
+} repl_policy;
+
+struct repl_ops;
 
 /*!
- * \brief Page size in bytes for TLB simulation.
- *        Used to divide addresses into pageNumber + offset.
+ * \brief One set-associative LRU cache. A TLB is the same object with
+ *        the page size as line size (see tlb_create()).
+ *
+ * Tags and recency are separate arrays (structure of arrays), sized from
+ * the geometry at creation and aligned to CACHE_ALIGN, so objects used by
+ * different threads share no line. The recency of a set is the LRU rank
+ * of each way (0: most recent, way-1: least recent, empty ways always at
+ * the bottom), so it never overflows however long the trace; other
+ * replacement policies reuse the same array for their own state (see
+ * cache_set_policy()). Line and set
+ * numbers use shifts and masks when the line size and the number of sets
+ * are powers of two, and tags are matched 4 ways at a time with AVX2 when
+ * the CPU has it.
  */
-#define pagesize 1024
+typedef struct {
+    long size;          /*!< Bytes (entries * page size for a TLB) */
+    int line;           /*!< Bytes per line (page size for a TLB) */
+    int way;            /*!< Associativity */
+    int nsets;          /*!< size / (way * line) */
+    int line_shift;     /*!< log2(line), or -1 if line is not a power of two */
+    int pow2_sets;      /*!< 1 if nsets is a power of two (set = line & (nsets - 1)) */
+    int simd;           /*!< 1 to match tags with AVX2 (set by cache_create() from the CPU) */
+    uint64_t *tags;     /*!< [nsets][way] line numbers, CACHE_INVALID if empty */
+    uint16_t *rank;     /*!< [nsets][way] LRU rank (or policy state) of each way */
+    int policy;         /*!< repl_policy */
+    const struct repl_ops *ops;
+    uint64_t *next;     /*!< [nsets][way] next use of each line (OPT only) */
+    uint64_t next_use;  /*!< Next use of the access being looked up (OPT only) */
+    uint64_t rng;       /*!< State of the random policies */
+    int psel;           /*!< DRRIP selection counter */
+    uint64_t accesses;  /*!< Lookups through cache_lookup() */
+    uint64_t misses;    /*!< Misses of cache_lookup() */
+} cache_sim;
 
 /*!
- * \brief Global counter that increments on each memory access.
+ * \brief Creates an empty cache of \p size bytes, \p line bytes per line and \p way ways.
+ * \return The cache, or NULL if the geometry is invalid or out of memory.
  */
-extern int am;
+cache_sim *cache_create(long size, int line, int way);
 
 /*!
- * \brief Global counter for data cache misses.
+ * \brief Switches \p c to \p policy (a repl_policy) and empties it.
+ * \return 0 on success, -1 if the policy does not fit the geometry (plru needs
+ *         power-of-two ways) or out of memory.
  */
-extern int dc;
+int cache_set_policy(cache_sim *c, int policy);
 
 /*!
- * \brief Global counter for TLB misses.
+ * \brief Creates an empty TLB of \p entries entries, \p way ways and \p page bytes per page.
+ */
+cache_sim *tlb_create(int entries, int way, int page);
+
+/*!
+ * \brief Releases a cache (NULL is ignored).
+ */
+void cache_destroy(cache_sim *c);
+
+/*!
+ * \brief Empties a cache and clears its counters.
  */
-extern int dtlb;
+void cache_reset(cache_sim *c);
 
 /*!
- * \brief Data cache tag store.
- *        ETIQ[index][set] = tag.
+ * \brief Line number of \p addr.
  */
-extern int ETIQ[mnsets][mway];
+static inline uint64_t cache_line_of(const cache_sim *c, uint64_t addr) {
+    return c->line_shift >= 0 ? addr >> c->line_shift : addr / (uint64_t)c->line;
+}
 
 /*!
- * \brief Data cache LRU store.
- *        LRU[index][set] = recency timestamp.
+ * \brief Index in the tag store of the first way of the set of line \p ln.
+ */
+static inline long cache_set_base(const cache_sim *c, uint64_t ln) {
+    uint64_t set = c->pow2_sets ? ln & (uint64_t)(c->nsets - 1) : ln % (uint64_t)c->nsets;
+    return (long)set * c->way;
+}
+
+/*!
+ * \brief Looks up \p addr and fills it on a miss, evicting the LRU way.
+ * \return 1 if miss, 0 if hit.
  */
-extern int LRU[mnsets][mway];
+int cache_lookup(cache_sim *c, uint64_t addr);
 
 /*!
- * \brief TLB tag store.
- *        tETIQ[index][set] = TLB tag.
+ * \brief Index in the tag store of the line holding \p addr, or -1. Does not update recency.
  */
-extern int tETIQ[mtnsets][mtway];
+long cache_find(const cache_sim *c, uint64_t addr);
 
 /*!
- * \brief TLB LRU store.
- *        tLRU[index][set] = recency timestamp.
+ * \brief Marks way \p k as most recently used.
  */
-extern int tLRU[mtnsets][mtway];
+void cache_touch(cache_sim *c, long k);
+
+/*!
+ * \brief Places the line of \p addr (known to be absent), evicting an empty way or the LRU one.
+ * \param evicted Receives the line number evicted, or CACHE_INVALID.
+ * \return Its index in the tag store.
+ */
+long cache_fill(cache_sim *c, uint64_t addr, uint64_t *evicted);
+
+/*!
+ * \brief Empties way \p k (it becomes the next victim of its set).
+ */
+void cache_invalidate(cache_sim *c, long k);
+
+/*!
+ * \brief Measures cache_lookup() throughput on a synthetic stream of \p n accesses
+ *        (sequential sweeps mixed with random accesses) for a few geometries, with the
+ *        scalar and, when available, the AVX2 tag match, and prints accesses per second.
+ */
+void cache_bench(uint64_t n, FILE *out);
+
+/* ----------------------------------------------------------------
+   Global Interface
+   ---------------------------------------------------------------- */
+
+/*!
+ * \brief Global counter that increments on each memory access.
+ *        64-bit so that traces of billions of accesses are counted exactly.
+ */
+extern unsigned long am;
+
+/*!
+ * \brief Global counter for data cache misses.
+ */
+extern unsigned long dc;
+
+/*!
+ * \brief Global counter for TLB misses.
+ */
+extern unsigned long dtlb;
 
 /*!
  * \brief Line size (bytes) for data cache lines.
@@ -113,15 +218,31 @@ extern int tway;
  */
 extern int tsets;
 
+/*!
+ * \brief Replacement policy of the data cache (repl_policy, default LRU).
+ */
+extern int policy;
+
+/*!
+ * \brief Replacement policy of the TLB (repl_policy, default LRU).
+ */
+extern int tpolicy;
+
 /* ----------------------------------------------------------------
    Function Prototypes
    ---------------------------------------------------------------- */
 
 /*!
- * \brief Initialize data cache with current 'size', 'line', and 'way' global variables.
+ * \brief Initialize data cache with current 'size', 'line', 'way' and 'policy' global variables.
+ *        Exits with a message if the geometry is invalid.
  */
 void initcache();
 
+/*!
+ * \brief The data cache behind cache_access() (NULL before initcache()).
+ */
+cache_sim *cache_default(void);
+
 /*!
  * \brief Access the data cache with address \p addr.
  * \param addr The memory address being accessed.
@@ -130,10 +251,16 @@ void initcache();
 int cache_access(unsigned long addr);
 
 /*!
- * \brief Initialize TLB with current 'tsize' and 'tway'.
+ * \brief Initialize TLB with current 'tsize', 'tway' and 'tpolicy' ('pagesize' bytes per page).
+ *        Exits with a message if the geometry is invalid.
  */
 void inittlb();
 
+/*!
+ * \brief The TLB behind tlb_access() (NULL before inittlb()).
+ */
+cache_sim *tlb_default(void);
+
 /*!
  * \brief Access the TLB with address \p addr.
  * \param addr The memory address being translated.
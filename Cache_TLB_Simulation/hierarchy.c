@@ -0,0 +1,377 @@
+/*!
+ * \file hierarchy.c
+ * \brief Implementation of the multi-level cache hierarchy.
+ */
+
+#include "hierarchy.h"
+#include "replacement.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* ----------------------------------------------------------------
+   Configuration
+   ---------------------------------------------------------------- */
+
+static int parse_policies(const char *s, level_config *cfg) {
+    while (*s) {
+        size_t len = strcspn(s, ",");
+        if (len == 4 && strncmp(s, "incl", 4) == 0) cfg->inclusion = INCL_INCLUSIVE;
+        else if (len == 4 && strncmp(s, "excl", 4) == 0) cfg->inclusion = INCL_EXCLUSIVE;
+        else if (len == 4 && strncmp(s, "nine", 4) == 0) cfg->inclusion = INCL_NINE;
+        else if (len == 2 && strncmp(s, "wb", 2) == 0) cfg->write = WRITE_BACK;
+        else if (len == 2 && strncmp(s, "wt", 2) == 0) cfg->write = WRITE_THROUGH;
+        else if (len == 2 && strncmp(s, "wa", 2) == 0) cfg->alloc = WRITE_ALLOCATE;
+        else if (len == 3 && strncmp(s, "nwa", 3) == 0) cfg->alloc = NO_WRITE_ALLOCATE;
+        else if (len > 3 && strncmp(s, "pf=", 3) == 0) {
+            char spec[48];
+            if (len - 3 >= sizeof(spec)) return -1;
+            memcpy(spec, s + 3, len - 3);
+            spec[len - 3] = '\0';
+            if (pf_parse(spec, &cfg->pf) != 0) return -1;
+        } else {
+            char name[16];
+            if (len >= sizeof(name)) return -1;
+            memcpy(name, s, len);
+            name[len] = '\0';
+            if ((cfg->policy = repl_parse(name)) < 0 || cfg->policy == REPL_OPT) return -1;
+        }
+        s += len;
+        if (*s == ',') s++;
+    }
+    return 0;
+}
+
+int level_parse(const char *spec, level_config *cfg) {
+    char policies[64] = "";
+    int used = 0;
+
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->latency = 4.0;
+    if (sscanf(spec, "%15[^:]:%d:%d:%d%n", cfg->name, &cfg->size, &cfg->line, &cfg->way, &used) != 4) {
+        return -1;
+    }
+    spec += used;
+    if (*spec == ':') {
+        if (sscanf(spec, ":%lf%n", &cfg->latency, &used) != 1) {
+            return -1;
+        }
+        spec += used;
+    }
+    if (*spec == ':') {
+        if (sscanf(spec, ":%63s", policies) != 1) {
+            return -1;
+        }
+        spec += 1 + strlen(policies);
+    }
+    return (*spec == '\0' && parse_policies(policies, cfg) == 0) ? 0 : -1;
+}
+
+static const char *inclusion_name(int p) {
+    return p == INCL_INCLUSIVE ? "incl" : p == INCL_EXCLUSIVE ? "excl" : "nine";
+}
+
+int hier_init(hierarchy *h, const level_config *cfg, int nlevels, double mem_latency) {
+    memset(h, 0, sizeof(*h));
+    if (nlevels <= 0 || nlevels > HIER_MAX_LEVELS) {
+        fprintf(stderr, "A hierarchy has 1 to %d levels\n", HIER_MAX_LEVELS);
+        return -1;
+    }
+    h->mem_latency = mem_latency;
+    for (int i = 0; i < nlevels; i++) {
+        const level_config *c = &cfg[i];
+        cache_level *L = &h->level[i];
+        if (c->line <= 0 || (c->line & (c->line - 1)) || c->way <= 0 || c->size <= 0 ||
+            c->size % (c->way * c->line) != 0) {
+            fprintf(stderr, "%s: invalid geometry %d:%d:%d\n", c->name, c->size, c->line, c->way);
+            hier_free(h);
+            return -1;
+        }
+        if (i > 0 && c->line < cfg[i - 1].line) {
+            fprintf(stderr, "%s: lines may not shrink going outwards\n", c->name);
+            hier_free(h);
+            return -1;
+        }
+        if (i > 0 && c->inclusion == INCL_EXCLUSIVE && c->pf.kind != PF_NONE) {
+            fprintf(stderr, "%s: an exclusive level cannot prefetch\n", c->name);
+            hier_free(h);
+            return -1;
+        }
+        if (i > 0 && c->inclusion == INCL_EXCLUSIVE && c->line != cfg[i - 1].line) {
+            fprintf(stderr, "%s: an exclusive level needs the line size of the level above\n", c->name);
+            hier_free(h);
+            return -1;
+        }
+        L->cfg = *c;
+        if (i == 0) {
+            L->cfg.inclusion = INCL_NINE;
+        }
+        L->tags = cache_create(c->size, c->line, c->way);
+        L->dirty = L->tags ? calloc((size_t)L->tags->nsets * c->way, 1) : NULL;
+        h->nlevels = i + 1;
+        if (!L->dirty || cache_set_policy(L->tags, c->policy) != 0) {
+            fprintf(stderr, "%s: cannot allocate the tag store (%s)\n", c->name, repl_name(c->policy));
+            hier_free(h);
+            return -1;
+        }
+        if (c->pf.kind != PF_NONE &&
+            (!(L->pf = pf_create(&c->pf, L->tags)) ||
+             !(L->from = calloc((size_t)L->tags->nsets * c->way, 1)))) {
+            fprintf(stderr, "%s: cannot allocate the prefetcher\n", c->name);
+            hier_free(h);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void hier_free(hierarchy *h) {
+    for (int i = 0; i < h->nlevels; i++) {
+        cache_destroy(h->level[i].tags);
+        free(h->level[i].dirty);
+        free(h->level[i].from);
+        pf_destroy(h->level[i].pf);
+        h->level[i].tags = NULL;
+        h->level[i].dirty = NULL;
+        h->level[i].from = NULL;
+        h->level[i].pf = NULL;
+    }
+    h->nlevels = 0;
+}
+
+/* ----------------------------------------------------------------
+   Tag store of one level
+   ---------------------------------------------------------------- */
+
+static void evicted(hierarchy *h, int i, uint64_t addr, int dirty);
+
+/*!
+ * \brief Places the line of \p addr in level \p i, evicting the LRU way (empty ways first).
+ * \param prefetch 1 if the line is brought by the level's prefetcher.
+ * \return Its index in the tag store.
+ */
+static long insert_line(hierarchy *h, int i, uint64_t addr, int dirty, int prefetch) {
+    cache_level *L = &h->level[i];
+    uint64_t old;
+    long k = cache_fill(L->tags, addr, &old);
+    int old_dirty = L->dirty[k];
+
+    L->dirty[k] = (unsigned char)dirty;
+    if (L->pf) {
+        if (old != CACHE_INVALID) {
+            pf_evict(L->pf, k, old, prefetch);
+        }
+        pf_filled(L->pf, k, prefetch);
+    }
+    if (old != CACHE_INVALID) {
+        L->st.evictions++;
+        evicted(h, i, old * (uint64_t)L->cfg.line, old_dirty);
+    }
+    return k;
+}
+
+/* ----------------------------------------------------------------
+   Writebacks and evictions
+   ---------------------------------------------------------------- */
+
+/*!
+ * \brief A dirty line of the level above arrives at level \p i (or memory).
+ */
+static void write_back(hierarchy *h, int i, uint64_t addr) {
+    for (; i < h->nlevels; i++) {
+        cache_level *L = &h->level[i];
+        long k = cache_find(L->tags, addr);
+        if (k >= 0 && L->cfg.write == WRITE_BACK) {
+            L->dirty[k] = 1;
+            return;
+        }
+    }
+    h->mem_writes++;
+}
+
+/*!
+ * \brief Handles the line of \p addr just evicted from level \p i.
+ */
+static void evicted(hierarchy *h, int i, uint64_t addr, int dirty) {
+    cache_level *L = &h->level[i];
+
+    if (L->cfg.inclusion == INCL_INCLUSIVE) {
+        for (int j = 0; j < i; j++) {
+            cache_level *I = &h->level[j];
+            for (uint64_t a = addr; a < addr + (uint64_t)L->cfg.line; a += (uint64_t)I->cfg.line) {
+                long k = cache_find(I->tags, a);
+                if (k >= 0) {
+                    dirty |= I->dirty[k];
+                    if (I->pf) {
+                        pf_evict(I->pf, k, cache_line_of(I->tags, a), 0);
+                    }
+                    cache_invalidate(I->tags, k);
+                    I->st.back_invals++;
+                }
+            }
+        }
+    }
+    if (i + 1 < h->nlevels && h->level[i + 1].cfg.inclusion == INCL_EXCLUSIVE) {
+        h->level[i + 1].st.victims_in++;
+        long k = cache_find(h->level[i + 1].tags, addr);
+        if (k >= 0) {
+            h->level[i + 1].dirty[k] |= (unsigned char)dirty;
+        } else {
+            insert_line(h, i + 1, addr, dirty, 0);
+        }
+    } else if (dirty) {
+        L->st.writebacks++;
+        write_back(h, i + 1, addr);
+    }
+}
+
+/* ----------------------------------------------------------------
+   Requests
+   ---------------------------------------------------------------- */
+
+static int request(hierarchy *h, int i, uint64_t addr, int write, int prefetch, int *dirty_out);
+
+/*!
+ * \brief Trains the prefetcher of level \p i on a request for \p addr and reads the lines
+ *        it proposes from the next level.
+ * \param trigger 1 if the request missed or was the first use of a prefetched line.
+ */
+static void prefetch_after(hierarchy *h, int i, uint64_t addr, int trigger) {
+    cache_level *L = &h->level[i];
+    uint64_t cand[PF_MAX_DEGREE];
+    int n = pf_train(L->pf, addr, h->pc, trigger, cand), dirty;
+
+    for (int j = 0; j < n; j++) {
+        if (cache_find(L->tags, cand[j]) >= 0) {
+            L->pf->st.redundant++;
+            continue;
+        }
+        L->pf->st.issued++;
+        int from = request(h, i + 1, cand[j], 0, 1, &dirty);
+        L->from[insert_line(h, i, cand[j], dirty, 1)] = (unsigned char)from;
+    }
+}
+
+/*!
+ * \brief A read (line fill) or write request arriving at level \p i.
+ * \param prefetch 1 for a prefetch of the level above: it neither trains nor counts as a use of
+ *        this level's prefetches.
+ * \param dirty_out For reads, set to 1 if the line handed up carries dirty data (exclusive levels).
+ * \return The level that served it (nlevels for memory).
+ */
+static int request(hierarchy *h, int i, uint64_t addr, int write, int prefetch, int *dirty_out) {
+    *dirty_out = 0;
+    if (i == h->nlevels) {
+        if (write) h->mem_writes++;
+        else h->mem_reads++;
+        return i;
+    }
+    cache_level *L = &h->level[i];
+    const int exclusive = L->cfg.inclusion == INCL_EXCLUSIVE;
+    prefetcher *pf = prefetch ? NULL : L->pf;
+    int below_dirty;
+    long k = cache_find(L->tags, addr);
+
+    if (write) L->st.writes++;
+    else L->st.reads++;
+
+    if (k >= 0) {
+        cache_touch(L->tags, k);
+        int trigger = pf ? pf_hit(pf, k) : 0, served = i;
+        if (trigger == PF_LATE) {
+            /* The data is still on its way from where the prefetch read it: a miss that waits for it. */
+            if (write) L->st.write_misses++;
+            else L->st.read_misses++;
+            served = L->from[k];
+        }
+        if (write) {
+            if (L->cfg.write == WRITE_BACK) {
+                L->dirty[k] = 1;
+            } else {
+                request(h, i + 1, addr, 1, 0, &below_dirty);
+            }
+        } else if (exclusive) {
+            /* The line moves to the level above. */
+            *dirty_out = L->dirty[k];
+            cache_invalidate(L->tags, k);
+        }
+        if (pf) {
+            prefetch_after(h, i, addr, trigger);
+        }
+        return served;
+    }
+
+    if (write) L->st.write_misses++;
+    else L->st.read_misses++;
+    if (pf) {
+        pf_miss(pf, cache_line_of(L->tags, addr));
+    }
+    if (exclusive || (write && L->cfg.alloc == NO_WRITE_ALLOCATE)) {
+        /* Exclusive levels are only filled by victims; no-allocate writes go straight down. */
+        int served = request(h, i + 1, addr, write, prefetch, dirty_out);
+        if (pf) {
+            prefetch_after(h, i, addr, 1);
+        }
+        return served;
+    }
+    int served = request(h, i + 1, addr, 0, prefetch, &below_dirty);
+    k = insert_line(h, i, addr, below_dirty, 0);
+    if (write) {
+        if (L->cfg.write == WRITE_BACK) {
+            L->dirty[k] = 1;
+        } else {
+            request(h, i + 1, addr, 1, 0, &below_dirty);
+        }
+    }
+    if (pf) {
+        prefetch_after(h, i, addr, 1);
+    }
+    return served;
+}
+
+int hier_access(hierarchy *h, uint64_t addr, uint64_t pc, int write) {
+    int dirty;
+
+    h->accesses++;
+    h->pc = pc;
+    int served = request(h, 0, addr, write, 0, &dirty);
+    h->served[served]++;
+    for (int j = 0; j <= served && j < h->nlevels; j++) {
+        h->cycles += h->level[j].cfg.latency;
+    }
+    if (served == h->nlevels) {
+        h->cycles += h->mem_latency;
+    }
+    return served;
+}
+
+double hier_amat(const hierarchy *h) {
+    return h->accesses ? h->cycles / (double)h->accesses : 0.0;
+}
+
+void hier_print(const hierarchy *h, FILE *out) {
+    fprintf(out, "%-6s %10s %5s %5s %-18s %12s %12s %12s %8s %12s %12s %10s\n", "Level", "Size", "Line", "Ways",
+            "Policy", "Accesses", "Hits", "Misses", "Miss%", "Writebacks", "BackInvals", "Served");
+    for (int i = 0; i < h->nlevels; i++) {
+        const cache_level *L = &h->level[i];
+        const level_stats *s = &L->st;
+        uint64_t acc = s->reads + s->writes, miss = s->read_misses + s->write_misses;
+        char policy[32];
+        snprintf(policy, sizeof(policy), "%s,%s,%s,%s", inclusion_name(L->cfg.inclusion),
+                 L->cfg.write == WRITE_BACK ? "wb" : "wt", L->cfg.alloc == WRITE_ALLOCATE ? "wa" : "nwa",
+                 repl_name(L->cfg.policy));
+        fprintf(out, "%-6s %10d %5d %5d %-18s %12llu %12llu %12llu %8.3f %12llu %12llu %10llu\n", L->cfg.name,
+                L->cfg.size, L->cfg.line, L->cfg.way, policy, (unsigned long long)acc,
+                (unsigned long long)(acc - miss), (unsigned long long)miss, acc ? 100.0 * miss / acc : 0.0,
+                (unsigned long long)s->writebacks, (unsigned long long)s->back_invals,
+                (unsigned long long)h->served[i]);
+    }
+    fprintf(out, "%-6s reads=%llu writes=%llu served=%llu\n", "Memory", (unsigned long long)h->mem_reads,
+            (unsigned long long)h->mem_writes, (unsigned long long)h->served[h->nlevels]);
+    fprintf(out, "AMAT:          %.3f cycles (memory %.0f cycles)\n", hier_amat(h), h->mem_latency);
+    for (int i = 0; i < h->nlevels; i++) {
+        const cache_level *L = &h->level[i];
+        if (L->pf) {
+            pf_print(L->pf, L->cfg.name, L->st.read_misses + L->st.write_misses, out);
+        }
+    }
+}
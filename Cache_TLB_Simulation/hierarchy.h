@@ -0,0 +1,150 @@
+/*!
+ * \file hierarchy.h
+ * \brief Multi-level data cache hierarchy (L1D/L2/L3...) with inclusion
+ *        and write policies, per-level statistics and an AMAT estimate.
+ *
+ * Level 0 is the closest to the core. The inclusion policy of a level
+ * describes it relative to the levels above it:
+ *  - INCL_NINE: filled on every miss, evictions do not touch inner levels;
+ *  - INCL_INCLUSIVE: filled on every miss, and evicting a line
+ *    back-invalidates it in the inner levels (their dirty data is written
+ *    back with it);
+ *  - INCL_EXCLUSIVE: a victim cache of the level above: it is filled only
+ *    with the lines evicted from there, and a hit moves the line up.
+ * Line sizes are powers of two and never shrink going outwards; an exclusive
+ * level has the same line size as the level above it. A non-exclusive level
+ * may have a prefetcher (prefetch.h) trained on the requests it receives
+ * from the level above; its prefetches are read from the next level like
+ * fills. A demand hit on a prefetch still in flight counts as a miss of
+ * the level and, in the AMAT, waits like an access served by the level the
+ * prefetch was read from.
+ */
+
+#ifndef HIERARCHY_H
+#define HIERARCHY_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "cache_tlb_sim.h"
+#include "prefetch.h"
+
+/*! \brief Maximum number of levels of a hierarchy. */
+#define HIER_MAX_LEVELS 8
+
+/*! \brief Inclusion policy of a level relative to the levels above it. */
+typedef enum {
+    INCL_NINE = 0,      /*!< Non-inclusive, non-exclusive */
+    INCL_INCLUSIVE = 1, /*!< Contains every line of the inner levels */
+    INCL_EXCLUSIVE = 2  /*!< Contains no line of the level above */
+} inclusion_policy;
+
+/*! \brief What a write hit does. */
+typedef enum {
+    WRITE_BACK = 0,   /*!< Mark the line dirty, write it when evicted */
+    WRITE_THROUGH = 1 /*!< Forward the write to the next level too */
+} write_policy;
+
+/*! \brief What a write miss does. */
+typedef enum {
+    WRITE_ALLOCATE = 0,   /*!< Fetch the line, then write it */
+    NO_WRITE_ALLOCATE = 1 /*!< Forward the write to the next level without fetching */
+} alloc_policy;
+
+/*!
+ * \brief Geometry, policies and hit latency of one level.
+ */
+typedef struct {
+    char name[16];  /*!< e.g. "L1D" */
+    int size;       /*!< Bytes */
+    int line;       /*!< Bytes per line (power of two) */
+    int way;        /*!< Associativity */
+    int inclusion;  /*!< inclusion_policy */
+    int write;      /*!< write_policy */
+    int alloc;      /*!< alloc_policy */
+    int policy;     /*!< repl_policy (any but REPL_OPT) */
+    pf_config pf;   /*!< Prefetcher (kind PF_NONE: none) */
+    double latency; /*!< Cycles to look up the level (hit latency) */
+} level_config;
+
+/*!
+ * \brief Counters of one level.
+ */
+typedef struct {
+    uint64_t reads;         /*!< Read requests: demand loads and fills for inner levels */
+    uint64_t writes;        /*!< Write requests: demand stores, write-through and no-allocate writes */
+    uint64_t read_misses;
+    uint64_t write_misses;
+    uint64_t writebacks;    /*!< Dirty lines sent to the next level on eviction */
+    uint64_t evictions;     /*!< Valid lines replaced */
+    uint64_t back_invals;   /*!< Lines invalidated here by an inclusive outer level */
+    uint64_t victims_in;    /*!< Lines received from the level above (exclusive levels) */
+} level_stats;
+
+/*!
+ * \brief One level: configuration, LRU tag store and counters.
+ */
+typedef struct {
+    level_config cfg;
+    cache_sim *tags;        /*!< Tag store (its recency is the level's LRU) */
+    unsigned char *dirty;   /*!< One flag per way of \c tags */
+    prefetcher *pf;         /*!< NULL without prefetcher */
+    unsigned char *from;    /*!< One per way: level (nlevels: memory) its prefetch was read from;
+                                 NULL without prefetcher */
+    level_stats st;
+} cache_level;
+
+/*!
+ * \brief A hierarchy of levels in front of memory.
+ */
+typedef struct {
+    int nlevels;
+    cache_level level[HIER_MAX_LEVELS];
+    double mem_latency;    /*!< Cycles of a memory access */
+    uint64_t accesses;     /*!< Demand accesses so far */
+    uint64_t mem_reads;    /*!< Lines read from memory */
+    uint64_t mem_writes;   /*!< Lines (or write-through words) written to memory */
+    uint64_t served[HIER_MAX_LEVELS + 1]; /*!< Demand accesses served by each level, then memory
+                                               (late prefetch hits: where the prefetch was read from) */
+    double cycles;         /*!< Sum of the latencies of all demand accesses */
+    uint64_t pc;           /*!< PC of the demand access in flight (for IP-stride prefetchers) */
+} hierarchy;
+
+/*!
+ * \brief Parses "NAME:SIZE:LINE:WAYS[:LATENCY[:POLICIES]]", POLICIES being a
+ *        comma-separated subset of incl|excl|nine, wb|wt, wa|nwa, a replacement
+ *        policy other than opt and pf=KIND/DEGREE/DISTANCE/LATENCY (see pf_parse())
+ *        (default nine,wb,wa,lru, no prefetcher; latency 4 cycles).
+ * \return 0 on success, -1 if malformed.
+ */
+int level_parse(const char *spec, level_config *cfg);
+
+/*!
+ * \brief Allocates the levels and checks their consistency.
+ * \return 0 on success, -1 (with a message on stderr) otherwise.
+ */
+int hier_init(hierarchy *h, const level_config *cfg, int nlevels, double mem_latency);
+
+/*!
+ * \brief Releases the tag stores and prefetchers.
+ */
+void hier_free(hierarchy *h);
+
+/*!
+ * \brief Simulates one demand load (\p write = 0) or store (\p write = 1) by the instruction at \p pc.
+ * \return The level that served it (nlevels for memory); for a hit on a late prefetch, the level
+ *         the prefetch was read from.
+ */
+int hier_access(hierarchy *h, uint64_t addr, uint64_t pc, int write);
+
+/*!
+ * \brief Average memory access time in cycles: sum over demand accesses of the latencies of
+ *        the levels looked up, plus memory for those served by memory, over the accesses.
+ */
+double hier_amat(const hierarchy *h);
+
+/*!
+ * \brief Prints one line per level and one for memory, the AMAT, then the counters of the prefetchers.
+ */
+void hier_print(const hierarchy *h, FILE *out);
+
+#endif
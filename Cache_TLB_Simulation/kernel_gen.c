@@ -0,0 +1,282 @@
+/*!
+ * \file kernel_gen.c
+ * \brief Implementation of the kernel address-stream generators.
+ */
+
+#include "kernel_gen.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*! \brief Alignment of the default layout's buffers (a page). */
+#define KG_PAGE 4096
+
+static const char *const kernel_names[KG_COUNT] = {
+    [KG_ZERO_VECTOR] = "zero_vector",
+    [KG_COPY_IJ] = "copy_matrix_ij",
+    [KG_COPY_JI] = "copy_matrix_ji",
+    [KG_ADD_IJ] = "add_matrix_ij",
+    [KG_ADD_JI] = "add_matrix_ji",
+    [KG_SCALAR_PRODUCT] = "scalar_product",
+    [KG_MULT_IJK] = "matrix_mult_ijk",
+    [KG_MULT_IKJ] = "matrix_mult_ikj",
+    [KG_MULT_BLOCKED] = "matrix_mult_blocked",
+    [KG_MULT_BLOCKED_IKJ] = "matrix_mult_blocked_ikj",
+    [KG_MULT_TRANS_IJK] = "matrix_mult_trans_ijk",
+};
+
+/* ----------------------------------------------------------------
+   Configuration
+   ---------------------------------------------------------------- */
+
+void kg_layout(kg_config *cfg) {
+    int per_line = 64 / cfg->elem;
+    uint64_t at = KG_DEFAULT_BASE;
+
+    if (per_line < 1) {
+        per_line = 1;
+    }
+    cfg->ld = (cfg->n + per_line - 1) / per_line * per_line;
+    for (int b = 0; b < KG_BUFFERS; b++) {
+        uint64_t bytes = (uint64_t)cfg->n * (b < KG_BF ? (uint64_t)cfg->ld : (uint64_t)cfg->n) * cfg->elem;
+        cfg->base[b] = at + 64;
+        at = (at + 64 + bytes + KG_PAGE - 1) / KG_PAGE * KG_PAGE;
+    }
+}
+
+void kg_defaults(kg_config *cfg, int kernel, int n) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->kernel = kernel;
+    cfg->n = n;
+    cfg->bl = 16;
+    cfg->elem = 4;
+    kg_layout(cfg);
+}
+
+int kg_parse_bases(const char *s, kg_config *cfg) {
+    for (int b = 0; b < KG_BUFFERS; b++) {
+        char *end;
+        uint64_t v = strtoull(s, &end, 0);
+        if (end == s) {
+            return -1;
+        }
+        cfg->base[b] = v;
+        if (*end != ',') {
+            return *end == '\0' ? 0 : -1;
+        }
+        s = end + 1;
+    }
+    return -1;
+}
+
+int kg_parse(const char *name) {
+    for (int k = 0; k < KG_COUNT; k++) {
+        if (strcmp(name, kernel_names[k]) == 0) {
+            return k;
+        }
+    }
+    return -1;
+}
+
+const char *kg_name(int kernel) {
+    return kernel >= 0 && kernel < KG_COUNT ? kernel_names[kernel] : "?";
+}
+
+int kg_uses_bl(int kernel) {
+    return kernel == KG_MULT_BLOCKED || kernel == KG_MULT_BLOCKED_IKJ;
+}
+
+uint64_t kg_count(const kg_config *cfg) {
+    const uint64_t n = (uint64_t)cfg->n, n2 = n * n, n3 = n2 * n;
+    const uint64_t blocks = cfg->bl > 0 ? (n + (uint64_t)cfg->bl - 1) / (uint64_t)cfg->bl : 0;
+
+    switch (cfg->kernel) {
+    case KG_ZERO_VECTOR: return n2;
+    case KG_COPY_IJ:
+    case KG_COPY_JI:
+    case KG_SCALAR_PRODUCT: return 2 * n2;
+    case KG_ADD_IJ:
+    case KG_ADD_JI: return 3 * n2;
+    case KG_MULT_IJK:
+    case KG_MULT_TRANS_IJK: return 2 * n3 + n2;
+    case KG_MULT_IKJ: return 3 * n3 + n2;
+    /* Per k block: the partial sums are stored, and read back from the second block on. */
+    case KG_MULT_BLOCKED: return 2 * n3 + (2 * blocks - 1) * n2;
+    /* The row of the block is zeroed once; AF[i][k] is read once per j block. */
+    case KG_MULT_BLOCKED_IKJ: return 3 * n3 + n2 + blocks * n2;
+    default: return 0;
+    }
+}
+
+int kg_init(kg_gen *g, const kg_config *cfg) {
+    if (cfg->kernel < 0 || cfg->kernel >= KG_COUNT || cfg->n <= 0 || cfg->ld < cfg->n || cfg->elem <= 0 ||
+        (kg_uses_bl(cfg->kernel) && cfg->bl <= 0)) {
+        return -1;
+    }
+    memset(g, 0, sizeof(*g));
+    g->cfg = *cfg;
+    return 0;
+}
+
+/* ----------------------------------------------------------------
+   Loop nests
+   ---------------------------------------------------------------- */
+
+/*!
+ * \brief Queues the access of site \p site to element (\p row, \p col) of buffer \p b
+ *        (vectors: row 0, col the index).
+ */
+static inline void emit(kg_gen *g, int b, long row, long col, int site, int write) {
+    const kg_config *c = &g->cfg;
+    mem_access *a = &g->pend[g->npend++];
+    a->addr = c->base[b] + ((uint64_t)row * (uint64_t)c->ld + (uint64_t)col) * (uint64_t)c->elem;
+    a->pc = KG_PC_BASE + 0x100 * (uint64_t)c->kernel + 4 * (uint64_t)site;
+    a->write = write;
+}
+
+static inline int min_int(int a, int b) {
+    return a < b ? a : b;
+}
+
+/*!
+ * \brief Queues the accesses of the next innermost iteration and advances the indices.
+ * \return 0 once the kernel has finished.
+ */
+static int step(kg_gen *g) {
+    const int n = g->cfg.n, bl = g->cfg.bl;
+    const long nn = (long)n * n;
+
+    switch (g->cfg.kernel) {
+    case KG_ZERO_VECTOR:
+        if (g->i == nn) return 0;
+        emit(g, KG_BF, 0, g->i++, 0, 1);
+        return 1;
+
+    case KG_SCALAR_PRODUCT:
+        if (g->i == nn) return 0;
+        emit(g, KG_BF, 0, g->i, 0, 0);
+        emit(g, KG_CF, 0, g->i++, 1, 0);
+        return 1;
+
+    case KG_COPY_IJ:
+    case KG_ADD_IJ:
+    case KG_COPY_JI:
+    case KG_ADD_JI: {
+        const int add = g->cfg.kernel == KG_ADD_IJ || g->cfg.kernel == KG_ADD_JI;
+        const int ij = g->cfg.kernel == KG_COPY_IJ || g->cfg.kernel == KG_ADD_IJ;
+        if ((ij ? g->i : g->j) == n) return 0;
+        if (add) emit(g, KG_AF, g->i, g->j, 0, 0);
+        emit(g, KG_YF, g->i, g->j, 1, 0);
+        emit(g, KG_AF, g->i, g->j, 2, 1);
+        if (ij) {
+            if (++g->j == n) { g->j = 0; g->i++; }
+        } else {
+            if (++g->i == n) { g->i = 0; g->j++; }
+        }
+        return 1;
+    }
+
+    case KG_MULT_IJK:
+    case KG_MULT_TRANS_IJK:
+        if (g->i == n) return 0;
+        emit(g, KG_AF, g->i, g->k, 0, 0);
+        if (g->cfg.kernel == KG_MULT_IJK) emit(g, KG_XF, g->k, g->j, 1, 0);
+        else emit(g, KG_YT, g->j, g->k, 1, 0);
+        if (g->k == n - 1) emit(g, KG_YF, g->i, g->j, 2, 1);
+        if (++g->k == n) {
+            g->k = 0;
+            if (++g->j == n) { g->j = 0; g->i++; }
+        }
+        return 1;
+
+    case KG_MULT_IKJ:
+        if (g->i == n) return 0;
+        if (g->j == 0) emit(g, KG_AF, g->i, g->k, 0, 0);
+        emit(g, KG_YF, g->i, g->j, 1, 0);
+        emit(g, KG_XF, g->k, g->j, 2, 0);
+        emit(g, KG_YF, g->i, g->j, 3, 1);
+        if (++g->j == n) {
+            g->j = 0;
+            if (++g->k == n) { g->k = 0; g->i++; }
+        }
+        return 1;
+
+    case KG_MULT_BLOCKED: {
+        if (g->jj >= n) return 0;
+        const int jend = min_int(g->jj + bl, n), kend = min_int(g->kk + bl, n);
+        if (g->k == g->kk && g->kk > 0) emit(g, KG_YF, g->i, g->j, 0, 0);
+        emit(g, KG_AF, g->i, g->k, 1, 0);
+        emit(g, KG_XF, g->k, g->j, 2, 0);
+        if (g->k == kend - 1) emit(g, KG_YF, g->i, g->j, 3, 1);
+        if (++g->k == kend) {
+            g->k = g->kk;
+            if (++g->j == jend) {
+                g->j = g->jj;
+                if (++g->i == n) {
+                    g->i = 0;
+                    if ((g->kk += bl) >= n) {
+                        g->kk = 0;
+                        g->jj += bl;
+                        g->j = g->jj;
+                    }
+                    g->k = g->kk;
+                }
+            }
+        }
+        return 1;
+    }
+
+    case KG_MULT_BLOCKED_IKJ: {
+        if (g->jj >= n) return 0;
+        const int jend = min_int(g->jj + bl, n), kend = min_int(g->kk + bl, n);
+        if (g->phase == 0) {
+            /* kk == 0: y[jj..jend) = 0 before the first k. */
+            emit(g, KG_YF, g->i, g->j, 0, 1);
+            if (++g->j == jend) {
+                g->j = g->jj;
+                g->phase = 1;
+            }
+            return 1;
+        }
+        if (g->j == g->jj) emit(g, KG_AF, g->i, g->k, 1, 0);
+        emit(g, KG_YF, g->i, g->j, 2, 0);
+        emit(g, KG_XF, g->k, g->j, 3, 0);
+        emit(g, KG_YF, g->i, g->j, 4, 1);
+        if (++g->j == jend) {
+            g->j = g->jj;
+            if (++g->k == kend) {
+                if (++g->i == n) {
+                    g->i = 0;
+                    if ((g->kk += bl) >= n) {
+                        g->kk = 0;
+                        g->jj += bl;
+                        g->j = g->jj;
+                    }
+                }
+                g->k = g->kk;
+                g->phase = g->kk == 0 ? 0 : 1;
+            }
+        }
+        return 1;
+    }
+
+    default:
+        return 0;
+    }
+}
+
+size_t kg_read(kg_gen *g, mem_access *out, size_t max) {
+    size_t n = 0;
+
+    while (n < max) {
+        if (g->next == g->npend) {
+            g->next = g->npend = 0;
+            if (g->done || !step(g)) {
+                g->done = 1;
+                break;
+            }
+        }
+        out[n++] = g->pend[g->next++];
+    }
+    g->emitted += n;
+    return n;
+}
@@ -0,0 +1,132 @@
+/*!
+ * \file kernel_gen.h
+ * \brief Address streams of the Matrix_Operations kernels, generated lazily.
+ *
+ * A generator walks the loop nest of one kernel of matrix_ops.c and emits
+ * its loads and stores in program order, a few at a time, so a replay of
+ * any size costs no memory. Matrices are row-major with a row stride of
+ * \c ld elements as in matrix_ctx; scalar accumulators (SF) are taken to
+ * live in registers. Each load or store site of a kernel has its own PC,
+ * so IP-stride prefetchers see one stream per site. The loop nests mirror
+ * matrix_ops.c and must follow it when a kernel changes.
+ */
+
+#ifndef KERNEL_GEN_H
+#define KERNEL_GEN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "addr_trace.h"
+
+/*! \brief PC of the first access site; kernel k, site s is at KG_PC_BASE + 0x100 * k + 4 * s. */
+#define KG_PC_BASE 0x401000
+
+/*! \brief Address of the first buffer of the default layout. */
+#define KG_DEFAULT_BASE 0x7f0000000000ULL
+
+/*! \brief Kernels of matrix_ops.c. */
+typedef enum {
+    KG_ZERO_VECTOR = 0,
+    KG_COPY_IJ,
+    KG_COPY_JI,
+    KG_ADD_IJ,
+    KG_ADD_JI,
+    KG_SCALAR_PRODUCT,
+    KG_MULT_IJK,
+    KG_MULT_IKJ,
+    KG_MULT_BLOCKED,     /*!< blocked_mult() with BLOCKED_IJK */
+    KG_MULT_BLOCKED_IKJ, /*!< blocked_mult() with BLOCKED_IKJ */
+    KG_MULT_TRANS_IJK,   /*!< The multiply only; XT is read from YT */
+    KG_COUNT
+} kg_kernel;
+
+/*! \brief Buffers of matrix_ctx, in allocation order. */
+typedef enum {
+    KG_AF = 0,
+    KG_YF,
+    KG_XF,
+    KG_YT,
+    KG_BF,
+    KG_CF,
+    KG_BUFFERS
+} kg_buffer;
+
+/*!
+ * \brief Kernel, sizes and data layout of a generator.
+ */
+typedef struct {
+    int kernel;                  /*!< kg_kernel */
+    int n;                       /*!< Matrices [n][n], vectors [n^2] */
+    int ld;                      /*!< Row stride of the matrices in elements */
+    int bl;                      /*!< Block size of the blocked kernels */
+    int elem;                    /*!< Bytes per element (sizeof(TYPE)) */
+    uint64_t base[KG_BUFFERS];   /*!< Byte address of each buffer */
+} kg_config;
+
+/*!
+ * \brief Generator state: the loop indices of the kernel and the accesses of the current
+ *        iteration not yet handed out.
+ */
+typedef struct {
+    kg_config cfg;
+    int i, j, k, jj, kk; /*!< Loop indices (jj, kk: block origins) */
+    int phase;           /*!< Blocked ikj: 0 while zeroing the row of the block, 1 after */
+    int done;
+    mem_access pend[4];
+    int npend, next;
+    uint64_t emitted;    /*!< Accesses handed out */
+} kg_gen;
+
+/*!
+ * \brief Fills \p cfg for \p kernel and size \p n with the defaults of Matrix_Operations: 4-byte
+ *        elements, BL 16, the padded leading dimension of matrix_default_ld() and the buffers
+ *        page-aligned (plus 64 bytes, as posix_memalign() returns large blocks) one after another.
+ */
+void kg_defaults(kg_config *cfg, int kernel, int n);
+
+/*!
+ * \brief Recomputes the default leading dimension and layout after changing n or elem.
+ */
+void kg_layout(kg_config *cfg);
+
+/*!
+ * \brief Parses comma-separated buffer addresses (decimal or 0x hex) in kg_buffer order; the
+ *        buffers not listed keep their address.
+ * \return 0 on success, -1 if malformed.
+ */
+int kg_parse_bases(const char *s, kg_config *cfg);
+
+/*!
+ * \brief Kernel named as its function in matrix_ops.c (matrix_mult_blocked_ikj for the ikj
+ *        order of the blocked kernel), or -1.
+ */
+int kg_parse(const char *name);
+
+/*!
+ * \brief Name of a kg_kernel.
+ */
+const char *kg_name(int kernel);
+
+/*!
+ * \brief 1 if the kernel depends on the block size.
+ */
+int kg_uses_bl(int kernel);
+
+/*!
+ * \brief Total number of accesses of the kernel.
+ */
+uint64_t kg_count(const kg_config *cfg);
+
+/*!
+ * \brief Starts a generator.
+ * \return 0 on success, -1 if the configuration is invalid.
+ */
+int kg_init(kg_gen *g, const kg_config *cfg);
+
+/*!
+ * \brief Hands out the next accesses of the kernel, up to \p max.
+ * \return The number stored in \p out, 0 at the end of the kernel.
+ */
+size_t kg_read(kg_gen *g, mem_access *out, size_t max);
+
+#endif
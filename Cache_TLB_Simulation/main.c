@@ -1,38 +1,933 @@
 /*!
- * \file simulate_cache.c
- * \brief Example driver for data cache and TLB simulations.
+ * \file main.c
+ * \brief Driver for data cache and TLB simulations.
  *
- * This file shows how to configure and initialize
- * the data cache and TLB, then perform random memory
- * accesses to measure misses.
+ * Configures the data cache and the TLB, then replays a memory trace
+ * (text, raw binary or compact varint, see addr_trace.h) through ac(), or,
+ * without a trace, a number of random accesses. With --level options the
+ * data accesses go through a multi-level hierarchy (hierarchy.h) instead of
+ * the single cache; the TLB is simulated in both cases. With --sweep the
+ * trace is replayed once through every combination of the listed cache
+ * and TLB geometries, in parallel (sweep.h), and one CSV row is printed
+ * per combination. With --mrc the same replay also builds the LRU miss-ratio
+ * curves of every cache size (stack_dist.h). With --prefetch a prefetcher
+ * (prefetch.h) fills the single cache. With --kernel the accesses come from
+ * the address-stream generators of the Matrix_Operations kernels
+ * (kernel_gen.h) instead of a trace, one table row per kernel and block size.
+ * With --mmu the TLB is replaced by the multi-page-size translation model
+ * (mmu.h). With --sample only a subset of the cache and TLB sets (and,
+ * optionally, periodic windows of the trace) is simulated and the misses
+ * are extrapolated with a confidence interval (sampling.h). Usage: './cachesim.elf
+ * [options] [trace]' (see usage()); "-" reads the trace from stdin.
  */
 
+#include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "addr_trace.h"
 #include "cache_tlb_sim.h"
+#include "hierarchy.h"
+#include "kernel_gen.h"
+#include "mmu.h"
+#include "prefetch.h"
+#include "replacement.h"
+#include "sampling.h"
+#include "stack_dist.h"
+#include "sweep.h"
+#include "trace.h"
+
+/*!
+ * \brief Prints the command line usage.
+ * \param prog Program name.
+ */
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options] [trace]\n"
+            "  -f, --format=FMT      trace format: text, bin, vtr or auto (default auto)\n"
+            "  -S, --stream          read through the double-buffered reader instead of mmap\n"
+            "  -c, --cache=S:L:W     cache size and line in bytes, ways (default 4096:16:1)\n"
+            "  -t, --tlb=E:W         TLB entries and ways (default 8:1)\n"
+            "  -P, --policy=NAME     cache replacement: lru, fifo, random, plru, srrip, brrip, drrip\n"
+            "                        or opt (Belady, needs a trace file; default lru)\n"
+            "  -p, --tlb-policy=NAME TLB replacement, same names (default lru)\n"
+            "  -U, --mmu[=SPEC]      replace the TLB with per-page-size L1 dTLBs, an STLB and page-walk\n"
+            "                        caches; SPEC: l1-4k|l1-2m|l1-1g|stlb=E:W, pwc=A:B:C, stlb-lat|walk-lat=C\n"
+            "      --region=START:LEN:SIZE\n"
+            "                        map a range to 4K, 2M or 1G pages (repeatable; first match wins)\n"
+            "      --page-default=SIZE\n"
+            "                        page size outside the regions (default 4K; 2M models THP everywhere)\n"
+            "  -Q, --sample=RATIO[:WINDOW:PERIOD[:WARMUP]]\n"
+            "                        simulate one cache and TLB set in RATIO and, with WINDOW, only the\n"
+            "                        last WINDOW accesses of every PERIOD (WARMUP before them unmeasured);\n"
+            "                        print estimated misses with 95%% confidence intervals\n"
+            "      --sample-validate also simulate every set and report the estimates' error\n"
+            "  -R, --prefetch=KIND[:DEGREE[:DISTANCE[:LATENCY]]]\n"
+            "                        prefetcher of the cache: next, stride or stream (default 1:1:16)\n"
+            "  -o, --convert=FILE    also write the accesses read to FILE\n"
+            "  -F, --out-format=FMT  format of --convert: text, bin or vtr (default vtr)\n"
+            "  -r, --random=N        without a trace, simulate N random accesses (default 200)\n"
+            "  -T, --trace=FILE      record the read/simulate phases as a Chrome trace_event JSON\n"
+            "  -L, --level=SPEC      add a hierarchy level NAME:SIZE:LINE:WAYS[:LATENCY[:POLICIES]],\n"
+            "                        innermost first; POLICIES from incl|excl|nine, wb|wt, wa|nwa,\n"
+            "                        a replacement policy (not opt) and pf=KIND/DEGREE/DISTANCE/LATENCY\n"
+            "  -M, --mem-latency=C   memory latency of the hierarchy in cycles (default 200)\n"
+            "  -s, --sweep=SIZES:LINES:WAYS\n"
+            "                        replay the trace once through every cache geometry of the\n"
+            "                        comma-separated lists (sizes accept K/M) and print CSV\n"
+            "  -e, --sweep-tlb=ENTRIES:WAYS\n"
+            "                        TLB geometries of the sweep (default the --tlb one)\n"
+            "  -j, --threads=N       sweep worker threads (default 1)\n"
+            "  -m, --mrc[=SETS]      also print the LRU miss-ratio curve of every fully associative\n"
+            "                        size, and of every associativity for each listed number of sets\n"
+            "  -W, --mrc-ways=N      deepest associativity of the per-set curves (default 16)\n"
+            "  -X, --mrc-max=BYTES   largest fully associative size of the curve (default 64M)\n"
+            "  -H, --shards=RATE     sample the fully associative curve at RATE (default 1: exact)\n"
+            "  -K, --kernel=NAMES    replay the comma-separated Matrix_Operations kernels (or all) instead\n"
+            "                        of a trace and print their predicted misses\n"
+            "  -n, --kernel-n=N      kernel matrix size (default 500)\n"
+            "  -b, --kernel-bl=LIST  block sizes of the blocked kernels, one row each (default 16)\n"
+            "  -z, --kernel-elem=B   bytes per element (default 4)\n"
+            "  -A, --kernel-base=AF,YF,XF,YT,BF,CF\n"
+            "                        buffer addresses (default page-aligned, one after another)\n"
+            "  -B, --bench[=N]       measure the simulator's accesses/s on N synthetic accesses (default 20M)\n",
+            prog);
+}
+
+/*! \brief Values of the long options without a short one. */
+enum { OPT_REGION = 256, OPT_PAGE_DEFAULT, OPT_SAMPLE_VALIDATE };
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*!
+ * \brief Checks the cache and TLB configuration.
+ * \return 0 if valid, -1 (with a message) otherwise.
+ */
+static int check_config(void) {
+    if (line <= 0 || way <= 0 || size <= 0 || size % (way * line) != 0) {
+        fprintf(stderr, "Invalid cache %d:%d:%d (size must be a multiple of ways * line)\n", size, line, way);
+        return -1;
+    }
+    if (tway <= 0 || tsize <= 0 || tsize % tway != 0) {
+        fprintf(stderr, "Invalid TLB %d:%d (entries must be a multiple of ways)\n", tsize, tway);
+        return -1;
+    }
+    return 0;
+}
+
+/*!
+ * \brief Parses a comma-separated list of positive numbers with optional K/M suffixes.
+ * \return The number of values stored in \p out, or -1 if malformed or more than \p max.
+ */
+static int parse_list(const char *s, long *out, int max) {
+    int n = 0;
+    for (;;) {
+        char *end;
+        long v = strtol(s, &end, 10);
+        if (*end == 'K' || *end == 'k') {
+            v <<= 10;
+            end++;
+        } else if (*end == 'M' || *end == 'm') {
+            v <<= 20;
+            end++;
+        }
+        if (end == s || v <= 0 || n == max) {
+            return -1;
+        }
+        out[n++] = v;
+        if (*end != ',') {
+            return *end == '\0' ? n : -1;
+        }
+        s = end + 1;
+    }
+}
+
+/*!
+ * \brief Splits "A:B[:C]" into \p nparts lists and parses each with parse_list().
+ * \return 0 on success, -1 if malformed.
+ */
+static int parse_lists(const char *spec, int nparts, long lists[][SWEEP_MAX_VALUES], int *counts) {
+    char buf[512];
+    char *save = NULL, *part;
+    int i = 0;
+
+    if (snprintf(buf, sizeof(buf), "%s", spec) >= (int)sizeof(buf)) {
+        return -1;
+    }
+    for (part = strtok_r(buf, ":", &save); part; part = strtok_r(NULL, ":", &save)) {
+        if (i == nparts || (counts[i] = parse_list(part, lists[i], SWEEP_MAX_VALUES)) < 0) {
+            return -1;
+        }
+        i++;
+    }
+    return i == nparts ? 0 : -1;
+}
+
+/*!
+ * \brief Runs a sweep of the trace at \p path over the cache and TLB lists and prints CSV.
+ *
+ * Caches and TLBs do not interact, so each distinct geometry is simulated once
+ * and the rows are the cross product of their results.
+ */
+static int run_sweep(const char *path, int format, int mode, const char *cache_spec, const char *tlb_spec,
+                     int threads) {
+    long cl[3][SWEEP_MAX_VALUES], tl[2][SWEEP_MAX_VALUES];
+    int cn[3], tn[2], ncache = 0, ntlb = 0, status = 1;
+    char tlb_default[32];
+
+    snprintf(tlb_default, sizeof(tlb_default), "%d:%d", tsize, tway);
+    if (parse_lists(cache_spec, 3, cl, cn) != 0) {
+        fprintf(stderr, "Invalid sweep '%s' (SIZES:LINES:WAYS, at most %d values each)\n", cache_spec,
+                SWEEP_MAX_VALUES);
+        return 1;
+    }
+    if (parse_lists(tlb_spec ? tlb_spec : tlb_default, 2, tl, tn) != 0) {
+        fprintf(stderr, "Invalid TLB sweep '%s' (ENTRIES:WAYS)\n", tlb_spec);
+        return 1;
+    }
+    cache_sim **sims = calloc((size_t)cn[0] * cn[1] * cn[2] + (size_t)tn[0] * tn[1], sizeof(cache_sim *));
+    if (!sims) {
+        fprintf(stderr, "Cannot allocate the sweep\n");
+        return 1;
+    }
+    for (int a = 0; a < cn[0]; a++) {
+        for (int b = 0; b < cn[1]; b++) {
+            for (int c = 0; c < cn[2]; c++) {
+                cache_sim *sim = cache_create(cl[0][a], (int)cl[1][b], (int)cl[2][c]);
+                if (sim && cache_set_policy(sim, policy) != 0) {
+                    cache_destroy(sim);
+                    sim = NULL;
+                }
+                if (sim) {
+                    sims[ncache++] = sim;
+                } else {
+                    fprintf(stderr, "Skipping cache %ld:%ld:%ld\n", cl[0][a], cl[1][b], cl[2][c]);
+                }
+            }
+        }
+    }
+    for (int a = 0; a < tn[0]; a++) {
+        for (int b = 0; b < tn[1]; b++) {
+            cache_sim *sim = tlb_create((int)tl[0][a], (int)tl[1][b], pagesize);
+            if (sim && cache_set_policy(sim, tpolicy) != 0) {
+                cache_destroy(sim);
+                sim = NULL;
+            }
+            if (sim) {
+                sims[ncache + ntlb++] = sim;
+            } else {
+                fprintf(stderr, "Skipping TLB %ld:%ld\n", tl[0][a], tl[1][b]);
+            }
+        }
+    }
+
+    addr_trace *t = ncache > 0 && ntlb > 0 ? addr_trace_open(path, format, mode) : NULL;
+    sweep_result res;
+    if (t && sweep_run(t, sims, ncache + ntlb, threads, &res) == 0) {
+        printf("size,line,way,nsets,tlb_entries,tlb_way,accesses,writes,cache_misses,cache_miss_rate,"
+               "tlb_misses,tlb_miss_rate\n");
+        for (int c = 0; c < ncache; c++) {
+            const cache_sim *C = sims[c];
+            for (int k = ncache; k < ncache + ntlb; k++) {
+                const cache_sim *T = sims[k];
+                printf("%ld,%d,%d,%d,%d,%d,%llu,%llu,%llu,%.6f,%llu,%.6f\n", C->size, C->line, C->way, C->nsets,
+                       T->nsets * T->way, T->way, (unsigned long long)res.accesses,
+                       (unsigned long long)res.writes, (unsigned long long)C->misses,
+                       res.accesses ? (double)C->misses / res.accesses : 0.0, (unsigned long long)T->misses,
+                       res.accesses ? (double)T->misses / res.accesses : 0.0);
+            }
+        }
+        fprintf(stderr, "Sweep: %d caches x %d TLBs, %llu accesses in %llu chunks, %d threads, %.3f s, "
+                        "%.2f M simulated accesses/s\n",
+                ncache, ntlb, (unsigned long long)res.accesses, (unsigned long long)res.chunks, threads,
+                res.seconds,
+                res.seconds > 0.0 ? (double)res.accesses * (ncache + ntlb) / res.seconds * 1e-6 : 0.0);
+        if (addr_trace_errors(t) > 0) {
+            fprintf(stderr, "Warning: %llu malformed records skipped\n", (unsigned long long)addr_trace_errors(t));
+        }
+        status = 0;
+    } else if (ncache == 0 || ntlb == 0) {
+        fprintf(stderr, "No valid configuration to sweep\n");
+    }
+    if (t) {
+        addr_trace_close(t);
+    }
+    for (int k = 0; k < ncache + ntlb; k++) {
+        cache_destroy(sims[k]);
+    }
+    free(sims);
+    return status;
+}
+
+/*!
+ * \brief Reads the trace at \p path once ahead of the replay to build the next-use
+ *        indexes of the cache (\p copt) and TLB (\p topt) that use OPT.
+ * \return 0 on success, -1 (with a message) otherwise.
+ */
+static int build_opt(const char *path, int format, int mode, opt_index *copt, opt_index *topt) {
+    if (strcmp(path, "-") == 0) {
+        fprintf(stderr, "OPT reads the trace twice and cannot take it from stdin\n");
+        return -1;
+    }
+    addr_trace *t = addr_trace_open(path, format, mode);
+    mem_access *batch = malloc(TRACE_BATCH * sizeof(mem_access));
+    int status = t && batch ? 0 : -1;
+    size_t n;
+
+    trace_begin("opt_index");
+    while (status == 0 && (n = addr_trace_read(t, batch, TRACE_BATCH)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            if ((copt && opt_add(copt, batch[i].addr) != 0) || (topt && opt_add(topt, batch[i].addr) != 0)) {
+                fprintf(stderr, "Cannot allocate the OPT next-use index\n");
+                status = -1;
+                break;
+            }
+        }
+    }
+    trace_end("opt_index");
+    if (copt) opt_finish(copt);
+    if (topt) opt_finish(topt);
+    free(batch);
+    if (t) addr_trace_close(t);
+    return status;
+}
+
+/*!
+ * \brief Simulates one access: TLB and single cache through ac(), or the TLB (or \p m, counting
+ *        its L1 dTLB misses in dtlb) followed by the prefetching cache or the hierarchy.
+ */
+static inline void access_one(hierarchy *h, prefetcher *pf, mmu *m, unsigned long addr, uint64_t pc,
+                              int write) {
+    if (!h && !pf && !m) {
+        ac(addr);
+        return;
+    }
+    am++;
+    if (m ? mmu_access(m, addr) : tlb_access(addr))
+        dtlb++;
+    if (h) {
+        hier_access(h, addr, pc, write);
+    } else if (pf ? pf_access(pf, addr, pc) : cache_access(addr)) {
+        dc++;
+    }
+}
+
+/*!
+ * \brief Replays each kernel of \p names (comma-separated, or "all"), and each block size of
+ *        \p bls for the blocked ones, through a fresh cache (or hierarchy) and TLB, and prints
+ *        one row of predicted misses per run.
+ * \return 0 on success, 1 (with a message) otherwise.
+ */
+static int run_kernels(const char *names, const kg_config *base, const long *bls, int nbl,
+                       const level_config *levels, int nlevels, double mem_latency, const pf_config *pf_cfg,
+                       const mmu_config *mmu_cfg) {
+    int kernels[KG_COUNT], nk = 0;
+    char buf[512];
+    char *save = NULL, *name;
+    mem_access *batch = malloc(TRACE_BATCH * sizeof(mem_access));
+
+    if (snprintf(buf, sizeof(buf), "%s", names) >= (int)sizeof(buf) || !batch) {
+        fprintf(stderr, "Invalid kernel list '%s'\n", names);
+        free(batch);
+        return 1;
+    }
+    for (name = strtok_r(buf, ",", &save); name; name = strtok_r(NULL, ",", &save)) {
+        if (strcmp(name, "all") == 0) {
+            for (nk = 0; nk < KG_COUNT; nk++) {
+                kernels[nk] = nk;
+            }
+        } else if (nk == KG_COUNT || (kernels[nk++] = kg_parse(name)) < 0) {
+            fprintf(stderr, "Unknown kernel '%s'\n", name);
+            free(batch);
+            return 1;
+        }
+    }
+
+    printf("%-24s %6s %5s %14s %14s %9s %14s %9s", "Kernel", "N", "BL", "Accesses", "Cache misses", "Miss%",
+           "TLB misses", "Miss%");
+    if (nlevels > 0) printf(" %14s %9s", "Memory reads", "AMAT");
+    if (mmu_cfg) printf(" %14s %9s", "Walks", "Xlate/acc");
+    printf("\n");
+    for (int q = 0; q < nk; q++) {
+        for (int b = 0; b < (kg_uses_bl(kernels[q]) ? nbl : 1); b++) {
+            kg_config cfg = *base;
+            hierarchy hier, *h = NULL;
+            prefetcher *pf = NULL;
+            mmu tr, *m = NULL;
+            kg_gen g;
+            size_t n;
+
+            cfg.kernel = kernels[q];
+            cfg.bl = (int)bls[b];
+            if (kg_init(&g, &cfg) != 0) {
+                fprintf(stderr, "Invalid kernel configuration\n");
+                free(batch);
+                return 1;
+            }
+            if (nlevels > 0) {
+                if (hier_init(&hier, levels, nlevels, mem_latency) != 0) {
+                    free(batch);
+                    return 1;
+                }
+                h = &hier;
+            }
+            initcache();
+            inittlb();
+            if (pf_cfg->kind != PF_NONE && !(pf = pf_create(pf_cfg, cache_default()))) {
+                fprintf(stderr, "Cannot allocate the prefetcher\n");
+                free(batch);
+                return 1;
+            }
+            if (mmu_cfg) {
+                if (mmu_init(&tr, mmu_cfg, tpolicy) != 0) {
+                    pf_destroy(pf);
+                    free(batch);
+                    return 1;
+                }
+                m = &tr;
+            }
+            while ((n = kg_read(&g, batch, TRACE_BATCH)) > 0) {
+                for (size_t i = 0; i < n; i++) {
+                    access_one(h, pf, m, batch[i].addr, batch[i].pc, batch[i].write);
+                }
+            }
+            if (g.emitted != kg_count(&cfg)) {
+                fprintf(stderr, "Warning: %s (N=%d, BL=%d) generated %llu accesses, %llu expected\n",
+                        kg_name(cfg.kernel), cfg.n, cfg.bl, (unsigned long long)g.emitted,
+                        (unsigned long long)kg_count(&cfg));
+            }
+            unsigned long misses = h ? (unsigned long)(hier.level[0].st.read_misses + hier.level[0].st.write_misses)
+                                     : dc;
+            char bl[16] = "-";
+            if (kg_uses_bl(cfg.kernel)) {
+                snprintf(bl, sizeof(bl), "%d", cfg.bl);
+            }
+            printf("%-24s %6d %5s %14lu %14lu %9.4f %14lu %9.4f", kg_name(cfg.kernel), cfg.n, bl, am, misses,
+                   am ? 100.0 * misses / am : 0.0, dtlb, am ? 100.0 * dtlb / am : 0.0);
+            if (h) {
+                printf(" %14llu %9.3f", (unsigned long long)hier.mem_reads, hier_amat(h));
+                hier_free(h);
+            }
+            if (m) {
+                printf(" %14llu %9.3f", (unsigned long long)tr.st.walks, mmu_cycles_per_access(m));
+                mmu_free(m);
+            }
+            printf("\n");
+            pf_destroy(pf);
+        }
+    }
+    free(batch);
+    return 0;
+}
+
+/*!
+ * \brief Prints the estimated cache and TLB misses of a sampled replay and, if \p full holds the
+ *        fully simulated cache and TLB, the error of each estimate.
+ */
+static void print_sampled(const sampler *sp, cache_sim *const full[2], FILE *out) {
+    static const char *const labels[2] = { "Cache misses:  ", "TLB misses:    " };
+    const int policies[2] = { policy, tpolicy };
+
+    sampler_print(sp, out);
+    for (int k = 0; k < 2; k++) {
+        sample_estimate e;
+        sampler_estimate(sp, k, &e);
+        fprintf(out, "%s%.0f", labels[k], e.misses);
+        if (e.exact) {
+            fprintf(out, " (%.4f%%, %s, every set simulated)\n",
+                    am ? 100.0 * e.misses / am : 0.0, repl_name(policies[k]));
+        } else if (e.half < 0.0) {
+            fprintf(out, " +/- n/a (%.4f%%, %s, estimated from %llu units)\n",
+                    am ? 100.0 * e.misses / am : 0.0, repl_name(policies[k]), (unsigned long long)e.units);
+        } else {
+            fprintf(out, " +/- %.0f (%.4f%% +/- %.4f%%, %s, estimated from %llu units)\n", e.half,
+                    am ? 100.0 * e.misses / am : 0.0, am ? 100.0 * e.half / am : 0.0, repl_name(policies[k]),
+                    (unsigned long long)e.units);
+        }
+        if (full[k]) {
+            const double actual = (double)full[k]->misses;
+            fprintf(out, "  simulated:   %.0f (estimate off by %+.0f, %+.3f%%%s)\n", actual, e.misses - actual,
+                    actual > 0.0 ? 100.0 * (e.misses - actual) / actual : 0.0,
+                    e.exact ? "" : e.half < 0.0 ? ", no interval"
+                                 : e.misses - e.half <= actual && actual <= e.misses + e.half ? ", inside the interval"
+                                                                                               : ", outside the interval");
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int format = TRACE_AUTO, out_format = TRACE_VTR, mode = TRACE_MMAP, random = 200, opt;
+    level_config levels[HIER_MAX_LEVELS];
+    int nlevels = 0;
+    double mem_latency = 200.0;
+    hierarchy hier, *h = NULL;
+    pf_config pf_cfg = { PF_NONE, 0, 0, 0 };
+    prefetcher *pf = NULL;
+    mmu_config mmu_cfg;
+    mmu tr, *m = NULL;
+    int use_mmu = 0;
+    sample_config scfg;
+    sampler samp, *sp = NULL;
+    int sampling = 0, validate = 0;
+    cache_sim *full[2] = { NULL, NULL };
+    const char *sweep_spec = NULL, *sweep_tlb = NULL;
+    int threads = 1;
+    const char *mrc_sets = NULL;
+    int mrc = 0, mrc_ways = 16;
+    long mrc_max = 64L << 20, bench = 0;
+    double shards = 1.0;
+    stack_dist *sd = NULL;
+    const char *kernels = NULL;
+    kg_config kcfg;
+    long kbl[SWEEP_MAX_VALUES] = { 16 };
+    int nkbl = 1, kn = 500, kelem = 4;
+    const char *kbase = NULL;
+    const char *convert = NULL, *trace_path = NULL;
+    static const struct option long_options[] = {
+        { "format", required_argument, NULL, 'f' },
+        { "stream", no_argument, NULL, 'S' },
+        { "cache", required_argument, NULL, 'c' },
+        { "tlb", required_argument, NULL, 't' },
+        { "policy", required_argument, NULL, 'P' },
+        { "tlb-policy", required_argument, NULL, 'p' },
+        { "prefetch", required_argument, NULL, 'R' },
+        { "convert", required_argument, NULL, 'o' },
+        { "out-format", required_argument, NULL, 'F' },
+        { "random", required_argument, NULL, 'r' },
+        { "trace", required_argument, NULL, 'T' },
+        { "level", required_argument, NULL, 'L' },
+        { "mem-latency", required_argument, NULL, 'M' },
+        { "sweep", required_argument, NULL, 's' },
+        { "sweep-tlb", required_argument, NULL, 'e' },
+        { "threads", required_argument, NULL, 'j' },
+        { "mrc", optional_argument, NULL, 'm' },
+        { "mrc-ways", required_argument, NULL, 'W' },
+        { "mrc-max", required_argument, NULL, 'X' },
+        { "shards", required_argument, NULL, 'H' },
+        { "kernel", required_argument, NULL, 'K' },
+        { "kernel-n", required_argument, NULL, 'n' },
+        { "kernel-bl", required_argument, NULL, 'b' },
+        { "kernel-elem", required_argument, NULL, 'z' },
+        { "kernel-base", required_argument, NULL, 'A' },
+        { "mmu", optional_argument, NULL, 'U' },
+        { "region", required_argument, NULL, OPT_REGION },
+        { "page-default", required_argument, NULL, OPT_PAGE_DEFAULT },
+        { "sample", required_argument, NULL, 'Q' },
+        { "sample-validate", no_argument, NULL, OPT_SAMPLE_VALIDATE },
+        { "bench", optional_argument, NULL, 'B' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    mmu_defaults(&mmu_cfg);
 
-int main(void)
-{
     /* Configure the data cache. */
     size = 4096;     /* 4 KB total cache size */
     line = 16;       /* line size in bytes */
     way  = 1;        /* direct-mapped cache */
-    initcache();     /* init with above parameters */
 
     /* Configure the TLB. */
     tsize = 8;       /* 8 total TLB entries */
     tway  = 1;       /* direct-mapped TLB */
+
+    while ((opt = getopt_long(argc, argv, "f:Sc:t:P:p:R:o:F:r:T:L:M:s:e:j:m::W:X:H:K:n:b:z:A:U::Q:B::h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'f':
+            if ((format = trace_parse_format(optarg)) == -2) {
+                fprintf(stderr, "Unknown trace format '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'S': mode = TRACE_STREAM; break;
+        case 'c':
+            if (sscanf(optarg, "%d:%d:%d", &size, &line, &way) != 3) {
+                fprintf(stderr, "Invalid cache '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 't':
+            if (sscanf(optarg, "%d:%d", &tsize, &tway) != 2) {
+                fprintf(stderr, "Invalid TLB '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'P':
+        case 'p':
+            if ((*(opt == 'P' ? &policy : &tpolicy) = repl_parse(optarg)) < 0) {
+                fprintf(stderr, "Unknown replacement policy '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'o': convert = optarg; break;
+        case 'F':
+            if ((out_format = trace_parse_format(optarg)) < 0) {
+                fprintf(stderr, "Unknown output format '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'r': random = atoi(optarg); break;
+        case 'R':
+            if (pf_parse(optarg, &pf_cfg) != 0) {
+                fprintf(stderr, "Invalid prefetcher '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'T': trace_path = optarg; break;
+        case 'L':
+            if (nlevels == HIER_MAX_LEVELS || level_parse(optarg, &levels[nlevels]) != 0) {
+                fprintf(stderr, "Invalid level '%s' (at most %d levels)\n", optarg, HIER_MAX_LEVELS);
+                return 1;
+            }
+            nlevels++;
+            break;
+        case 'M': mem_latency = atof(optarg); break;
+        case 's': sweep_spec = optarg; break;
+        case 'e': sweep_tlb = optarg; break;
+        case 'j': threads = atoi(optarg); break;
+        case 'm': mrc = 1; mrc_sets = optarg; break;
+        case 'W': mrc_ways = atoi(optarg); break;
+        case 'X':
+            if (parse_list(optarg, &mrc_max, 1) != 1) {
+                fprintf(stderr, "Invalid size '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'H': shards = atof(optarg); break;
+        case 'K': kernels = optarg; break;
+        case 'n': kn = atoi(optarg); break;
+        case 'b':
+            if ((nkbl = parse_list(optarg, kbl, SWEEP_MAX_VALUES)) < 0) {
+                fprintf(stderr, "Invalid block sizes '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'z': kelem = atoi(optarg); break;
+        case 'A': kbase = optarg; break;
+        case 'U':
+            use_mmu = 1;
+            if (optarg && mmu_parse(optarg, &mmu_cfg) != 0) {
+                fprintf(stderr, "Invalid translation structures '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case OPT_REGION:
+            use_mmu = 1;
+            if (mmu_add_region(&mmu_cfg, optarg) != 0) {
+                fprintf(stderr, "Invalid region '%s' (START:LEN:SIZE, at most %d)\n", optarg, MMU_MAX_REGIONS);
+                return 1;
+            }
+            break;
+        case OPT_PAGE_DEFAULT:
+            use_mmu = 1;
+            if ((mmu_cfg.default_size = mmu_parse_size(optarg)) < 0) {
+                fprintf(stderr, "Invalid page size '%s' (4K, 2M or 1G)\n", optarg);
+                return 1;
+            }
+            break;
+        case 'Q':
+            sampling = 1;
+            if (sample_parse(optarg, &scfg) != 0) {
+                fprintf(stderr, "Invalid sampling '%s' (RATIO[:WINDOW:PERIOD[:WARMUP]])\n", optarg);
+                return 1;
+            }
+            break;
+        case OPT_SAMPLE_VALIDATE: validate = 1; break;
+        case 'B':
+            bench = 20L << 20;
+            if (optarg && parse_list(optarg, &bench, 1) != 1) {
+                fprintf(stderr, "Invalid count '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        default: usage(argv[0]); return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (bench > 0) {
+        cache_bench((uint64_t)bench, stdout);
+        return 0;
+    }
+    if (check_config() != 0) {
+        return 1;
+    }
+    if (sweep_spec && (optind >= argc || nlevels > 0 || convert || mrc || threads <= 0 || policy == REPL_OPT ||
+                       tpolicy == REPL_OPT)) {
+        fprintf(stderr, "--sweep needs a trace, at least one thread, and no --level, --convert, --mrc or opt\n");
+        return 1;
+    }
+    if (pf_cfg.kind != PF_NONE && (sweep_spec || nlevels > 0 || policy == REPL_OPT)) {
+        fprintf(stderr, "--prefetch applies to the single cache and not with opt (use pf= in --level)\n");
+        return 1;
+    }
+    if (kernels && (optind < argc || sweep_spec || convert || mrc || policy == REPL_OPT || tpolicy == REPL_OPT)) {
+        fprintf(stderr, "--kernel replaces the trace and does not combine with --sweep, --convert, --mrc or opt\n");
+        return 1;
+    }
+    if (use_mmu && (sweep_spec || tpolicy == REPL_OPT)) {
+        fprintf(stderr, "--mmu does not combine with --sweep or an opt TLB\n");
+        return 1;
+    }
+    if (validate && !sampling) {
+        fprintf(stderr, "--sample-validate needs --sample\n");
+        return 1;
+    }
+    if (sampling && (optind >= argc || sweep_spec || nlevels > 0 || pf_cfg.kind != PF_NONE || kernels ||
+                     use_mmu || policy == REPL_OPT || tpolicy == REPL_OPT)) {
+        fprintf(stderr, "--sample needs a trace and applies to the single cache and TLB (no --sweep, --level, "
+                        "--prefetch, --kernel, --mmu or opt)\n");
+        return 1;
+    }
+    if ((policy == REPL_OPT || tpolicy == REPL_OPT) && optind >= argc) {
+        fprintf(stderr, "The opt policy needs a trace\n");
+        return 1;
+    }
+    if (trace_path && trace_init(trace_path, sweep_spec ? threads + 1 : 2) != 0) {
+        fprintf(stderr, "Cannot allocate trace buffers\n");
+        return 1;
+    }
+    if (mrc) {
+        long sets[SD_MAX_SETCOUNTS];
+        int setcounts[SD_MAX_SETCOUNTS], n = mrc_sets ? parse_list(mrc_sets, sets, SD_MAX_SETCOUNTS) : 0;
+        if (n < 0) {
+            fprintf(stderr, "Invalid set counts '%s' (at most %d)\n", mrc_sets, SD_MAX_SETCOUNTS);
+            return 1;
+        }
+        for (int k = 0; k < n; k++) {
+            setcounts[k] = (int)sets[k];
+        }
+        if (!(sd = sd_create(line, (uint64_t)mrc_max, shards, setcounts, n, mrc_ways))) {
+            return 1;
+        }
+    }
+    if (kernels) {
+        kg_defaults(&kcfg, 0, kn);
+        kcfg.elem = kelem;
+        if (kn <= 0 || kelem <= 0) {
+            fprintf(stderr, "Invalid kernel size %d or element size %d\n", kn, kelem);
+            return 1;
+        }
+        kg_layout(&kcfg);
+        if (kbase && kg_parse_bases(kbase, &kcfg) != 0) {
+            fprintf(stderr, "Invalid buffer addresses '%s'\n", kbase);
+            return 1;
+        }
+        return run_kernels(kernels, &kcfg, kbl, nkbl, levels, nlevels, mem_latency, &pf_cfg,
+                           use_mmu ? &mmu_cfg : NULL);
+    }
+    if (sweep_spec) {
+        return run_sweep(argv[optind], format, mode, sweep_spec, sweep_tlb, threads);
+    }
+    if (nlevels > 0) {
+        if (hier_init(&hier, levels, nlevels, mem_latency) != 0) {
+            return 1;
+        }
+        h = &hier;
+    }
+    initcache();     /* init with above parameters */
     inittlb();       /* init TLB */
+    if (pf_cfg.kind != PF_NONE && !(pf = pf_create(&pf_cfg, cache_default()))) {
+        fprintf(stderr, "Cannot allocate the prefetcher\n");
+        sd_destroy(sd);
+        return 1;
+    }
+    if (use_mmu) {
+        if (mmu_init(&tr, &mmu_cfg, tpolicy) != 0) {
+            pf_destroy(pf);
+            sd_destroy(sd);
+            return 1;
+        }
+        m = &tr;
+    }
+    if (sampling) {
+        if (validate) {
+            full[0] = cache_create(size, line, way);
+            full[1] = tlb_create(tsize, tway, pagesize);
+        }
+        if ((validate && (!full[0] || !full[1] || cache_set_policy(full[0], policy) != 0 ||
+                          cache_set_policy(full[1], tpolicy) != 0)) ||
+            sampler_init(&samp, &scfg, cache_default(), tlb_default()) != 0) {
+            fprintf(stderr, "Cannot allocate the sampler\n");
+            cache_destroy(full[0]);
+            cache_destroy(full[1]);
+            sd_destroy(sd);
+            return 1;
+        }
+        sp = &samp;
+        if (scfg.period && (scfg.warmup < (uint64_t)(size / line) || scfg.warmup < (uint64_t)tsize)) {
+            fprintf(stderr, "Warning: the warm-up (%llu accesses) is shorter than the cache (%d lines) or TLB "
+                            "(%d entries); stale state biases the estimates beyond their intervals\n",
+                    (unsigned long long)scfg.warmup, size / line, tsize);
+        }
+    }
 
-    /* Let's do 200 random accesses. */
-    for(int i=0; i<200; i++){
-        unsigned long addr = rand() % 65536; /* random 16-bit address */
-        ac(addr);
+    if (optind >= argc) {
+        /* No trace: random accesses. */
+        for (int i = 0; i < random; i++) {
+            unsigned long addr = rand() % 65536; /* random 16-bit address */
+            access_one(h, pf, m, addr, 0, 0);
+            if (sd) sd_access(sd, addr);
+        }
+        printf("Accesses:      %lu\n", am);
+        if (h) {
+            hier_print(h, stdout);
+            hier_free(h);
+        } else {
+            printf("Cache misses:  %lu\n", dc);
+            if (pf) pf_print(pf, "Cache", dc, stdout);
+        }
+        pf_destroy(pf);
+        if (m) {
+            mmu_print(m, stdout);
+            mmu_free(m);
+        } else {
+            printf("TLB misses:    %lu\n", dtlb);
+        }
+        if (sd) {
+            printf("\n");
+            sd_print(sd, stdout);
+            sd_destroy(sd);
+        }
+        return 0;
     }
 
-    printf("Accesses:      %d\n", am);
-    printf("Cache misses:  %d\n", dc);
-    printf("TLB misses:    %d\n", dtlb);
+    opt_index *copt = policy == REPL_OPT && !h ? opt_create(line) : NULL;
+    opt_index *topt = tpolicy == REPL_OPT ? opt_create(pagesize) : NULL;
+    if (((policy == REPL_OPT && !h && !copt) || (tpolicy == REPL_OPT && !topt)) ||
+        ((copt || topt) && build_opt(argv[optind], format, mode, copt, topt) != 0)) {
+        opt_destroy(copt);
+        opt_destroy(topt);
+        if (h) hier_free(h);
+        pf_destroy(pf);
+        if (m) mmu_free(m);
+        sd_destroy(sd);
+        return 1;
+    }
+    uint64_t pos = 0;
 
-    return 0;
+    addr_trace *t = addr_trace_open(argv[optind], format, mode);
+    if (!t) {
+        opt_destroy(copt);
+        opt_destroy(topt);
+        if (h) hier_free(h);
+        pf_destroy(pf);
+        if (m) mmu_free(m);
+        sd_destroy(sd);
+        return 1;
+    }
+    trace_writer *w = NULL;
+    if (convert && !(w = trace_writer_open(convert, out_format, addr_trace_has_pc(t)))) {
+        addr_trace_close(t);
+        opt_destroy(copt);
+        opt_destroy(topt);
+        if (h) hier_free(h);
+        pf_destroy(pf);
+        if (m) mmu_free(m);
+        sd_destroy(sd);
+        return 1;
+    }
+
+    mem_access *batch = malloc(TRACE_BATCH * sizeof(mem_access));
+    unsigned long writes = 0;
+    int status = 0;
+    double start = now_seconds();
+    for (;;) {
+        trace_begin("trace_read");
+        size_t n = batch ? addr_trace_read(t, batch, TRACE_BATCH) : 0;
+        trace_end("trace_read");
+        if (n == 0) {
+            break;
+        }
+        trace_begin("simulate");
+        for (size_t i = 0; i < n; i++, pos++) {
+            if (copt) cache_default()->next_use = pos < copt->n ? copt->next[pos] : OPT_NEVER;
+            if (topt) tlb_default()->next_use = pos < topt->n ? topt->next[pos] : OPT_NEVER;
+            if (sp) {
+                sampler_access(sp, batch[i].addr);
+                for (int k = 0; full[0] && k < 2; k++) {
+                    cache_lookup(full[k], batch[i].addr);
+                }
+            } else {
+                access_one(h, pf, m, batch[i].addr, batch[i].pc, batch[i].write);
+            }
+            writes += batch[i].write;
+        }
+        for (size_t i = 0; sd && i < n; i++) {
+            if (sd_access(sd, batch[i].addr) != 0) {
+                fprintf(stderr, "Stack-distance analysis out of memory, curve dropped\n");
+                sd_destroy(sd);
+                sd = NULL;
+                status = 1;
+            }
+        }
+        trace_end("simulate");
+        for (size_t i = 0; w && i < n; i++) {
+            if (trace_writer_put(w, &batch[i]) != 0) {
+                fprintf(stderr, "Cannot write %s\n", convert);
+                trace_writer_close(w);
+                w = NULL;
+                status = 1;
+            }
+        }
+    }
+    double elapsed = now_seconds() - start;
+    if (sp) {
+        am = (unsigned long)sp->accesses;
+    }
+
+    printf("Trace:         %s (%s, %s, %llu bytes)\n", argv[optind], trace_format_name(addr_trace_format(t)),
+           addr_trace_mapped(t) ? "mmap" : "stream", (unsigned long long)addr_trace_bytes(t));
+    printf("Accesses:      %lu (%lu writes)\n", am, writes);
+    if (sp) {
+        print_sampled(sp, full, stdout);
+    } else if (h) {
+        hier_print(h, stdout);
+    } else {
+        printf("Cache misses:  %lu (%.4f%%, %s)\n", dc, am ? 100.0 * dc / am : 0.0, repl_name(policy));
+        if (pf) pf_print(pf, "Cache", dc, stdout);
+    }
+    if (m) {
+        mmu_print(m, stdout);
+    } else if (!sp) {
+        printf("TLB misses:    %lu (%.4f%%, %s)\n", dtlb, am ? 100.0 * dtlb / am : 0.0, repl_name(tpolicy));
+    }
+    printf("Throughput:    %.3f s, %.2f M accesses/s, %.1f MB/s\n", elapsed,
+           elapsed > 0.0 ? am / elapsed * 1e-6 : 0.0,
+           elapsed > 0.0 ? addr_trace_bytes(t) / elapsed * 1e-6 : 0.0);
+    if (addr_trace_errors(t) > 0) {
+        fprintf(stderr, "Warning: %llu malformed records skipped\n", (unsigned long long)addr_trace_errors(t));
+    }
+    if (!batch) {
+        fprintf(stderr, "Cannot allocate the access batch\n");
+        status = 1;
+    }
+    if (w && trace_writer_close(w) != 0) {
+        fprintf(stderr, "Cannot write %s\n", convert);
+        status = 1;
+    }
+    free(batch);
+    addr_trace_close(t);
+    opt_destroy(copt);
+    opt_destroy(topt);
+    pf_destroy(pf);
+    if (sp) {
+        sampler_free(sp);
+    }
+    cache_destroy(full[0]);
+    cache_destroy(full[1]);
+    if (m) {
+        mmu_free(m);
+    }
+    if (h) {
+        hier_free(h);
+    }
+    if (sd) {
+        printf("\n");
+        sd_print(sd, stdout);
+        sd_destroy(sd);
+    }
+    return status;
 }
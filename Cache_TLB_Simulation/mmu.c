@@ -0,0 +1,269 @@
+/*!
+ * \file mmu.c
+ * \brief Implementation of the multi-page-size translation model.
+ */
+
+#include "mmu.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/*! \brief log2 of each page size. */
+static const int page_shift[PAGE_SIZES] = { 12, 21, 30 };
+
+static const char *const page_names[PAGE_SIZES] = { "4K", "2M", "1G" };
+
+/*! \brief log2 of the span of an entry of each paging-structure cache. */
+static const int pwc_shift[PWC_LEVELS] = { 39, 30, 21 };
+
+static const char *const pwc_names[PWC_LEVELS] = { "PML4E", "PDPTE", "PDE" };
+
+/*! \brief Distinguishes the 2 MB entries of the STLB from the 4 KB ones (above any page number). */
+#define STLB_2M_FLAG (1ULL << 56)
+
+/* ----------------------------------------------------------------
+   Configuration
+   ---------------------------------------------------------------- */
+
+void mmu_defaults(mmu_config *cfg) {
+    static const int entries[PAGE_SIZES] = { 64, 32, 4 };
+
+    memset(cfg, 0, sizeof(*cfg));
+    for (int s = 0; s < PAGE_SIZES; s++) {
+        cfg->l1_entries[s] = entries[s];
+        cfg->l1_ways[s] = 4;
+    }
+    cfg->stlb_entries = 1536;
+    cfg->stlb_ways = 12;
+    cfg->pwc_entries[PWC_PML4E] = 2;
+    cfg->pwc_entries[PWC_PDPTE] = 4;
+    cfg->pwc_entries[PWC_PDE] = 32;
+    cfg->stlb_latency = 7.0;
+    cfg->walk_latency = 30.0;
+    cfg->default_size = PAGE_4K;
+}
+
+int mmu_parse_size(const char *s) {
+    for (int p = 0; p < PAGE_SIZES; p++) {
+        if (strcasecmp(s, page_names[p]) == 0) {
+            return p;
+        }
+    }
+    return -1;
+}
+
+int mmu_parse(const char *spec, mmu_config *cfg) {
+    char buf[256];
+    char *save = NULL, *tok;
+
+    if (snprintf(buf, sizeof(buf), "%s", spec) >= (int)sizeof(buf)) {
+        return -1;
+    }
+    for (tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        char *val = strchr(tok, '=');
+        int a, b, c, used = 0;
+        if (!val) {
+            return -1;
+        }
+        *val++ = '\0';
+        if (strncmp(tok, "l1-", 3) == 0) {
+            int s = mmu_parse_size(tok + 3);
+            if (s < 0 || sscanf(val, "%d:%d%n", &a, &b, &used) != 2 || val[used] || a < 0 || b <= 0) return -1;
+            cfg->l1_entries[s] = a;
+            cfg->l1_ways[s] = b;
+        } else if (strcmp(tok, "stlb") == 0) {
+            if (sscanf(val, "%d:%d%n", &a, &b, &used) != 2 || val[used] || a < 0 || b <= 0) return -1;
+            cfg->stlb_entries = a;
+            cfg->stlb_ways = b;
+        } else if (strcmp(tok, "pwc") == 0) {
+            if (sscanf(val, "%d:%d:%d%n", &a, &b, &c, &used) != 3 || val[used] || a < 0 || b < 0 || c < 0)
+                return -1;
+            cfg->pwc_entries[PWC_PML4E] = a;
+            cfg->pwc_entries[PWC_PDPTE] = b;
+            cfg->pwc_entries[PWC_PDE] = c;
+        } else if (strcmp(tok, "stlb-lat") == 0 || strcmp(tok, "walk-lat") == 0) {
+            double v;
+            if (sscanf(val, "%lf%n", &v, &used) != 1 || val[used] || v < 0.0) return -1;
+            *(tok[0] == 's' ? &cfg->stlb_latency : &cfg->walk_latency) = v;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int mmu_add_region(mmu_config *cfg, const char *spec) {
+    char *end;
+    uint64_t start = strtoull(spec, &end, 0), len;
+
+    if (end == spec || *end != ':' || cfg->nregions == MMU_MAX_REGIONS) {
+        return -1;
+    }
+    spec = end + 1;
+    len = strtoull(spec, &end, 0);
+    switch (*end) {
+    case 'K': case 'k': len <<= 10; end++; break;
+    case 'M': case 'm': len <<= 20; end++; break;
+    case 'G': case 'g': len <<= 30; end++; break;
+    default: break;
+    }
+    int size = *end == ':' ? mmu_parse_size(end + 1) : -1;
+    if (end == spec || len == 0 || size < 0) {
+        return -1;
+    }
+    cfg->region[cfg->nregions++] = (mmu_region){ start, start + len, size };
+    return 0;
+}
+
+int mmu_page_size(const mmu_config *cfg, uint64_t addr) {
+    for (int r = 0; r < cfg->nregions; r++) {
+        if (addr >= cfg->region[r].start && addr < cfg->region[r].end) {
+            return cfg->region[r].size;
+        }
+    }
+    return cfg->default_size;
+}
+
+/* ----------------------------------------------------------------
+   Creation
+   ---------------------------------------------------------------- */
+
+/*!
+ * \brief A structure of \p entries page numbers (line 1), or NULL with *ok cleared on failure.
+ */
+static cache_sim *create(int entries, int ways, int policy, int *ok) {
+    cache_sim *c = tlb_create(entries, ways, 1);
+    if (!c || cache_set_policy(c, policy) != 0) {
+        cache_destroy(c);
+        *ok = 0;
+        return NULL;
+    }
+    return c;
+}
+
+int mmu_init(mmu *m, const mmu_config *cfg, int policy) {
+    int ok = 1;
+
+    memset(m, 0, sizeof(*m));
+    m->cfg = *cfg;
+    for (int s = 0; s < PAGE_SIZES; s++) {
+        if (cfg->l1_entries[s] > 0) {
+            m->l1[s] = create(cfg->l1_entries[s], cfg->l1_ways[s], policy, &ok);
+        }
+    }
+    if (cfg->stlb_entries > 0) {
+        m->stlb = create(cfg->stlb_entries, cfg->stlb_ways, policy, &ok);
+    }
+    for (int l = 0; l < PWC_LEVELS; l++) {
+        if (cfg->pwc_entries[l] > 0) {
+            m->pwc[l] = create(cfg->pwc_entries[l], cfg->pwc_entries[l], policy, &ok);
+        }
+    }
+    if (!ok || policy == REPL_OPT) {
+        fprintf(stderr, "Invalid translation structures (entries must be multiples of ways, policy not opt)\n");
+        mmu_free(m);
+        return -1;
+    }
+    return 0;
+}
+
+void mmu_free(mmu *m) {
+    for (int s = 0; s < PAGE_SIZES; s++) {
+        cache_destroy(m->l1[s]);
+        m->l1[s] = NULL;
+    }
+    cache_destroy(m->stlb);
+    m->stlb = NULL;
+    for (int l = 0; l < PWC_LEVELS; l++) {
+        cache_destroy(m->pwc[l]);
+        m->pwc[l] = NULL;
+    }
+}
+
+/* ----------------------------------------------------------------
+   Translation
+   ---------------------------------------------------------------- */
+
+/*!
+ * \brief Walks the page table for a page of size \p size: the table reads are those below the
+ *        deepest paging-structure cache hit, then every cache on the path learns its entry.
+ */
+static void walk(mmu *m, uint64_t addr, int size) {
+    /* Levels whose entries point to a table on the way to this page: PML4E always, PDPTE
+       unless the page is 1 GB, PDE only for 4 KB pages. */
+    const int last = PWC_LEVELS - 1 - size;
+    int refs = last + 2, deepest = -1;
+
+    for (int l = last; l >= 0; l--) {
+        if (m->pwc[l] && cache_find(m->pwc[l], addr >> pwc_shift[l]) >= 0) {
+            deepest = l;
+            break;
+        }
+    }
+    if (deepest >= 0) {
+        m->st.pwc_hits[deepest]++;
+        refs = last - deepest + 1;
+    }
+    for (int l = 0; l <= last; l++) {
+        if (m->pwc[l]) {
+            cache_lookup(m->pwc[l], addr >> pwc_shift[l]);
+        }
+    }
+    m->st.walks++;
+    m->st.walk_refs += (uint64_t)refs;
+    m->st.cycles += refs * m->cfg.walk_latency;
+}
+
+int mmu_access(mmu *m, uint64_t addr) {
+    const int size = mmu_page_size(&m->cfg, addr);
+    const uint64_t vpn = addr >> page_shift[size];
+
+    m->st.accesses++;
+    m->st.pages[size]++;
+    if (m->l1[size] && !cache_lookup(m->l1[size], vpn)) {
+        return 0;
+    }
+    m->st.l1_misses[size]++;
+    if (m->stlb && size != PAGE_1G) {
+        m->st.cycles += m->cfg.stlb_latency;
+        if (!cache_lookup(m->stlb, size == PAGE_2M ? vpn | STLB_2M_FLAG : vpn)) {
+            return 1;
+        }
+    }
+    m->st.stlb_misses++;
+    walk(m, addr, size);
+    return 1;
+}
+
+double mmu_cycles_per_access(const mmu *m) {
+    return m->st.accesses ? m->st.cycles / (double)m->st.accesses : 0.0;
+}
+
+void mmu_print(const mmu *m, FILE *out) {
+    const mmu_stats *s = &m->st;
+
+    fprintf(out, "%-8s %12s %14s %14s %9s\n", "dTLB", "Entries:Ways", "Accesses", "Misses", "Miss%");
+    for (int p = 0; p < PAGE_SIZES; p++) {
+        char geom[32] = "-";
+        if (m->l1[p]) {
+            snprintf(geom, sizeof(geom), "%d:%d", m->cfg.l1_entries[p], m->cfg.l1_ways[p]);
+        }
+        fprintf(out, "L1 %-5s %12s %14llu %14llu %9.4f\n", page_names[p], geom, (unsigned long long)s->pages[p],
+                (unsigned long long)s->l1_misses[p], s->pages[p] ? 100.0 * s->l1_misses[p] / s->pages[p] : 0.0);
+    }
+    if (m->stlb) {
+        char geom[32];
+        snprintf(geom, sizeof(geom), "%d:%d", m->cfg.stlb_entries, m->cfg.stlb_ways);
+        fprintf(out, "%-8s %12s %14llu %14llu %9.4f\n", "STLB", geom, (unsigned long long)m->stlb->accesses,
+                (unsigned long long)m->stlb->misses,
+                m->stlb->accesses ? 100.0 * m->stlb->misses / m->stlb->accesses : 0.0);
+    }
+    fprintf(out, "Walks:         %llu (%.4f%% of accesses), %llu table reads (%.2f per walk), PWC hits",
+            (unsigned long long)s->walks, s->accesses ? 100.0 * s->walks / s->accesses : 0.0,
+            (unsigned long long)s->walk_refs, s->walks ? (double)s->walk_refs / s->walks : 0.0);
+    for (int l = 0; l < PWC_LEVELS; l++) {
+        fprintf(out, " %s %llu", pwc_names[l], (unsigned long long)s->pwc_hits[l]);
+    }
+    fprintf(out, "\nTranslation:   %.0f cycles, %.3f per access (STLB %.0f, table read %.0f cycles)\n", s->cycles,
+            mmu_cycles_per_access(m), m->cfg.stlb_latency, m->cfg.walk_latency);
+}
@@ -0,0 +1,154 @@
+/*!
+ * \file mmu.h
+ * \brief Multi-page-size address translation: per-size L1 dTLBs, a unified
+ *        STLB, paging-structure caches and an estimated page-walk cost.
+ *
+ * Every address belongs to a 4 KB, 2 MB or 1 GB page, chosen by a region
+ * table (the first region containing it, else the default size), so
+ * transparent huge pages or MADV_HUGEPAGE ranges can be described. A
+ * translation looks up the L1 dTLB of its page size; on a miss, the STLB,
+ * which holds 4 KB and 2 MB entries (1 GB entries go straight to the
+ * walk); on a miss, the x86-64 four-level page table is walked. The
+ * paging-structure caches keep the PML4E (512 GB), PDPTE (1 GB) and PDE
+ * (2 MB) entries pointing to the next table, so a walk only reads the
+ * levels below the deepest hit. Each table read costs a fixed number of
+ * cycles, and each STLB lookup its latency. All structures are cache
+ * objects indexed by page number.
+ */
+
+#ifndef MMU_H
+#define MMU_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "cache_tlb_sim.h"
+
+/*! \brief Maximum entries of the region table. */
+#define MMU_MAX_REGIONS 64
+
+/*! \brief Page sizes. */
+typedef enum {
+    PAGE_4K = 0,
+    PAGE_2M = 1,
+    PAGE_1G = 2,
+    PAGE_SIZES
+} page_size;
+
+/*! \brief Levels of the paging-structure caches, outermost first. */
+typedef enum {
+    PWC_PML4E = 0,
+    PWC_PDPTE = 1,
+    PWC_PDE = 2,
+    PWC_LEVELS
+} pwc_level;
+
+/*!
+ * \brief Address range mapped with one page size.
+ */
+typedef struct {
+    uint64_t start;
+    uint64_t end;  /*!< Exclusive */
+    int size;      /*!< page_size */
+} mmu_region;
+
+/*!
+ * \brief Geometry and costs of the translation structures.
+ */
+typedef struct {
+    int l1_entries[PAGE_SIZES];   /*!< L1 dTLB entries per page size */
+    int l1_ways[PAGE_SIZES];
+    int stlb_entries, stlb_ways;  /*!< Unified 4 KB / 2 MB STLB (0 entries: none) */
+    int pwc_entries[PWC_LEVELS];  /*!< Fully associative paging-structure caches (0: none) */
+    double stlb_latency;          /*!< Cycles of an STLB lookup */
+    double walk_latency;          /*!< Cycles per page-table read of a walk */
+    int default_size;             /*!< page_size outside the regions */
+    int nregions;
+    mmu_region region[MMU_MAX_REGIONS];
+} mmu_config;
+
+/*!
+ * \brief Translation counters.
+ */
+typedef struct {
+    uint64_t accesses;
+    uint64_t l1_misses[PAGE_SIZES]; /*!< Per page size */
+    uint64_t pages[PAGE_SIZES];     /*!< Accesses per page size */
+    uint64_t stlb_misses;
+    uint64_t walks;
+    uint64_t walk_refs;             /*!< Page-table reads of all walks */
+    uint64_t pwc_hits[PWC_LEVELS];  /*!< Walks whose deepest cached entry was this level */
+    double cycles;                  /*!< STLB lookups and walks */
+} mmu_stats;
+
+/*!
+ * \brief The translation structures.
+ */
+typedef struct {
+    mmu_config cfg;
+    cache_sim *l1[PAGE_SIZES];
+    cache_sim *stlb;                /*!< NULL if none */
+    cache_sim *pwc[PWC_LEVELS];     /*!< NULL if none */
+    mmu_stats st;
+} mmu;
+
+/*!
+ * \brief Fills \p cfg with the defaults: a recent x86-64 core (L1 dTLBs 64:4 for 4 KB, 32:4 for
+ *        2 MB and 4:4 for 1 GB pages, STLB 1536:12, paging-structure caches 2, 4 and 32 entries,
+ *        STLB 7 cycles, 30 cycles per table read), 4 KB pages everywhere.
+ */
+void mmu_defaults(mmu_config *cfg);
+
+/*!
+ * \brief Applies "KEY=VALUE,..." to \p cfg, KEY being l1-4k, l1-2m or l1-1g (ENTRIES:WAYS), stlb
+ *        (ENTRIES:WAYS), pwc (PML4E:PDPTE:PDE entries), stlb-lat or walk-lat (cycles).
+ * \return 0 on success, -1 if malformed.
+ */
+int mmu_parse(const char *spec, mmu_config *cfg);
+
+/*!
+ * \brief Parses "4K", "2M" or "1G".
+ * \return The page_size, or -1.
+ */
+int mmu_parse_size(const char *s);
+
+/*!
+ * \brief Appends the region "START:LENGTH:SIZE" (START and LENGTH decimal or 0x hex, LENGTH
+ *        with an optional K/M/G suffix; SIZE as for mmu_parse_size()).
+ * \return 0 on success, -1 if malformed or the table is full.
+ */
+int mmu_add_region(mmu_config *cfg, const char *spec);
+
+/*!
+ * \brief Creates the structures, with \p policy (a repl_policy other than REPL_OPT) as their
+ *        replacement.
+ * \return 0 on success, -1 (with a message on stderr) otherwise.
+ */
+int mmu_init(mmu *m, const mmu_config *cfg, int policy);
+
+/*!
+ * \brief Releases the structures.
+ */
+void mmu_free(mmu *m);
+
+/*!
+ * \brief Page size of \p addr.
+ */
+int mmu_page_size(const mmu_config *cfg, uint64_t addr);
+
+/*!
+ * \brief Translates \p addr.
+ * \return 1 on an L1 dTLB miss, 0 otherwise.
+ */
+int mmu_access(mmu *m, uint64_t addr);
+
+/*!
+ * \brief Average translation cycles per access.
+ */
+double mmu_cycles_per_access(const mmu *m);
+
+/*!
+ * \brief Prints the structures and their counters.
+ */
+void mmu_print(const mmu *m, FILE *out);
+
+#endif
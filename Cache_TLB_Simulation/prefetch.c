@@ -0,0 +1,305 @@
+/*!
+ * \file prefetch.c
+ * \brief Implementation of the prefetcher models.
+ */
+
+#include "prefetch.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*! \brief Free stream tracker / filter slot. */
+#define PF_FREE (~(uint64_t)0)
+
+static const char *const kind_names[] = { "none", "next", "stride", "stream" };
+
+/* ----------------------------------------------------------------
+   Configuration
+   ---------------------------------------------------------------- */
+
+int pf_parse(const char *spec, pf_config *cfg) {
+    char kind[16];
+    int fields[3] = { 1, 1, 16 }, n = 0;
+    size_t len = strcspn(spec, ":/");
+
+    if (len == 0 || len >= sizeof(kind)) {
+        return -1;
+    }
+    memcpy(kind, spec, len);
+    kind[len] = '\0';
+    memset(cfg, 0, sizeof(*cfg));
+    for (int k = PF_NEXT_LINE; k <= PF_STREAM; k++) {
+        if (strcmp(kind, kind_names[k]) == 0) {
+            cfg->kind = k;
+        }
+    }
+    for (spec += len; *spec; n++) {
+        char *end;
+        if (n == 3) {
+            return -1;
+        }
+        fields[n] = (int)strtol(spec + 1, &end, 10);
+        if (end == spec + 1 || (*end && *end != ':' && *end != '/')) {
+            return -1;
+        }
+        spec = end;
+    }
+    cfg->degree = fields[0];
+    cfg->distance = fields[1];
+    cfg->latency = fields[2];
+    return cfg->kind != PF_NONE && cfg->degree > 0 && cfg->degree <= PF_MAX_DEGREE && cfg->distance > 0 &&
+                   cfg->latency >= 0
+               ? 0
+               : -1;
+}
+
+const char *pf_name(int kind) {
+    return kind >= PF_NONE && kind <= PF_STREAM ? kind_names[kind] : "?";
+}
+
+prefetcher *pf_create(const pf_config *cfg, cache_sim *c) {
+    size_t n = (size_t)c->nsets * c->way;
+    prefetcher *p = calloc(1, sizeof(prefetcher));
+
+    if (!p) {
+        return NULL;
+    }
+    p->cfg = *cfg;
+    p->c = c;
+    p->flag = calloc(n, 1);
+    p->ready = calloc(n, sizeof(uint64_t));
+    p->victims = malloc(PF_FILTER * sizeof(uint64_t));
+    if (!p->flag || !p->ready || !p->victims) {
+        pf_destroy(p);
+        return NULL;
+    }
+    memset(p->victims, 0xff, PF_FILTER * sizeof(uint64_t));
+    for (int i = 0; i < PF_STRIDE_TABLE; i++) {
+        p->stride[i].pc = PF_FREE;
+    }
+    for (int i = 0; i < PF_STREAMS; i++) {
+        p->stream[i].region = PF_FREE;
+    }
+    return p;
+}
+
+void pf_destroy(prefetcher *p) {
+    if (p) {
+        free(p->flag);
+        free(p->ready);
+        free(p->victims);
+        free(p);
+    }
+}
+
+/* ----------------------------------------------------------------
+   Bookkeeping
+   ---------------------------------------------------------------- */
+
+int pf_hit(prefetcher *p, long k) {
+    if (!p->flag[k]) {
+        return 0;
+    }
+    p->flag[k] = 0;
+    if (p->now >= p->ready[k]) {
+        p->st.useful++;
+        return PF_USEFUL;
+    }
+    p->st.late++;
+    return PF_LATE;
+}
+
+void pf_miss(prefetcher *p, uint64_t ln) {
+    uint64_t *v = &p->victims[ln % PF_FILTER];
+    if (*v == ln) {
+        p->st.polluting++;
+        *v = PF_FREE;
+    }
+}
+
+void pf_evict(prefetcher *p, long k, uint64_t ln, int by_prefetch) {
+    if (p->flag[k]) {
+        p->st.useless++;
+        p->flag[k] = 0;
+    }
+    if (by_prefetch) {
+        p->victims[ln % PF_FILTER] = ln;
+    }
+}
+
+void pf_filled(prefetcher *p, long k, int prefetch) {
+    p->flag[k] = (unsigned char)prefetch;
+    p->ready[k] = p->now + (uint64_t)p->cfg.latency;
+}
+
+/* ----------------------------------------------------------------
+   Models (each proposes line numbers; pf_train() turns them into addresses)
+   ---------------------------------------------------------------- */
+
+static int train_next_line(prefetcher *p, uint64_t ln, int trigger, uint64_t *out) {
+    if (!trigger) {
+        return 0;
+    }
+    for (int j = 0; j < p->cfg.degree; j++) {
+        out[j] = ln + (uint64_t)(p->cfg.distance + j);
+    }
+    return p->cfg.degree;
+}
+
+static int train_stride(prefetcher *p, uint64_t addr, uint64_t pc, uint64_t *out) {
+    pf_stride_entry *e = &p->stride[(pc ^ (pc >> 8) ^ (pc >> 16)) % PF_STRIDE_TABLE];
+    const uint64_t line = (uint64_t)p->c->line;
+    int n = 0;
+
+    if (e->pc != pc) {
+        e->pc = pc;
+        e->last = addr;
+        e->stride = 0;
+        e->conf = 0;
+        return 0;
+    }
+    int64_t d = (int64_t)(addr - e->last);
+    if (d == e->stride) {
+        if (e->conf < 3) e->conf++;
+    } else {
+        e->stride = d;
+        e->conf = 0;
+    }
+    e->last = addr;
+    if (e->conf < 2 || d == 0) {
+        return 0;
+    }
+    uint64_t prev = addr / line;
+    for (int j = 0; j < p->cfg.degree; j++) {
+        int64_t a = (int64_t)addr + d * (p->cfg.distance + j);
+        if (a < 0) {
+            break;
+        }
+        uint64_t ln = (uint64_t)a / line;
+        if (ln != prev) { /* strides shorter than a line repeat lines */
+            out[n++] = ln;
+            prev = ln;
+        }
+    }
+    return n;
+}
+
+static int train_stream(prefetcher *p, uint64_t addr, uint64_t ln, int trigger, uint64_t *out) {
+    const uint64_t region = addr / PF_REGION;
+    pf_stream *s = NULL, *lru = &p->stream[0];
+    int n = 0;
+
+    for (int i = 0; i < PF_STREAMS; i++) {
+        if (p->stream[i].region == region) {
+            s = &p->stream[i];
+            break;
+        }
+        if (p->stream[i].used < lru->used) {
+            lru = &p->stream[i];
+        }
+    }
+    if (!s) {
+        if (trigger) {
+            *lru = (pf_stream){ region, ln, ln, 0, 0, p->now };
+        }
+        return 0;
+    }
+    s->used = p->now;
+    if (ln == s->last) {
+        return 0;
+    }
+    int dir = ln > s->last ? 1 : -1;
+    if (dir == s->dir) {
+        if (s->conf < 3) s->conf++;
+    } else {
+        s->dir = dir;
+        s->conf = 1;
+        s->head = ln;
+    }
+    s->last = ln;
+    if (s->conf < 2) {
+        return 0;
+    }
+    /* Keep the window [ln + distance, ln + distance + degree) ahead, continuing from the head. */
+    const int64_t first = (int64_t)ln + dir * p->cfg.distance, end = first + dir * (p->cfg.degree - 1);
+    int64_t cand = dir > 0 ? (first > (int64_t)s->head ? first : (int64_t)s->head + 1)
+                           : (first < (int64_t)s->head ? first : (int64_t)s->head - 1);
+    for (; n < p->cfg.degree && cand >= 0 && dir * (end - cand) >= 0; cand += dir) {
+        out[n++] = (uint64_t)cand;
+        s->head = (uint64_t)cand;
+    }
+    return n;
+}
+
+int pf_train(prefetcher *p, uint64_t addr, uint64_t pc, int trigger, uint64_t *out) {
+    const uint64_t ln = cache_line_of(p->c, addr);
+    int n = 0;
+
+    p->now++;
+    switch (p->cfg.kind) {
+    case PF_NEXT_LINE: n = train_next_line(p, ln, trigger, out); break;
+    case PF_STRIDE: n = train_stride(p, addr, pc, out); break;
+    case PF_STREAM: n = train_stream(p, addr, ln, trigger, out); break;
+    default: break;
+    }
+    for (int j = 0; j < n; j++) {
+        out[j] *= (uint64_t)p->c->line;
+    }
+    return n;
+}
+
+/* ----------------------------------------------------------------
+   Standalone cache
+   ---------------------------------------------------------------- */
+
+int pf_access(prefetcher *p, uint64_t addr, uint64_t pc) {
+    cache_sim *c = p->c;
+    uint64_t cand[PF_MAX_DEGREE], evicted;
+    long k = cache_find(c, addr);
+    int miss = k < 0, trigger;
+
+    c->accesses++;
+    if (!miss) {
+        cache_touch(c, k);
+        trigger = pf_hit(p, k);
+        if (trigger == PF_LATE) {
+            /* The data is still on its way: the access waits for it like a miss. */
+            c->misses++;
+            miss = 1;
+        }
+    } else {
+        c->misses++;
+        pf_miss(p, cache_line_of(c, addr));
+        k = cache_fill(c, addr, &evicted);
+        if (evicted != CACHE_INVALID) {
+            pf_evict(p, k, evicted, 0);
+        }
+        pf_filled(p, k, 0);
+        trigger = 1;
+    }
+    int n = pf_train(p, addr, pc, trigger, cand);
+    for (int j = 0; j < n; j++) {
+        if (cache_find(c, cand[j]) >= 0) {
+            p->st.redundant++;
+            continue;
+        }
+        k = cache_fill(c, cand[j], &evicted);
+        if (evicted != CACHE_INVALID) {
+            pf_evict(p, k, evicted, 1);
+        }
+        pf_filled(p, k, 1);
+        p->st.issued++;
+    }
+    return miss;
+}
+
+void pf_print(const prefetcher *p, const char *name, uint64_t misses, FILE *out) {
+    const pf_stats *s = &p->st;
+    fprintf(out,
+            "%s prefetch (%s, degree %d, distance %d, latency %d): issued %llu, redundant %llu, useful %llu, "
+            "late %llu, useless %llu, polluting %llu, accuracy %.2f%%, coverage %.2f%%\n",
+            name, pf_name(p->cfg.kind), p->cfg.degree, p->cfg.distance, p->cfg.latency,
+            (unsigned long long)s->issued, (unsigned long long)s->redundant, (unsigned long long)s->useful,
+            (unsigned long long)s->late, (unsigned long long)s->useless, (unsigned long long)s->polluting,
+            s->issued ? 100.0 * (s->useful + s->late) / s->issued : 0.0,
+            s->useful + misses ? 100.0 * s->useful / (s->useful + misses) : 0.0);
+}
@@ -0,0 +1,190 @@
+/*!
+ * \file prefetch.h
+ * \brief Hardware prefetcher models attached to a cache object.
+ *
+ * A prefetcher watches the demand accesses of one cache, proposes lines to
+ * fetch ahead and tracks what happens to them:
+ *  - next: tagged next-line; on a miss or on the first use of a prefetched
+ *    line, fetches the \c degree lines starting \c distance lines ahead;
+ *  - stride: IP-stride; a table indexed by the PC of the access learns the
+ *    stride of each instruction and, once confirmed twice, fetches
+ *    \c degree strides starting \c distance strides ahead (traces without
+ *    PCs share one entry, i.e. a global stride detector);
+ *  - stream: up to PF_STREAMS trackers, one per PF_REGION-byte region,
+ *    learn an ascending or descending direction and, once confirmed, run
+ *    \c degree lines ahead of the accesses, starting \c distance lines out.
+ * Prefetched data arrives \c latency demand accesses after the request. A
+ * demand hit on a prefetched line is useful if the data had arrived and
+ * late otherwise, in which case the access still waits for the data and
+ * counts as a demand miss; a prefetched line evicted unused is useless; a demand
+ * miss on a line that a prefetch evicted (remembered in a small filter)
+ * is polluting. Prefetches of lines already present are redundant and not
+ * issued.
+ */
+
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "cache_tlb_sim.h"
+
+/*! \brief Entries of the IP-stride table. */
+#define PF_STRIDE_TABLE 256
+
+/*! \brief Stream trackers. */
+#define PF_STREAMS 16
+
+/*! \brief Bytes of the region a stream tracker follows. */
+#define PF_REGION 4096
+
+/*! \brief Entries of the filter of lines evicted by prefetches (direct mapped). */
+#define PF_FILTER 4096
+
+/*! \brief Largest degree. */
+#define PF_MAX_DEGREE 64
+
+/*! \brief pf_hit() result: first use of a prefetched line whose data had arrived. */
+#define PF_USEFUL 1
+
+/*! \brief pf_hit() result: first use of a prefetched line still in flight. */
+#define PF_LATE 2
+
+/*! \brief Prefetcher models. */
+typedef enum {
+    PF_NONE = 0,
+    PF_NEXT_LINE,
+    PF_STRIDE,
+    PF_STREAM
+} pf_kind;
+
+/*!
+ * \brief Model and parameters of a prefetcher.
+ */
+typedef struct {
+    int kind;     /*!< pf_kind */
+    int degree;   /*!< Lines (or strides) fetched per trigger */
+    int distance; /*!< How far ahead the first one is, in lines (strides for stride) */
+    int latency;  /*!< Demand accesses before prefetched data arrives */
+} pf_config;
+
+/*!
+ * \brief Prefetch counters.
+ */
+typedef struct {
+    uint64_t issued;    /*!< Prefetches sent to the next level */
+    uint64_t redundant; /*!< Candidates already in the cache, not issued */
+    uint64_t useful;    /*!< Demand hits on prefetched lines that had arrived */
+    uint64_t late;      /*!< Demand hits on prefetched lines still in flight */
+    uint64_t useless;   /*!< Prefetched lines evicted or invalidated unused */
+    uint64_t polluting; /*!< Demand misses on lines evicted by a prefetch */
+} pf_stats;
+
+/*! \brief IP-stride table entry. */
+typedef struct {
+    uint64_t pc;
+    uint64_t last;   /*!< Last address */
+    int64_t stride;
+    int conf;        /*!< 0..3, prefetches from 2 */
+} pf_stride_entry;
+
+/*! \brief Stream tracker. */
+typedef struct {
+    uint64_t region; /*!< addr / PF_REGION, ~0 if free */
+    uint64_t last;   /*!< Last line accessed */
+    uint64_t head;   /*!< Furthest line prefetched */
+    int dir;         /*!< +1, -1, or 0 while untrained */
+    int conf;
+    uint64_t used;   /*!< Time of last use (LRU among trackers) */
+} pf_stream;
+
+/*!
+ * \brief A prefetcher and its per-way bookkeeping in the cache it fills.
+ */
+typedef struct {
+    pf_config cfg;
+    cache_sim *c;
+    unsigned char *flag; /*!< [nsets*way] 1 while a prefetched line is unused */
+    uint64_t *ready;     /*!< [nsets*way] demand time its data arrives */
+    uint64_t *victims;   /*!< [PF_FILTER] lines evicted by prefetches */
+    pf_stride_entry stride[PF_STRIDE_TABLE];
+    pf_stream stream[PF_STREAMS];
+    uint64_t now;        /*!< Demand accesses seen */
+    pf_stats st;
+} prefetcher;
+
+/*!
+ * \brief Parses "KIND[:DEGREE[:DISTANCE[:LATENCY]]]" (fields may also be separated by '/'),
+ *        KIND being next, stride or stream (default degree 1, distance 1, latency 16).
+ * \return 0 on success, -1 if malformed.
+ */
+int pf_parse(const char *spec, pf_config *cfg);
+
+/*!
+ * \brief Name of a pf_kind.
+ */
+const char *pf_name(int kind);
+
+/*!
+ * \brief Creates a prefetcher filling \p c.
+ * \return The prefetcher, or NULL if out of memory.
+ */
+prefetcher *pf_create(const pf_config *cfg, cache_sim *c);
+
+/*!
+ * \brief Releases a prefetcher (NULL is ignored).
+ */
+void pf_destroy(prefetcher *p);
+
+/* ----------------------------------------------------------------
+   Hooks for a cache whose fills are driven elsewhere (hierarchy.c)
+   ---------------------------------------------------------------- */
+
+/*!
+ * \brief Demand hit on way \p k.
+ * \return PF_USEFUL or PF_LATE if it was the first use of a prefetched line, 0 otherwise.
+ */
+int pf_hit(prefetcher *p, long k);
+
+/*!
+ * \brief Demand miss of line number \p ln.
+ */
+void pf_miss(prefetcher *p, uint64_t ln);
+
+/*!
+ * \brief Way \p k, holding line number \p ln, is evicted (\p by_prefetch: to make room for a
+ *        prefetch) or invalidated.
+ */
+void pf_evict(prefetcher *p, long k, uint64_t ln, int by_prefetch);
+
+/*!
+ * \brief Way \p k was just filled by a demand access (\p prefetch = 0) or a prefetch.
+ */
+void pf_filled(prefetcher *p, long k, int prefetch);
+
+/*!
+ * \brief Trains on a demand access and proposes addresses to prefetch.
+ * \param trigger 1 on a miss or on the first use of a prefetched line.
+ * \param out Receives up to cfg.degree addresses.
+ * \return The number of addresses proposed.
+ */
+int pf_train(prefetcher *p, uint64_t addr, uint64_t pc, int trigger, uint64_t *out);
+
+/* ----------------------------------------------------------------
+   Standalone cache
+   ---------------------------------------------------------------- */
+
+/*!
+ * \brief One demand access to the prefetcher's cache, followed by the prefetches it triggers.
+ * \return 1 if the demand access missed or hit a late prefetch, 0 otherwise.
+ */
+int pf_access(prefetcher *p, uint64_t addr, uint64_t pc);
+
+/*!
+ * \brief Prints the counters on one line, with accuracy ((useful + late) / issued) and
+ *        coverage (useful / (useful + \p misses), \p misses being the remaining demand misses,
+ *        late prefetches included).
+ */
+void pf_print(const prefetcher *p, const char *name, uint64_t misses, FILE *out);
+
+#endif
@@ -0,0 +1,330 @@
+/*!
+ * \file replacement.c
+ * \brief Implementation of the replacement policies and of the OPT next-use index.
+ */
+
+#include "replacement.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*! \brief Empty slot of the next-use hash table. */
+#define OPT_EMPTY (~(uint64_t)0)
+
+static inline uint64_t next_random(cache_sim *c) {
+    uint64_t x = c->rng;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return c->rng = x;
+}
+
+/*!
+ * \brief First empty way of the set at \p base, or -1.
+ */
+static inline int empty_way(const cache_sim *c, long base) {
+    for (int w = 0; w < c->way; w++) {
+        if (c->tags[base + w] == CACHE_INVALID) {
+            return w;
+        }
+    }
+    return -1;
+}
+
+static void hit_none(cache_sim *c, long base, int w) {
+    (void)c;
+    (void)base;
+    (void)w;
+}
+
+static void reset_zero(cache_sim *c, long base) {
+    memset(c->rank + base, 0, (size_t)c->way * sizeof(uint16_t));
+}
+
+/* ----------------------------------------------------------------
+   Random
+   ---------------------------------------------------------------- */
+
+static int random_insert(cache_sim *c, long base) {
+    int w = empty_way(c, base);
+    return w >= 0 ? w : (int)(next_random(c) % (uint64_t)c->way);
+}
+
+/* ----------------------------------------------------------------
+   Tree pseudo-LRU
+   ---------------------------------------------------------------- */
+
+/*
+ * Node i of the tree (0 is the root, i < way - 1) has children 2i+1 and
+ * 2i+2; leaf way w is node w + way - 1. A node's bit says which subtree
+ * to evict from: 0 left, 1 right.
+ */
+
+/*!
+ * \brief Points every node on the path to way \p w away from it.
+ */
+static void plru_hit(cache_sim *c, long base, int w) {
+    uint16_t *bit = c->rank + base;
+    for (int n = w + c->way - 1; n > 0;) {
+        int parent = (n - 1) / 2;
+        bit[parent] = n == 2 * parent + 1; /* came from the left: evict right next */
+        n = parent;
+    }
+}
+
+static int plru_insert(cache_sim *c, long base) {
+    const uint16_t *bit = c->rank + base;
+    int w = empty_way(c, base);
+    if (w < 0) {
+        int n = 0;
+        while (n < c->way - 1) {
+            n = 2 * n + 1 + bit[n];
+        }
+        w = n - (c->way - 1);
+    }
+    plru_hit(c, base, w);
+    return w;
+}
+
+/* ----------------------------------------------------------------
+   RRIP
+   ---------------------------------------------------------------- */
+
+static void rrip_reset(cache_sim *c, long base) {
+    for (int w = 0; w < c->way; w++) {
+        c->rank[base + w] = RRIP_MAX;
+    }
+}
+
+static void rrip_hit(cache_sim *c, long base, int w) {
+    c->rank[base + w] = 0;
+}
+
+/*!
+ * \brief Empty way, or the first way predicted "distant" after ageing the set as needed.
+ */
+static int rrip_victim(cache_sim *c, long base) {
+    uint16_t *rrpv = c->rank + base;
+    int w = empty_way(c, base);
+    if (w >= 0) {
+        return w;
+    }
+    for (;;) {
+        for (w = 0; w < c->way; w++) {
+            if (rrpv[w] == RRIP_MAX) {
+                return w;
+            }
+        }
+        for (w = 0; w < c->way; w++) {
+            rrpv[w]++;
+        }
+    }
+}
+
+/*!
+ * \brief Fills a way with the SRRIP (\p bimodal = 0) or BRRIP (\p bimodal = 1) insertion value.
+ */
+static int rrip_fill(cache_sim *c, long base, int bimodal) {
+    int w = rrip_victim(c, base);
+    c->rank[base + w] = bimodal && next_random(c) % 32 != 0 ? RRIP_MAX : RRIP_MAX - 1;
+    return w;
+}
+
+static int srrip_insert(cache_sim *c, long base) {
+    return rrip_fill(c, base, 0);
+}
+
+static int brrip_insert(cache_sim *c, long base) {
+    return rrip_fill(c, base, 1);
+}
+
+/*!
+ * \brief Set dueling: a miss in an SRRIP leader votes for BRRIP and the other way round.
+ */
+static int drrip_insert(cache_sim *c, long base) {
+    long set = base / c->way;
+    int bimodal;
+    switch (set % RRIP_DUEL_PERIOD) {
+    case 0:
+        bimodal = 0;
+        if (c->psel < RRIP_PSEL_MAX) c->psel++;
+        break;
+    case 1:
+        bimodal = 1;
+        if (c->psel > 0) c->psel--;
+        break;
+    default:
+        bimodal = c->psel > RRIP_PSEL_MAX / 2;
+        break;
+    }
+    return rrip_fill(c, base, bimodal);
+}
+
+static void rrip_invalidate(cache_sim *c, long base, int w) {
+    c->rank[base + w] = RRIP_MAX;
+}
+
+/* ----------------------------------------------------------------
+   Belady OPT
+   ---------------------------------------------------------------- */
+
+static void opt_reset(cache_sim *c, long base) {
+    for (int w = 0; w < c->way; w++) {
+        c->next[base + w] = OPT_NEVER;
+    }
+}
+
+static void opt_hit(cache_sim *c, long base, int w) {
+    c->next[base + w] = c->next_use;
+}
+
+static int opt_insert(cache_sim *c, long base) {
+    const uint64_t *next = c->next + base;
+    int w = empty_way(c, base);
+    if (w < 0) {
+        w = 0;
+        for (int i = 1; i < c->way; i++) {
+            if (next[i] > next[w]) {
+                w = i;
+            }
+        }
+    }
+    c->next[base + w] = c->next_use;
+    return w;
+}
+
+static void opt_invalidate(cache_sim *c, long base, int w) {
+    c->next[base + w] = OPT_NEVER;
+}
+
+/* ----------------------------------------------------------------
+   Registry
+   ---------------------------------------------------------------- */
+
+static const repl_ops policies[REPL_COUNT] = {
+    [REPL_LRU] = { "lru", rank_reset, rank_promote, rank_replace, rank_demote },
+    [REPL_FIFO] = { "fifo", rank_reset, hit_none, rank_replace, rank_demote },
+    [REPL_RANDOM] = { "random", reset_zero, hit_none, random_insert, hit_none },
+    [REPL_PLRU] = { "plru", reset_zero, plru_hit, plru_insert, hit_none },
+    [REPL_SRRIP] = { "srrip", rrip_reset, rrip_hit, srrip_insert, rrip_invalidate },
+    [REPL_BRRIP] = { "brrip", rrip_reset, rrip_hit, brrip_insert, rrip_invalidate },
+    [REPL_DRRIP] = { "drrip", rrip_reset, rrip_hit, drrip_insert, rrip_invalidate },
+    [REPL_OPT] = { "opt", opt_reset, opt_hit, opt_insert, opt_invalidate },
+};
+
+const repl_ops *repl_ops_of(int policy) {
+    return policy >= 0 && policy < REPL_COUNT ? &policies[policy] : NULL;
+}
+
+int repl_parse(const char *name) {
+    for (int p = 0; p < REPL_COUNT; p++) {
+        if (strcmp(name, policies[p].name) == 0) {
+            return p;
+        }
+    }
+    return -1;
+}
+
+const char *repl_name(int policy) {
+    return policy >= 0 && policy < REPL_COUNT ? policies[policy].name : "?";
+}
+
+/* ----------------------------------------------------------------
+   Next-use index
+   ---------------------------------------------------------------- */
+
+static inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static uint64_t *slot_of(const opt_index *o, uint64_t ln) {
+    uint64_t mask = o->hcap - 1;
+    for (uint64_t i = mix64(ln) & mask;; i = (i + 1) & mask) {
+        if (o->keys[i] == ln || o->keys[i] == OPT_EMPTY) {
+            return &o->keys[i];
+        }
+    }
+}
+
+static int grow_table(opt_index *o) {
+    uint64_t *keys = o->keys, *last = o->last, old = o->hcap;
+
+    o->hcap = old ? old * 2 : 1024;
+    o->keys = malloc(o->hcap * sizeof(uint64_t));
+    o->last = malloc(o->hcap * sizeof(uint64_t));
+    if (!o->keys || !o->last) {
+        free(o->keys);
+        free(o->last);
+        o->keys = keys;
+        o->last = last;
+        o->hcap = old;
+        return -1;
+    }
+    memset(o->keys, 0xff, o->hcap * sizeof(uint64_t));
+    for (uint64_t i = 0; i < old; i++) {
+        if (keys[i] != OPT_EMPTY) {
+            uint64_t *k = slot_of(o, keys[i]);
+            *k = keys[i];
+            o->last[k - o->keys] = last[i];
+        }
+    }
+    free(keys);
+    free(last);
+    return 0;
+}
+
+opt_index *opt_create(int line) {
+    opt_index *o = calloc(1, sizeof(opt_index));
+    if (!o || grow_table(o) != 0) {
+        free(o);
+        return NULL;
+    }
+    o->line = line;
+    return o;
+}
+
+int opt_add(opt_index *o, uint64_t addr) {
+    uint64_t ln = addr / (uint64_t)o->line;
+
+    if (o->n == o->cap) {
+        uint64_t cap = o->cap ? o->cap * 2 : 1 << 20;
+        uint64_t *next = realloc(o->next, cap * sizeof(uint64_t));
+        if (!next) {
+            return -1;
+        }
+        o->next = next;
+        o->cap = cap;
+    }
+    if (2 * (o->hcount + 1) > o->hcap && grow_table(o) != 0) {
+        return -1;
+    }
+    uint64_t *k = slot_of(o, ln);
+    uint64_t *t = &o->last[k - o->keys];
+    if (*k == OPT_EMPTY) {
+        *k = ln;
+        o->hcount++;
+    } else {
+        o->next[*t] = o->n;
+    }
+    *t = o->n;
+    o->next[o->n++] = OPT_NEVER;
+    return 0;
+}
+
+void opt_finish(opt_index *o) {
+    free(o->keys);
+    free(o->last);
+    o->keys = o->last = NULL;
+    o->hcap = o->hcount = 0;
+}
+
+void opt_destroy(opt_index *o) {
+    if (o) {
+        opt_finish(o);
+        free(o->next);
+        free(o);
+    }
+}
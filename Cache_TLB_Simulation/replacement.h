@@ -0,0 +1,116 @@
+/*!
+ * \file replacement.h
+ * \brief Replacement policies of the cache object (cache_sim).
+ *
+ * A policy keeps its per-way state in cache_sim::rank (and, for OPT, in
+ * cache_sim::next) and is driven through four hooks called with the index
+ * of the first way of a set. Every policy fills empty ways before evicting.
+ *  - lru: 16-bit recency rank per way (the fast path of cache_lookup());
+ *  - fifo: the same ranks, not updated on hits;
+ *  - random: uniform victim (xorshift, per cache);
+ *  - plru: tree pseudo-LRU, one bit per internal node (power-of-two ways);
+ *  - srrip / brrip: 2-bit re-reference prediction values, inserted at
+ *    "long" (2) or, for BRRIP, at "distant" (3) except 1 in 32;
+ *  - drrip: SRRIP and BRRIP leader sets (1 in 32 each) duel through a
+ *    10-bit saturating counter that decides for the follower sets;
+ *  - opt: Belady's MIN, evicting the line reused farthest in the future;
+ *    the caller stores the next use of each access in cache_sim::next_use
+ *    (see opt_index) before the lookup.
+ */
+
+#ifndef REPLACEMENT_H
+#define REPLACEMENT_H
+
+#include <stdint.h>
+#include "cache_tlb_sim.h"
+
+/*! \brief Next use of a line never accessed again. */
+#define OPT_NEVER (~(uint64_t)0)
+
+/*! \brief Maximum re-reference prediction value of the RRIP policies (2 bits). */
+#define RRIP_MAX 3
+
+/*! \brief One set in RRIP_DUEL_PERIOD leads for SRRIP and one for BRRIP. */
+#define RRIP_DUEL_PERIOD 32
+
+/*! \brief Saturation value of the DRRIP selection counter (10 bits). */
+#define RRIP_PSEL_MAX 1023
+
+/*!
+ * \brief Hooks of a replacement policy.
+ */
+typedef struct repl_ops {
+    const char *name;
+    void (*reset)(cache_sim *c, long base);              /*!< Initial state of an empty set */
+    void (*hit)(cache_sim *c, long base, int w);         /*!< Way \p w hit */
+    int (*insert)(cache_sim *c, long base);              /*!< Chooses the way receiving a new line and sets its state */
+    void (*invalidate)(cache_sim *c, long base, int w);  /*!< Way \p w emptied */
+} repl_ops;
+
+/*!
+ * \brief Hooks of \p policy (a repl_policy).
+ */
+const repl_ops *repl_ops_of(int policy);
+
+/*!
+ * \brief Policy named \p name, or -1 if unknown.
+ */
+int repl_parse(const char *name);
+
+/*!
+ * \brief Name of \p policy.
+ */
+const char *repl_name(int policy);
+
+/* ----------------------------------------------------------------
+   Recency ranks (LRU and FIFO), implemented in cache_tlb_sim.c
+   ---------------------------------------------------------------- */
+
+void rank_reset(cache_sim *c, long base);
+void rank_promote(cache_sim *c, long base, int w);
+int rank_replace(cache_sim *c, long base);
+void rank_demote(cache_sim *c, long base, int w);
+
+/* ----------------------------------------------------------------
+   Next-use index for OPT
+   ---------------------------------------------------------------- */
+
+/*!
+ * \brief For every access of a trace, the index of the next access to the same line.
+ *
+ * Built in one forward pass: the previous access of each line, found in a
+ * hash table, gets the current index as its next use.
+ */
+typedef struct {
+    int line;           /*!< Bytes per line (page size for a TLB) */
+    uint64_t n;         /*!< Accesses indexed */
+    uint64_t cap;       /*!< Capacity of \c next */
+    uint64_t *next;     /*!< [n] next use, OPT_NEVER if none */
+    uint64_t *keys;     /*!< Hash table: line numbers (freed by opt_finish()) */
+    uint64_t *last;     /*!< Hash table: last access of each line */
+    uint64_t hcap, hcount;
+} opt_index;
+
+/*!
+ * \brief Creates an empty index for \p line-byte lines.
+ * \return The index, or NULL if out of memory.
+ */
+opt_index *opt_create(int line);
+
+/*!
+ * \brief Appends access number o->n to \p addr.
+ * \return 0 on success, -1 if out of memory.
+ */
+int opt_add(opt_index *o, uint64_t addr);
+
+/*!
+ * \brief Releases the hash table once every access has been added.
+ */
+void opt_finish(opt_index *o);
+
+/*!
+ * \brief Releases an index (NULL is ignored).
+ */
+void opt_destroy(opt_index *o);
+
+#endif
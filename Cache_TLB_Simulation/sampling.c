@@ -0,0 +1,235 @@
+/*!
+ * \file sampling.c
+ * \brief Implementation of the sampled cache and TLB simulation.
+ */
+
+#include "sampling.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *const names[2] = { "cache", "TLB" };
+
+/*!
+ * \brief Parses a positive count with an optional K/M suffix; advances \p s.
+ * \return The count, or 0 if malformed.
+ */
+static uint64_t parse_count(const char **s) {
+    char *end;
+    uint64_t v = strtoull(*s, &end, 10);
+    if (end == *s) {
+        return 0;
+    }
+    if (*end == 'K' || *end == 'k') {
+        v <<= 10;
+        end++;
+    } else if (*end == 'M' || *end == 'm') {
+        v <<= 20;
+        end++;
+    }
+    *s = end;
+    return v;
+}
+
+int sample_parse(const char *spec, sample_config *cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->z = 1.96;
+    cfg->ratio = (int)parse_count(&spec);
+    if (cfg->ratio <= 0) {
+        return -1;
+    }
+    if (*spec == '\0') {
+        return 0;
+    }
+    if (*spec++ != ':' || (cfg->window = parse_count(&spec)) == 0 || *spec++ != ':' ||
+        (cfg->period = parse_count(&spec)) == 0) {
+        return -1;
+    }
+    if (*spec == ':') {
+        spec++;
+        cfg->warmup = parse_count(&spec);
+        if (cfg->warmup == 0 && spec[-1] != '0') {
+            return -1;
+        }
+    }
+    return *spec == '\0' && cfg->window + cfg->warmup <= cfg->period ? 0 : -1;
+}
+
+int sampler_init(sampler *sp, const sample_config *cfg, cache_sim *c, cache_sim *t) {
+    cache_sim *sims[2] = { c, t };
+
+    memset(sp, 0, sizeof(*sp));
+    sp->cfg = *cfg;
+    for (int i = 0; i < 2; i++) {
+        set_sample *s = &sp->s[i];
+        s->c = sims[i];
+        s->ratio = sims[i]->nsets >= cfg->ratio ? cfg->ratio : 1;
+        s->kept = (sims[i]->nsets - s->ratio / 2 + s->ratio - 1) / s->ratio;
+        s->acc = calloc((size_t)sims[i]->nsets, sizeof(uint64_t));
+        s->miss = calloc((size_t)sims[i]->nsets, sizeof(uint64_t));
+        if (!s->acc || !s->miss) {
+            sampler_free(sp);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void sampler_free(sampler *sp) {
+    for (int i = 0; i < 2; i++) {
+        free(sp->s[i].acc);
+        free(sp->s[i].miss);
+        sp->s[i].acc = sp->s[i].miss = NULL;
+    }
+    free(sp->win);
+    sp->win = NULL;
+    sp->nwin = sp->wcap = 0;
+}
+
+/* ----------------------------------------------------------------
+   Accesses
+   ---------------------------------------------------------------- */
+
+/*!
+ * \brief Opens the next measurement window; on allocation failure the window is merged into
+ *        the previous one.
+ */
+static void open_window(sampler *sp) {
+    if (sp->nwin == sp->wcap) {
+        uint64_t cap = sp->wcap ? sp->wcap * 2 : 1024;
+        sample_window *w = realloc(sp->win, cap * sizeof(sample_window));
+        if (!w) {
+            return;
+        }
+        sp->win = w;
+        sp->wcap = cap;
+    }
+    memset(&sp->win[sp->nwin++], 0, sizeof(sample_window));
+}
+
+void sampler_access(sampler *sp, uint64_t addr) {
+    int measure = 1;
+
+    if (sp->cfg.period) {
+        const uint64_t phase = sp->accesses % sp->cfg.period, start = sp->cfg.period - sp->cfg.window;
+        sp->accesses++;
+        if (phase < start - sp->cfg.warmup) {
+            return;
+        }
+        measure = phase >= start;
+        if (phase == start) {
+            open_window(sp);
+        }
+    } else {
+        sp->accesses++;
+    }
+    for (int i = 0; i < 2; i++) {
+        set_sample *s = &sp->s[i];
+        const uint64_t ln = cache_line_of(s->c, addr);
+        const uint64_t set = s->c->pow2_sets ? ln & (uint64_t)(s->c->nsets - 1) : ln % (uint64_t)s->c->nsets;
+        if (s->ratio > 1 && set % (uint64_t)s->ratio != (uint64_t)(s->ratio / 2)) {
+            continue;
+        }
+        int miss = cache_lookup(s->c, addr);
+        if (measure) {
+            s->acc[set]++;
+            s->miss[set] += (uint64_t)miss;
+            if (sp->nwin) {
+                sp->win[sp->nwin - 1].acc[i]++;
+                sp->win[sp->nwin - 1].miss[i] += (uint64_t)miss;
+            }
+        }
+    }
+    sp->measured += (uint64_t)measure;
+}
+
+/* ----------------------------------------------------------------
+   Estimates
+   ---------------------------------------------------------------- */
+
+/*!
+ * \brief Sums of a ratio estimator's residuals over its sampling units.
+ */
+typedef struct {
+    uint64_t n;
+    double a, ss;
+} ratio_sums;
+
+static inline void ratio_add(ratio_sums *v, double r, uint64_t acc, uint64_t miss) {
+    const double d = (double)miss - r * (double)acc;
+    v->n++;
+    v->a += (double)acc;
+    v->ss += d * d;
+}
+
+/*!
+ * \brief Variance of the miss ratio from the units of \p v, sampled with fraction \p f:
+ *        Var(r) = (1 - f) / (n * abar^2) * sum (m_u - r a_u)^2 / (n - 1).
+ */
+static double ratio_variance(const ratio_sums *v, double f) {
+    const double abar = v->a / (double)v->n;
+    return abar > 0.0 ? (1.0 - f) / ((double)v->n * abar * abar) * v->ss / (double)(v->n - 1) : 0.0;
+}
+
+void sampler_estimate(const sampler *sp, int which, sample_estimate *e) {
+    const set_sample *s = &sp->s[which];
+    const int by_window = sp->cfg.period > 0;
+    const uint64_t nsets = (uint64_t)s->kept, first = (uint64_t)(s->ratio / 2);
+    double a = 0.0, m = 0.0;
+
+    memset(e, 0, sizeof(*e));
+    e->units = by_window ? sp->nwin : nsets;
+    e->exact = s->ratio == 1 && !by_window;
+    for (uint64_t u = 0, set = first; u < nsets; u++, set += (uint64_t)s->ratio) {
+        a += (double)s->acc[set];
+        m += (double)s->miss[set];
+    }
+    if (e->exact) {
+        e->misses = m;
+        return;
+    }
+    const double r = a > 0.0 ? m / a : 0.0;
+    e->misses = r * (double)sp->accesses;
+    /* Two-stage sample: the windows drawn from time and the sets drawn from the cache each add
+       their own variance; the set term is fixed by the selection, so more windows cannot hide it. */
+    double var = 0.0;
+    if (by_window) {
+        if (sp->nwin < 2 || a <= 0.0) {
+            e->half = -1.0; /* unknown */
+            return;
+        }
+        ratio_sums v = { 0, 0.0, 0.0 };
+        for (uint64_t u = 0; u < sp->nwin; u++) {
+            ratio_add(&v, r, sp->win[u].acc[which], sp->win[u].miss[which]);
+        }
+        var += ratio_variance(&v, (double)sp->measured / (double)sp->accesses);
+    }
+    if (s->ratio > 1) {
+        if (nsets < 2 || a <= 0.0) {
+            e->half = -1.0;
+            return;
+        }
+        ratio_sums v = { 0, 0.0, 0.0 };
+        for (uint64_t set = first; set < (uint64_t)s->c->nsets; set += (uint64_t)s->ratio) {
+            ratio_add(&v, r, s->acc[set], s->miss[set]);
+        }
+        var += ratio_variance(&v, (double)s->kept / s->c->nsets);
+    }
+    e->half = sp->cfg.z * sqrt(var) * (double)sp->accesses;
+}
+
+void sampler_print(const sampler *sp, FILE *out) {
+    fprintf(out, "Sampling:     ");
+    for (int i = 0; i < 2; i++) {
+        const set_sample *s = &sp->s[i];
+        fprintf(out, " %s %d of %d sets%s", names[i], s->kept, s->c->nsets, i == 0 ? "," : "");
+    }
+    if (sp->cfg.period) {
+        fprintf(out, "; windows of %llu every %llu accesses (warm-up %llu): %llu windows, %llu of %llu accesses "
+                     "measured",
+                (unsigned long long)sp->cfg.window, (unsigned long long)sp->cfg.period,
+                (unsigned long long)sp->cfg.warmup, (unsigned long long)sp->nwin,
+                (unsigned long long)sp->measured, (unsigned long long)sp->accesses);
+    }
+    fprintf(out, "\n");
+}
@@ -0,0 +1,113 @@
+/*!
+ * \file sampling.h
+ * \brief Sampled simulation of a cache and a TLB: a subset of their sets and,
+ *        optionally, periodic time windows, with extrapolated miss counts and
+ *        confidence intervals.
+ *
+ * Set sampling simulates only the sets whose index is congruent to
+ * ratio / 2 modulo \c ratio; the accesses of the other sets are counted but
+ * not simulated. A structure with fewer than \c ratio sets is simulated in
+ * full. Time sampling (SMARTS-style) splits the trace into periods of
+ * \c period accesses; the last \c window of each period are measured, the
+ * \c warmup before them only update the simulated sets, and the rest are
+ * skipped. The miss ratio of the measured accesses (a ratio estimator) is
+ * extrapolated to every access of the trace, with a normal confidence
+ * interval whose variance adds a between-window term (time sampling) and a
+ * between-set term (set sampling), each with its finite-population
+ * correction. State left stale across the skipped accesses biases the
+ * estimate and is not in the interval: the warm-up should exceed the
+ * lines of the cache. Replacement
+ * state shared by sets (DRRIP's selector) is only trained by the simulated
+ * sets.
+ */
+
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "cache_tlb_sim.h"
+
+/*!
+ * \brief Sampling parameters.
+ */
+typedef struct {
+    int ratio;       /*!< One set in \c ratio is simulated (1: every set) */
+    uint64_t window; /*!< Measured accesses per period (0: no time sampling) */
+    uint64_t period; /*!< Accesses per period */
+    uint64_t warmup; /*!< Accesses simulated without measuring before each window */
+    double z;        /*!< Normal quantile of the confidence level (1.96 for 95%) */
+} sample_config;
+
+/*!
+ * \brief Sampled sets of one structure and their counters.
+ */
+typedef struct {
+    cache_sim *c;
+    int ratio;            /*!< Effective ratio (1 if the structure has too few sets) */
+    int kept;             /*!< Sets simulated */
+    uint64_t *acc, *miss; /*!< [nsets] measured accesses and misses of each simulated set */
+} set_sample;
+
+/*!
+ * \brief Measured accesses and misses of one time window.
+ */
+typedef struct {
+    uint64_t acc[2], miss[2]; /*!< Cache, TLB */
+} sample_window;
+
+/*!
+ * \brief A sampled cache and TLB.
+ */
+typedef struct {
+    sample_config cfg;
+    set_sample s[2];          /*!< Cache, TLB */
+    uint64_t accesses;        /*!< Accesses offered */
+    uint64_t measured;        /*!< Of which in measurement windows */
+    sample_window *win;
+    uint64_t nwin, wcap;
+} sampler;
+
+/*!
+ * \brief Extrapolated misses of one structure.
+ */
+typedef struct {
+    double misses;     /*!< Estimate for every access of the trace */
+    double half;       /*!< Half-width of the confidence interval */
+    uint64_t units;    /*!< Sampling units (windows or sets) */
+    int exact;         /*!< 1 if nothing was sampled out */
+} sample_estimate;
+
+/*!
+ * \brief Parses "RATIO[:WINDOW:PERIOD[:WARMUP]]" (counts accept K/M suffixes).
+ * \return 0 on success, -1 if malformed.
+ */
+int sample_parse(const char *spec, sample_config *cfg);
+
+/*!
+ * \brief Starts sampling the cache \p c and the TLB \p t (both empty).
+ * \return 0 on success, -1 if out of memory.
+ */
+int sampler_init(sampler *sp, const sample_config *cfg, cache_sim *c, cache_sim *t);
+
+/*!
+ * \brief Releases the counters (not the structures).
+ */
+void sampler_free(sampler *sp);
+
+/*!
+ * \brief Offers one access to the cache and the TLB.
+ */
+void sampler_access(sampler *sp, uint64_t addr);
+
+/*!
+ * \brief Extrapolates the misses of the cache (\p which = 0) or the TLB (1).
+ */
+void sampler_estimate(const sampler *sp, int which, sample_estimate *e);
+
+/*!
+ * \brief Prints what was sampled.
+ */
+void sampler_print(const sampler *sp, FILE *out);
+
+#endif
@@ -0,0 +1,354 @@
+/*!
+ * \file stack_dist.c
+ * \brief Implementation of the stack-distance analysis.
+ */
+
+#include "stack_dist.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*! \brief Empty slot of the hash table. */
+#define SD_EMPTY (~(uint64_t)0)
+
+/*! \brief Initial number of access times before the first compaction. */
+#define SD_INITIAL_CAP (1u << 16)
+
+static inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/* ----------------------------------------------------------------
+   Fenwick tree over access times
+   ---------------------------------------------------------------- */
+
+static inline void fen_add(uint64_t *f, uint64_t cap, uint64_t i, int64_t v) {
+    for (; i <= cap; i += i & -i) {
+        f[i] += (uint64_t)v;
+    }
+}
+
+/*! \brief Number of marks at times 1..i. */
+static inline uint64_t fen_sum(const uint64_t *f, uint64_t i) {
+    uint64_t s = 0;
+    for (; i > 0; i -= i & -i) {
+        s += f[i];
+    }
+    return s;
+}
+
+/* ----------------------------------------------------------------
+   Line -> last access time
+   ---------------------------------------------------------------- */
+
+static uint64_t *slot_of(const stack_dist *sd, uint64_t ln) {
+    uint64_t mask = sd->hcap - 1;
+    for (uint64_t i = mix64(ln) & mask;; i = (i + 1) & mask) {
+        if (sd->keys[i] == ln || sd->keys[i] == SD_EMPTY) {
+            return &sd->keys[i];
+        }
+    }
+}
+
+static int grow_table(stack_dist *sd) {
+    uint64_t *keys = sd->keys, *last = sd->last, old = sd->hcap;
+
+    sd->hcap = old ? old * 2 : 1024;
+    sd->keys = malloc(sd->hcap * sizeof(uint64_t));
+    sd->last = malloc(sd->hcap * sizeof(uint64_t));
+    if (!sd->keys || !sd->last) {
+        free(sd->keys);
+        free(sd->last);
+        sd->keys = keys;
+        sd->last = last;
+        sd->hcap = old;
+        return -1;
+    }
+    memset(sd->keys, 0xff, sd->hcap * sizeof(uint64_t));
+    for (uint64_t i = 0; i < old; i++) {
+        if (keys[i] != SD_EMPTY) {
+            uint64_t *k = slot_of(sd, keys[i]);
+            *k = keys[i];
+            sd->last[k - sd->keys] = last[i];
+        }
+    }
+    free(keys);
+    free(last);
+    return 0;
+}
+
+static int by_time(const void *a, const void *b) {
+    uint64_t x = **(uint64_t *const *)a, y = **(uint64_t *const *)b;
+    return (x > y) - (x < y);
+}
+
+/*!
+ * \brief Renumbers the last access times of the lines 1..hcount (keeping their order) so
+ *        that the times above are free again, growing the tree if it is more than half full.
+ */
+static int compact(stack_dist *sd) {
+    uint64_t **order = malloc(sd->hcount * sizeof(uint64_t *)), n = 0;
+    uint64_t cap = sd->cap;
+
+    if (!order) {
+        return -1;
+    }
+    for (uint64_t i = 0; i < sd->hcap; i++) {
+        if (sd->keys[i] != SD_EMPTY) {
+            order[n++] = &sd->last[i];
+        }
+    }
+    qsort(order, n, sizeof(uint64_t *), by_time);
+    while (n > cap / 2) {
+        cap *= 2;
+    }
+    uint64_t *f = calloc(cap + 1, sizeof(uint64_t));
+    if (!f) {
+        free(order);
+        return -1;
+    }
+    for (uint64_t i = 0; i < n; i++) {
+        *order[i] = i + 1;
+        f[i + 1] = 1;
+    }
+    /* Linear-time construction: push each node's sum to its parent. */
+    for (uint64_t i = 1; i <= cap; i++) {
+        uint64_t p = i + (i & -i);
+        if (p <= cap) {
+            f[p] += f[i];
+        }
+    }
+    free(sd->fenwick);
+    free(order);
+    sd->fenwick = f;
+    sd->cap = cap;
+    sd->now = n;
+    return 0;
+}
+
+/* ----------------------------------------------------------------
+   Creation
+   ---------------------------------------------------------------- */
+
+stack_dist *sd_create(int line, uint64_t max_bytes, double rate, const int *setcounts, int nsetcounts,
+                      int max_ways) {
+    if (line <= 0 || rate <= 0.0 || rate > 1.0 || nsetcounts < 0 || nsetcounts > SD_MAX_SETCOUNTS ||
+        (nsetcounts > 0 && max_ways <= 0)) {
+        fprintf(stderr, "Invalid stack-distance parameters\n");
+        return NULL;
+    }
+    stack_dist *sd = calloc(1, sizeof(stack_dist));
+    if (!sd) {
+        fprintf(stderr, "Cannot allocate the stack-distance analysis\n");
+        return NULL;
+    }
+    sd->line = line;
+    sd->max_ways = max_ways;
+    sd->threshold = (uint32_t)llround(rate * SD_SHARDS_MODULUS);
+    if (sd->threshold == 0) {
+        sd->threshold = 1;
+    }
+    sd->rate = (double)sd->threshold / SD_SHARDS_MODULUS;
+    sd->max_dist = max_bytes / (uint64_t)line + 1;
+    sd->cap = SD_INITIAL_CAP;
+    sd->hist = calloc(sd->max_dist, sizeof(uint64_t));
+    sd->fenwick = calloc(sd->cap + 1, sizeof(uint64_t));
+    int ok = sd->hist && sd->fenwick && grow_table(sd) == 0;
+
+    for (int k = 0; ok && k < nsetcounts; k++) {
+        sd_sets *s = &sd->sets[k];
+        if (setcounts[k] <= 0) {
+            fprintf(stderr, "Invalid number of sets %d\n", setcounts[k]);
+            sd_destroy(sd);
+            return NULL;
+        }
+        s->nsets = setcounts[k];
+        s->stack = malloc((size_t)s->nsets * max_ways * sizeof(uint64_t));
+        s->hits = calloc((size_t)max_ways, sizeof(uint64_t));
+        sd->nsetcounts = k + 1;
+        if (!s->stack || !s->hits) {
+            ok = 0;
+            break;
+        }
+        memset(s->stack, 0xff, (size_t)s->nsets * max_ways * sizeof(uint64_t));
+    }
+    if (!ok) {
+        fprintf(stderr, "Cannot allocate the stack-distance analysis\n");
+        sd_destroy(sd);
+        return NULL;
+    }
+    return sd;
+}
+
+void sd_destroy(stack_dist *sd) {
+    if (!sd) {
+        return;
+    }
+    for (int k = 0; k < sd->nsetcounts; k++) {
+        free(sd->sets[k].stack);
+        free(sd->sets[k].hits);
+    }
+    free(sd->keys);
+    free(sd->last);
+    free(sd->fenwick);
+    free(sd->hist);
+    free(sd);
+}
+
+/* ----------------------------------------------------------------
+   Accesses
+   ---------------------------------------------------------------- */
+
+/*!
+ * \brief Moves \p ln to the top of its LRU stack in every set count, counting the depth it was found at.
+ */
+static inline void access_sets(stack_dist *sd, uint64_t ln) {
+    const int ways = sd->max_ways;
+    for (int k = 0; k < sd->nsetcounts; k++) {
+        sd_sets *s = &sd->sets[k];
+        uint64_t *st = &s->stack[(ln % (uint64_t)s->nsets) * (uint64_t)ways];
+        int p = 0;
+        while (p < ways && st[p] != ln) {
+            p++;
+        }
+        if (p < ways) {
+            s->hits[p]++;
+        } else {
+            p = ways - 1; /* deeper than every associativity: drop the bottom */
+        }
+        memmove(st + 1, st, (size_t)p * sizeof(uint64_t));
+        st[0] = ln;
+    }
+}
+
+int sd_access(stack_dist *sd, uint64_t addr) {
+    uint64_t ln = addr / (uint64_t)sd->line;
+
+    sd->accesses++;
+    access_sets(sd, ln);
+    if ((mix64(ln ^ 0x5bd1e995ULL) & (SD_SHARDS_MODULUS - 1)) >= sd->threshold) {
+        return 0;
+    }
+    sd->sampled++;
+    if (sd->now == sd->cap && compact(sd) != 0) {
+        return -1;
+    }
+    uint64_t now = ++sd->now;
+    uint64_t *k = slot_of(sd, ln);
+    uint64_t *t = &sd->last[k - sd->keys];
+    if (*k == SD_EMPTY) {
+        sd->cold++;
+        if (2 * (sd->hcount + 1) > sd->hcap) {
+            if (grow_table(sd) != 0) {
+                return -1;
+            }
+            k = slot_of(sd, ln);
+            t = &sd->last[k - sd->keys];
+        }
+        *k = ln;
+        sd->hcount++;
+    } else {
+        /* Distinct sampled lines touched after the previous access, scaled to all lines. */
+        uint64_t d = fen_sum(sd->fenwick, now - 1) - fen_sum(sd->fenwick, *t);
+        uint64_t scaled = (uint64_t)(d / sd->rate);
+        if (scaled < sd->max_dist) {
+            sd->hist[scaled]++;
+        } else {
+            sd->beyond++;
+        }
+        fen_add(sd->fenwick, sd->cap, *t, -1);
+    }
+    fen_add(sd->fenwick, sd->cap, now, 1);
+    *t = now;
+    return 0;
+}
+
+/* ----------------------------------------------------------------
+   Results
+   ---------------------------------------------------------------- */
+
+/*!
+ * \brief SHARDS-adj correction: the references a sample at the rate should hold minus
+ *        those it holds (0 without sampling), added to the first bucket of the histogram.
+ */
+static double adjustment(const stack_dist *sd) {
+    return (double)sd->accesses * sd->rate - (double)sd->sampled;
+}
+
+/*!
+ * \brief Scales sampled misses to all accesses by their share of the adjusted histogram.
+ *        The correction goes to distance 0, a hit at every capacity: it changes the total
+ *        the misses are divided by, not the misses.
+ */
+static double scale(const stack_dist *sd, uint64_t sampled_misses) {
+    double total = (double)sd->sampled + adjustment(sd);
+    if (total <= 0.0) {
+        return sampled_misses ? (double)sd->accesses : 0.0;
+    }
+    double m = sampled_misses / total * (double)sd->accesses;
+    return m < (double)sd->accesses ? m : (double)sd->accesses;
+}
+
+double sd_misses(const stack_dist *sd, uint64_t lines) {
+    uint64_t m = sd->cold + sd->beyond;
+    for (uint64_t d = lines; d < sd->max_dist; d++) {
+        m += sd->hist[d];
+    }
+    return scale(sd, m);
+}
+
+uint64_t sd_set_misses(const stack_dist *sd, int k, int ways) {
+    uint64_t m = sd->accesses;
+    for (int p = 0; p < ways && p < sd->max_ways; p++) {
+        m -= sd->sets[k].hits[p];
+    }
+    return m;
+}
+
+void sd_print(const stack_dist *sd, FILE *out) {
+    uint64_t m = sd->cold + sd->beyond, d = sd->max_dist;
+
+    fprintf(out, "Fully associative LRU, %d-byte lines", sd->line);
+    if (sd->rate < 1.0) {
+        fprintf(out, " (SHARDS rate %.6f, %llu of %llu accesses sampled, SHARDS-adj %+.0f, %llu lines tracked)",
+                sd->rate, (unsigned long long)sd->sampled, (unsigned long long)sd->accesses, adjustment(sd),
+                (unsigned long long)sd->hcount);
+    }
+    fprintf(out, "\n%14s %12s %16s %10s\n", "Capacity", "Lines", "Misses", "Miss%");
+    /* Walk the capacities from the largest down, accumulating the histogram tail. */
+    uint64_t top = 1;
+    while (top * 2 < sd->max_dist) {
+        top *= 2;
+    }
+    double misses[64];
+    uint64_t lines[64];
+    int n = 0;
+    for (uint64_t c = top; c >= 1 && n < 64; c /= 2) {
+        while (d > c) {
+            m += sd->hist[--d];
+        }
+        lines[n] = c;
+        misses[n++] = scale(sd, m);
+    }
+    for (int i = n - 1; i >= 0; i--) {
+        fprintf(out, "%14llu %12llu %16.0f %10.4f\n", (unsigned long long)(lines[i] * sd->line),
+                (unsigned long long)lines[i], misses[i],
+                sd->accesses ? 100.0 * misses[i] / sd->accesses : 0.0);
+    }
+    fprintf(out, "Cold misses:   %.0f\n", scale(sd, sd->cold));
+
+    for (int k = 0; k < sd->nsetcounts; k++) {
+        const sd_sets *s = &sd->sets[k];
+        fprintf(out, "\n%d sets of %d-byte lines, LRU\n%6s %14s %16s %10s\n", s->nsets, sd->line, "Ways",
+                "Capacity", "Misses", "Miss%");
+        for (int w = 1; w <= sd->max_ways; w++) {
+            uint64_t sm = sd_set_misses(sd, k, w);
+            fprintf(out, "%6d %14llu %16llu %10.4f\n", w, (unsigned long long)s->nsets * w * sd->line,
+                    (unsigned long long)sm, sd->accesses ? 100.0 * sm / sd->accesses : 0.0);
+        }
+    }
+}
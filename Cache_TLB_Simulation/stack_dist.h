@@ -0,0 +1,111 @@
+/*!
+ * \file stack_dist.h
+ * \brief Single-pass LRU stack-distance (Mattson) analysis: miss-ratio
+ *        curves for every cache size in one replay of a trace.
+ *
+ * Two profiles are built at once:
+ *  - fully associative: the reuse distance of each access (distinct lines
+ *    touched since the previous access to its line) is counted with a
+ *    Fenwick tree over access times, in O(log n) per access; an LRU cache
+ *    of C lines misses exactly the accesses with distance >= C;
+ *  - set associative: for each requested number of sets, a bounded LRU
+ *    stack per set gives the hits at every depth, so the misses of every
+ *    associativity up to the maximum are known, in O(ways) per access.
+ * The fully associative profile can be sampled SHARDS-style: only the lines
+ * whose hash falls under a threshold are tracked and distances are scaled
+ * by the rate, so memory and time shrink with the rate. Counts are scaled
+ * SHARDS-adj style: the first bucket of the histogram is corrected by the
+ * expected minus the actual number of sampled references, which removes
+ * the error of a sample that holds more or fewer references than the rate
+ * implies.
+ */
+
+#ifndef STACK_DIST_H
+#define STACK_DIST_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*! \brief Maximum number of set counts profiled at once. */
+#define SD_MAX_SETCOUNTS 32
+
+/*! \brief Resolution of the SHARDS sampling threshold (rates are multiples of 2^-24). */
+#define SD_SHARDS_MODULUS (1u << 24)
+
+/*!
+ * \brief LRU stacks of one set count.
+ */
+typedef struct {
+    int nsets;
+    uint64_t *stack; /*!< [nsets][max_ways] line numbers, most recent first */
+    uint64_t *hits;  /*!< [max_ways] accesses found at each stack depth */
+} sd_sets;
+
+/*!
+ * \brief State of a stack-distance analysis.
+ */
+typedef struct {
+    int line;              /*!< Bytes per line */
+    int max_ways;          /*!< Deepest per-set stack */
+    uint64_t accesses;     /*!< All accesses */
+
+    /* Fully associative profile (sampled) */
+    uint32_t threshold;    /*!< Lines with hash below it are sampled (SD_SHARDS_MODULUS: all) */
+    double rate;           /*!< threshold / SD_SHARDS_MODULUS */
+    uint64_t sampled;      /*!< Accesses to sampled lines */
+    uint64_t *keys;        /*!< Hash table: line numbers (open addressing) */
+    uint64_t *last;        /*!< Hash table: time of the last access of each line */
+    uint64_t hcap, hcount; /*!< Table size (power of two) and lines in it */
+    uint64_t *fenwick;     /*!< [1..cap]: 1 at the last access time of each line */
+    uint64_t cap, now;     /*!< Times available before compaction, current time */
+    uint64_t max_dist;     /*!< Histogram size (lines), distances beyond go to \c beyond */
+    uint64_t *hist;        /*!< [max_dist] sampled accesses per scaled distance */
+    uint64_t beyond;       /*!< Sampled accesses with scaled distance >= max_dist */
+    uint64_t cold;         /*!< Sampled first accesses */
+
+    /* Set associative profiles (exact) */
+    int nsetcounts;
+    sd_sets sets[SD_MAX_SETCOUNTS];
+} stack_dist;
+
+/*!
+ * \brief Creates an analysis.
+ * \param line Bytes per line.
+ * \param max_bytes Largest fully associative capacity of interest (bounds the histogram).
+ * \param rate SHARDS sampling rate in (0, 1] of the fully associative profile (1: exact).
+ * \param setcounts Numbers of sets of the set associative profiles.
+ * \param nsetcounts Number of entries of \p setcounts (0: none).
+ * \param max_ways Deepest associativity of the set associative profiles.
+ * \return The analysis, or NULL (with a message on stderr) if invalid or out of memory.
+ */
+stack_dist *sd_create(int line, uint64_t max_bytes, double rate, const int *setcounts, int nsetcounts,
+                      int max_ways);
+
+/*!
+ * \brief Releases an analysis (NULL is ignored).
+ */
+void sd_destroy(stack_dist *sd);
+
+/*!
+ * \brief Records one access.
+ * \return 0 on success, -1 if the fully associative profile ran out of memory.
+ */
+int sd_access(stack_dist *sd, uint64_t addr);
+
+/*!
+ * \brief (Estimated) misses of a fully associative LRU cache of \p lines lines.
+ */
+double sd_misses(const stack_dist *sd, uint64_t lines);
+
+/*!
+ * \brief Misses of an LRU cache with the \p k-th set count and \p ways ways (1..max_ways).
+ */
+uint64_t sd_set_misses(const stack_dist *sd, int k, int ways);
+
+/*!
+ * \brief Prints the fully associative curve at every power-of-two capacity,
+ *        then the misses of every set count and associativity.
+ */
+void sd_print(const stack_dist *sd, FILE *out);
+
+#endif
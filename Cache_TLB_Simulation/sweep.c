@@ -0,0 +1,156 @@
+/*!
+ * \file sweep.c
+ * \brief Implementation of the parallel multi-configuration replay.
+ */
+
+#include "sweep.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "trace.h"
+
+/*!
+ * \brief State shared by the reader and the workers.
+ */
+typedef struct {
+    cache_sim **sims;
+    int n;
+    const mem_access *chunk; /*!< Chunk being replayed (read-only while the workers run) */
+    size_t len;              /*!< Its accesses; 0 tells the workers to exit */
+    atomic_int next;         /*!< Next unclaimed configuration of the chunk */
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned long generation; /*!< Incremented for every chunk */
+    int pending;              /*!< Workers that have not finished the current chunk */
+} sweep_job;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void *worker_main(void *p) {
+    sweep_job *job = p;
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&job->lock);
+    for (;;) {
+        while (job->generation == seen) {
+            pthread_cond_wait(&job->start, &job->lock);
+        }
+        seen = job->generation;
+        if (job->len == 0) {
+            break;
+        }
+        const mem_access *a = job->chunk;
+        const size_t len = job->len;
+        pthread_mutex_unlock(&job->lock);
+
+        for (int s; (s = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed)) < job->n;) {
+            cache_sim *c = job->sims[s];
+            trace_begin("sweep_config");
+            for (size_t i = 0; i < len; i++) {
+                cache_lookup(c, a[i].addr);
+            }
+            trace_end("sweep_config");
+        }
+
+        pthread_mutex_lock(&job->lock);
+        if (--job->pending == 0) {
+            pthread_cond_signal(&job->done);
+        }
+    }
+    pthread_mutex_unlock(&job->lock);
+    trace_detach();
+    return NULL;
+}
+
+/*!
+ * \brief Hands \p len accesses of \p chunk (0: exit) to the \p workers workers.
+ */
+static void publish(sweep_job *job, const mem_access *chunk, size_t len, int workers) {
+    pthread_mutex_lock(&job->lock);
+    job->chunk = chunk;
+    job->len = len;
+    job->pending = workers;
+    atomic_store_explicit(&job->next, 0, memory_order_relaxed);
+    job->generation++;
+    pthread_cond_broadcast(&job->start);
+    pthread_mutex_unlock(&job->lock);
+}
+
+/*!
+ * \brief Waits until every worker has replayed the current chunk.
+ */
+static void wait_done(sweep_job *job) {
+    pthread_mutex_lock(&job->lock);
+    while (job->pending > 0) {
+        pthread_cond_wait(&job->done, &job->lock);
+    }
+    pthread_mutex_unlock(&job->lock);
+}
+
+int sweep_run(addr_trace *t, cache_sim **sims, int n, int threads, sweep_result *res) {
+    sweep_job job = { .sims = sims, .n = n };
+    mem_access *buf[2] = { malloc(SWEEP_CHUNK * sizeof(mem_access)), malloc(SWEEP_CHUNK * sizeof(mem_access)) };
+    pthread_t *tids = calloc((size_t)threads, sizeof(pthread_t));
+    int workers = 0, cur = 0;
+
+    res->accesses = res->writes = res->chunks = 0;
+    res->seconds = 0.0;
+    if (!buf[0] || !buf[1] || !tids) {
+        fprintf(stderr, "Cannot allocate the sweep buffers\n");
+        free(buf[0]);
+        free(buf[1]);
+        free(tids);
+        return -1;
+    }
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.start, NULL);
+    pthread_cond_init(&job.done, NULL);
+    while (workers < threads && pthread_create(&tids[workers], NULL, worker_main, &job) == 0) {
+        workers++;
+    }
+    if (workers < threads) {
+        fprintf(stderr, "Warning: only %d of %d sweep threads started\n", workers, threads);
+    }
+
+    double start = now_seconds();
+    size_t len = 0;
+    if (workers > 0) {
+        trace_begin("trace_read");
+        len = addr_trace_read(t, buf[cur], SWEEP_CHUNK);
+        trace_end("trace_read");
+    }
+    while (len > 0) {
+        publish(&job, buf[cur], len, workers);
+        res->chunks++;
+        res->accesses += len;
+        for (size_t i = 0; i < len; i++) {
+            res->writes += buf[cur][i].write;
+        }
+        /* Decode the next chunk while the workers replay this one. */
+        trace_begin("trace_read");
+        len = addr_trace_read(t, buf[cur ^ 1], SWEEP_CHUNK);
+        trace_end("trace_read");
+        wait_done(&job);
+        cur ^= 1;
+    }
+    publish(&job, NULL, 0, workers);
+    for (int k = 0; k < workers; k++) {
+        pthread_join(tids[k], NULL);
+    }
+    res->seconds = now_seconds() - start;
+
+    pthread_mutex_destroy(&job.lock);
+    pthread_cond_destroy(&job.start);
+    pthread_cond_destroy(&job.done);
+    free(buf[0]);
+    free(buf[1]);
+    free(tids);
+    return workers > 0 ? 0 : -1;
+}
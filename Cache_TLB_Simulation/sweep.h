@@ -0,0 +1,43 @@
+/*!
+ * \file sweep.h
+ * \brief Replays one pass of a trace through many cache and TLB objects in parallel.
+ *
+ * The trace is read once, in chunks of SWEEP_CHUNK accesses. All worker
+ * threads read the same chunk (it is never written while they use it) and
+ * claim whole configurations from it one at a time, so each object is only
+ * touched by one thread per chunk; the next chunk is decoded meanwhile into
+ * a second buffer.
+ */
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <stdint.h>
+#include "addr_trace.h"
+#include "cache_tlb_sim.h"
+
+/*! \brief Accesses per shared trace chunk. */
+#define SWEEP_CHUNK 65536
+
+/*! \brief Maximum values per list of a sweep specification. */
+#define SWEEP_MAX_VALUES 32
+
+/*!
+ * \brief Totals of a sweep.
+ */
+typedef struct {
+    uint64_t accesses; /*!< Accesses replayed */
+    uint64_t writes;   /*!< Of which writes */
+    uint64_t chunks;   /*!< Chunks shared by the workers */
+    double seconds;    /*!< Wall time of the replay */
+} sweep_result;
+
+/*!
+ * \brief Replays the rest of \p t through cache_lookup() of each of the \p n objects.
+ *        Their counters (accesses, misses) hold the results.
+ * \param threads Worker threads (at least 1).
+ * \return 0 on success, -1 (with a message on stderr) if the workers cannot be started.
+ */
+int sweep_run(addr_trace *t, cache_sim **sims, int n, int threads, sweep_result *res);
+
+#endif
@@ -0,0 +1,169 @@
+/**
+ * @file autotune.c
+ * @brief Implementation of the blocked-multiplication autotuner and its tuning file.
+ *
+ * File format: one entry per line, "type n bl order cycles", '#' starts a comment.
+ */
+
+#include "autotune.h"
+#include "tsc.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static tune_entry table[TUNE_MAX_ENTRIES];
+static int table_len;
+
+void tuning_default_path(char *buf, size_t len) {
+    const char *env = getenv("MATRIX_TUNING_FILE");
+    if (env && *env) {
+        snprintf(buf, len, "%s", env);
+        return;
+    }
+    char host[64] = "localhost";
+    gethostname(host, sizeof(host) - 1);
+    const char *home = getenv("HOME");
+    snprintf(buf, len, "%s/.matrix_tuning.%s", home ? home : ".", host);
+}
+
+int tuning_load(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return -1;
+    }
+    char line[256], order[8];
+    int count = 0;
+    while (fgets(line, sizeof(line), f)) {
+        tune_entry e;
+        if (line[0] == '#' ||
+            sscanf(line, "%15s %d %d %7s %lf", e.type, &e.n, &e.bl, order, &e.cycles) != 5 ||
+            e.n <= 0 || e.bl <= 0) {
+            continue;
+        }
+        e.order = strcmp(order, "ikj") == 0 ? BLOCKED_IKJ : BLOCKED_IJK;
+        tuning_store(&e);
+        count++;
+    }
+    fclose(f);
+    return count;
+}
+
+int tuning_save(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        return -1;
+    }
+    fprintf(f, "# matrix_ops tuning cache: type n bl order cycles/n^3\n");
+    for (int i = 0; i < table_len; i++) {
+        fprintf(f, "%s %d %d %s %.4f\n", table[i].type, table[i].n, table[i].bl,
+                blocked_order_name(table[i].order), table[i].cycles);
+    }
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+int tuning_lookup(int n, tune_entry *out) {
+    int found = -1;
+    double best = 0.0;
+    for (int i = 0; i < table_len; i++) {
+        if (strcmp(table[i].type, STR(TYPE)) != 0) {
+            continue;
+        }
+        double dist = fabs(log((double)n / table[i].n));
+        if (found < 0 || dist < best) {
+            found = i;
+            best = dist;
+        }
+    }
+    if (found < 0 || best > log(TUNE_MAX_RATIO)) {
+        return -1;
+    }
+    *out = table[found];
+    return 0;
+}
+
+void tuning_store(const tune_entry *e) {
+    for (int i = 0; i < table_len; i++) {
+        if (table[i].n == e->n && strcmp(table[i].type, e->type) == 0) {
+            table[i] = *e;
+            return;
+        }
+    }
+    if (table_len < TUNE_MAX_ENTRIES) {
+        table[table_len++] = *e;
+    }
+}
+
+/**
+ * @brief Whether block size @p bl is worth timing for this size and cache geometry.
+ */
+static int keep_candidate(int bl, int n, const cpu_caches *caches) {
+    const double tile_bytes = (double)bl * bl * sizeof(TYPE);
+    const int min_bl = caches->l1d.line / (int)sizeof(TYPE);
+    if (bl >= n) {
+        return 1;
+    }
+    return tile_bytes <= caches->l2.size && bl >= min_bl;
+}
+
+/**
+ * @brief Best cycles per n^3 of a few runs of one configuration (after one warm-up run).
+ */
+static double time_config(matrix_ctx *ctx, int bl, int order, int reps) {
+    const double flops = (double)ctx->n * ctx->n * ctx->n;
+    double best = 0.0;
+    matrix_mult_blocked_run(ctx, bl, order);
+    for (int r = 0; r < reps; r++) {
+        unsigned long long start = start_timer();
+        matrix_mult_blocked_run(ctx, bl, order);
+        double t = dtime(start, stop_timer()) / flops;
+        if (r == 0 || t < best) {
+            best = t;
+        }
+    }
+    return best;
+}
+
+void autotune_blocked(matrix_ctx *ctx, const cpu_caches *caches, tune_entry *best, FILE *out) {
+    const int n = ctx->n;
+    const int reps = ctx->m < 3 ? ctx->m : 3;
+    int candidates[64], ncand = 0, pruned = 0;
+
+    for (int b = 2; ncand < 62; b *= 2) {
+        int sizes[2] = { b, b + b / 2 };
+        for (int s = 0; s < 2; s++) {
+            int bl = sizes[s] >= n ? n : sizes[s];
+            if (ncand > 0 && candidates[ncand - 1] == bl) {
+                continue;
+            }
+            if (keep_candidate(bl, n, caches)) {
+                candidates[ncand++] = bl;
+            } else {
+                pruned++;
+            }
+        }
+        if (b >= n) {
+            break;
+        }
+    }
+
+    memset(best, 0, sizeof(*best));
+    snprintf(best->type, sizeof(best->type), "%s", STR(TYPE));
+    best->n = n;
+    fprintf(out, "AUTOTUNE\tN=%d\tL1D=%dK\tL2=%dK\tcandidates=%d\tpruned=%d\n",
+            n, caches->l1d.size >> 10, caches->l2.size >> 10, ncand, pruned);
+    for (int order = BLOCKED_IJK; order <= BLOCKED_IKJ; order++) {
+        for (int c = 0; c < ncand; c++) {
+            double t = time_config(ctx, candidates[c], order, reps);
+            fprintf(out, "AUTOTUNE\tbl=%d\torder=%s\t%.3f\n", candidates[c], blocked_order_name(order), t);
+            if (best->bl == 0 || t < best->cycles) {
+                best->bl = candidates[c];
+                best->order = order;
+                best->cycles = t;
+            }
+        }
+    }
+    fprintf(out, "AUTOTUNE\tbest\tbl=%d\torder=%s\t%.3f\n", best->bl, blocked_order_name(best->order),
+            best->cycles);
+    fprintf(out, "\n");
+}
@@ -0,0 +1,75 @@
+/**
+ * @file autotune.h
+ * @brief Runtime block-size/loop-order search for matrix_mult_blocked() with a per-host tuning cache.
+ */
+
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include "matrix_ops.h"
+#include "cpu_features.h"
+
+#ifndef TUNE_MAX_ENTRIES
+#define TUNE_MAX_ENTRIES 256 /**< Entries kept in the in-memory tuning table */
+#endif
+
+#ifndef TUNE_MAX_RATIO
+#define TUNE_MAX_RATIO 2.0 /**< Largest size ratio (either way) at which a tuning entry still applies */
+#endif
+
+/**
+ * @brief Best blocked configuration found for one element type and size.
+ */
+typedef struct {
+    char type[16]; /**< Element type name (STR(TYPE)) */
+    int n;         /**< Matrix size the entry was tuned for */
+    int bl;        /**< Block size */
+    int order;     /**< Loop order inside the blocks (blocked_order) */
+    double cycles; /**< Measured cycles per n^3 */
+} tune_entry;
+
+/**
+ * @brief Path of this host's tuning file.
+ *
+ * $MATRIX_TUNING_FILE if set, otherwise $HOME/.matrix_tuning.<hostname>.
+ */
+void tuning_default_path(char *buf, size_t len);
+
+/**
+ * @brief Loads a tuning file into the in-memory table (entries for other types are kept too).
+ * @return Number of entries read, or -1 if the file cannot be opened.
+ */
+int tuning_load(const char *path);
+
+/**
+ * @brief Writes the in-memory table to a tuning file.
+ * @return 0 on success, -1 on I/O error.
+ */
+int tuning_save(const char *path);
+
+/**
+ * @brief Finds the entry for TYPE whose size is closest (in ratio) to @p n.
+ * @return 0 if an entry was found within a factor TUNE_MAX_RATIO of @p n, -1 otherwise.
+ */
+int tuning_lookup(int n, tune_entry *out);
+
+/**
+ * @brief Inserts or replaces the entry with the same type and size.
+ */
+void tuning_store(const tune_entry *e);
+
+/**
+ * @brief Times matrix_mult_blocked_run() over pruned block sizes and both loop orders.
+ *
+ * Candidates are powers of two and their 3/2 multiples up to n. Block sizes whose
+ * XF tile (bl^2 elements, reused by every row i) does not fit in L2, or whose tile
+ * rows are shorter than a cache line, are skipped without being timed.
+ *
+ * @param ctx Benchmark context (its n and m are used; YF is overwritten).
+ * @param caches Detected cache geometry.
+ * @param best Receives the fastest configuration.
+ * @param out Where the timings are printed (the report's notes stream).
+ */
+void autotune_blocked(matrix_ctx *ctx, const cpu_caches *caches, tune_entry *best, FILE *out);
+
+#endif /* AUTOTUNE_H */
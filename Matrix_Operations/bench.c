@@ -0,0 +1,318 @@
+/**
+ * @file bench.c
+ * @brief Implementation of the benchmark runner and its text, CSV and JSON reports.
+ */
+
+#include "bench.h"
+#include "simd_kernels.h"
+#include "tsc.h"
+#include "trace.h"
+#include <fnmatch.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+int kernel_match(const char *name, const char *patterns) {
+    if (!patterns || !*patterns) {
+        return 1;
+    }
+    const char *p = patterns;
+    while (*p) {
+        char glob[64];
+        size_t len = strcspn(p, ",");
+        if (len > 0 && len < sizeof(glob)) {
+            memcpy(glob, p, len);
+            glob[len] = '\0';
+            if (fnmatch(glob, name, 0) == 0) {
+                return 1;
+            }
+        }
+        p += len;
+        if (*p == ',') {
+            p++;
+        }
+    }
+    return 0;
+}
+
+int report_parse_format(const char *name) {
+    if (strcmp(name, "text") == 0) return REPORT_TEXT;
+    if (strcmp(name, "csv") == 0) return REPORT_CSV;
+    if (strcmp(name, "json") == 0) return REPORT_JSON;
+    return -1;
+}
+
+int report_open(bench_report *r, const char *path, int format) {
+    r->format = format;
+    r->records = 0;
+    r->out = stdout;
+    if (path && strcmp(path, "-") != 0) {
+        r->out = fopen(path, "w");
+        if (!r->out) {
+            return -1;
+        }
+    }
+    if (format == REPORT_CSV) {
+        fprintf(r->out, "type,simd,n,ld,reps,kept,warmup,kernel,row,min,median,median_ci_lo,median_ci_hi,tmean,mad,"
+                        "bimodality,bimodal,"
+                        "min_cycles,median_cycles,min_ns,median_ns,flops_per_cycle,bytes_per_cycle,"
+                        "tsc_overhead,tsc_ghz,ipc");
+        for (int e = PC_L1D_MISSES; e < PC_EVENTS; e++) {
+            fprintf(r->out, ",%s_per_elem", perf_event_name(e));
+        }
+        fprintf(r->out, ",counter_coverage,voluntary_switches,preemptions,interrupts,page_faults,noisy\n");
+    } else if (format == REPORT_JSON) {
+        fprintf(r->out, "[");
+    } else {
+        print_tsc_calibration(r->out);
+    }
+    return 0;
+}
+
+void report_close(bench_report *r) {
+    if (r->format == REPORT_JSON) {
+        fprintf(r->out, "%s]\n", r->records > 0 ? "\n" : "");
+    }
+    if (r->out != stdout) {
+        fclose(r->out);
+    } else {
+        fflush(r->out);
+    }
+}
+
+void report_size(bench_report *r, const bench_env *env) {
+    const matrix_ctx *ctx = env->ctx;
+    const bench_sampling *s = env->sampling;
+
+    if (r->format != REPORT_TEXT) {
+        return;
+    }
+    fprintf(r->out, "Evaluation: N=%d, type=%s, BL=%d (%s), LD=%d, M=%d", ctx->n, STR(TYPE),
+            ctx->bl, blocked_order_name(ctx->bl_order), ctx->ld, ctx->m);
+    if (s->ci > 0.0) {
+        fprintf(r->out, "..%d (CI width <= %.3g%%, budget %.3gs)", BENCH_MAX_REPS, 100.0 * s->ci, s->budget);
+    }
+    fprintf(r->out, ", filter=%s, SIMD=%s\n", stats_filter_name(s->filter), simd.name);
+}
+
+/**
+ * @brief Writes @p v, or @p none if it was not measured (CSV and JSON).
+ */
+static void put_value(FILE *out, const char *prefix, double v, const char *none) {
+    if (isnan(v)) {
+        fprintf(out, "%s%s", prefix, none);
+    } else {
+        fprintf(out, "%s%.4f", prefix, v);
+    }
+}
+
+/**
+ * @brief Writes the noise fields (CSV and JSON); empty or null if noise was not sampled.
+ */
+static void put_noise(bench_report *r, const noise_sample *noise, int noisy) {
+    const int json = r->format == REPORT_JSON;
+    const char *none = json ? "null" : "";
+    static const char *const keys[] = { ", \"voluntary_switches\": ", ", \"preemptions\": ",
+                                        ", \"interrupts\": ", ", \"page_faults\": " };
+    long long v[4] = { -1, -1, -1, -1 };
+
+    if (noise) {
+        v[0] = noise->vcsw;
+        v[1] = noise->ivcsw;
+        v[2] = noise->irq;
+        v[3] = noise->faults;
+    }
+    for (int i = 0; i < 4; i++) {
+        fprintf(r->out, "%s", json ? keys[i] : ",");
+        if (v[i] >= 0) {
+            fprintf(r->out, "%lld", v[i]);
+        } else {
+            fprintf(r->out, "%s", none);
+        }
+    }
+    fprintf(r->out, "%s%s", json ? ", \"noisy\": " : ",",
+            !noise ? none : json ? (noisy ? "true" : "false") : (noisy ? "1" : "0"));
+}
+
+/**
+ * @brief Writes the row of one kernel in the report's format.
+ */
+static void report_kernel(bench_report *r, const bench_env *env, const kernel_desc *k, int warmup,
+                          const bench_stats *st, const bench_counters *pc,
+                          const noise_sample *noise, int noisy) {
+    const matrix_ctx *ctx = env->ctx;
+    const double n = ctx->n;
+    const double unit = k->order == 3 ? n * n * n : n * n;
+    const double norm = k->norm * unit;
+    const double flops = k->flops * unit;
+    const double bytes = k->bytes * n * n * sizeof(TYPE);
+    char row[64];
+
+    if (k->simd == KERNEL_PLAIN) {
+        snprintf(row, sizeof(row), "%s", k->row);
+    } else {
+        snprintf(row, sizeof(row), "%s_SIMD[%s]", k->row, k->simd == KERNEL_SIMD ? simd.name : matrix_simd_variant());
+    }
+    const double fpc = st->min > 0.0 ? flops / st->min : 0.0;
+    const double bpc = st->min > 0.0 ? bytes / st->min : 0.0;
+    const double ipc = pc->count[PC_INSTRUCTIONS] / pc->count[PC_CYCLES];
+
+    switch (r->format) {
+    case REPORT_TEXT:
+        fprintf(r->out, "%s\t", row);
+        if (st->reps > BENCH_ROW_SAMPLES) {
+            fprintf(r->out, "(%d samples)\n", st->reps);
+        }
+        for (int i = 0; i < st->reps && st->reps <= BENCH_ROW_SAMPLES; i++) {
+            fprintf(r->out, "%.3f%s", ctx->results[i] / norm, (i == st->reps - 1 ? "\n" : "\t"));
+        }
+        fprintf(r->out, "%s_STATS\tmin=%.3f\tmedian=%.3f\tci=[%.3f,%.3f]\ttmean=%.3f\tmad=%.3f"
+                        "\tsamples=%d\tkept=%d\tbimodality=%.2f%s\tflops/cycle=%.3f\tbytes/cycle=%.3f"
+                        "\tmin_ns=%.0f\tmedian_ns=%.0f\n",
+                row, st->min / norm, st->median / norm, st->ci_lo / norm, st->ci_hi / norm, st->tmean / norm,
+                st->mad / norm, st->reps, st->kept, st->bimodality, st->bimodal ? " (bimodal)" : "", fpc, bpc,
+                cycles_to_ns(st->min), cycles_to_ns(st->median));
+        if (env->counters) {
+            fprintf(r->out, "%s_COUNTERS\tipc=%.3f", row, ipc);
+            for (int e = PC_L1D_MISSES; e < PC_EVENTS; e++) {
+                fprintf(r->out, "\t%s=%.4f", perf_event_name(e), pc->count[e] / norm);
+            }
+            fprintf(r->out, "\tcoverage=%.2f\n", pc->coverage);
+        }
+        if (noise) {
+            fprintf(r->out, "%s_NOISE\tvoluntary_switches=%ld\tpreemptions=%ld\tinterrupts=%lld\tpage_faults=%ld%s\n",
+                    row, noise->vcsw, noise->ivcsw, noise->irq, noise->faults, noisy ? "\tNOISY" : "");
+        }
+        fprintf(r->out, "\n");
+        break;
+    case REPORT_CSV:
+        fprintf(r->out, "%s,%s,%d,%d,%d,%d,%d,%s,%s,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%d,"
+                        "%.0f,%.0f,%.0f,%.0f,%.4f,%.4f,%.0f,%.4f",
+                STR(TYPE), simd.name, ctx->n, ctx->ld, st->reps, st->kept, warmup, k->name, row,
+                st->min / norm, st->median / norm, st->ci_lo / norm, st->ci_hi / norm, st->tmean / norm,
+                st->mad / norm, st->bimodality, st->bimodal, st->min, st->median,
+                cycles_to_ns(st->min), cycles_to_ns(st->median), fpc, bpc, tsc_cal.overhead, tsc_cal.hz * 1e-9);
+        put_value(r->out, ",", ipc, "");
+        for (int e = PC_L1D_MISSES; e < PC_EVENTS; e++) {
+            put_value(r->out, ",", pc->count[e] / norm, "");
+        }
+        put_value(r->out, ",", pc->coverage, "");
+        put_noise(r, noise, noisy);
+        fprintf(r->out, "\n");
+        break;
+    default:
+        fprintf(r->out, "%s\n  {\"type\": \"%s\", \"simd\": \"%s\", \"n\": %d, \"ld\": %d, \"reps\": %d, "
+                        "\"kept\": %d, \"warmup\": %d, \"kernel\": \"%s\", \"row\": \"%s\", \"min\": %.4f, "
+                        "\"median\": %.4f, \"median_ci_lo\": %.4f, \"median_ci_hi\": %.4f, \"tmean\": %.4f, "
+                        "\"mad\": %.4f, \"bimodality\": %.4f, \"bimodal\": %s, "
+                        "\"min_cycles\": %.0f, \"median_cycles\": %.0f, "
+                        "\"min_ns\": %.0f, \"median_ns\": %.0f, "
+                        "\"flops_per_cycle\": %.4f, \"bytes_per_cycle\": %.4f, "
+                        "\"tsc_overhead\": %.0f, \"tsc_ghz\": %.4f",
+                r->records > 0 ? "," : "", STR(TYPE), simd.name, ctx->n, ctx->ld, st->reps, st->kept, warmup,
+                k->name, row, st->min / norm, st->median / norm, st->ci_lo / norm, st->ci_hi / norm,
+                st->tmean / norm, st->mad / norm, st->bimodality, st->bimodal ? "true" : "false",
+                st->min, st->median, cycles_to_ns(st->min), cycles_to_ns(st->median), fpc, bpc,
+                tsc_cal.overhead, tsc_cal.hz * 1e-9);
+        put_value(r->out, ", \"ipc\": ", ipc, "null");
+        for (int e = PC_L1D_MISSES; e < PC_EVENTS; e++) {
+            fprintf(r->out, ", \"%s_per_elem\": ", perf_event_name(e));
+            put_value(r->out, "", pc->count[e] / norm, "null");
+        }
+        put_value(r->out, ", \"counter_coverage\": ", pc->coverage, "null");
+        put_noise(r, noise, noisy);
+        fprintf(r->out, "}");
+        break;
+    }
+    r->records++;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int bench_kernel(bench_env *env, const kernel_desc *k, int warmup, bench_report *r) {
+    matrix_ctx *ctx = env->ctx;
+
+    env->state = NULL;
+    if (k->setup && k->setup(env) != 0) {
+        fprintf(stderr, "%s: setup failed for N=%d\n", k->name, ctx->n);
+        return -1;
+    }
+    for (int w = 0; w < warmup; w++) {
+        k->run(env);
+    }
+    bench_counters pc;
+    int counted[PC_EVENTS] = { 0 };
+    for (int e = 0; e < PC_EVENTS; e++) {
+        pc.count[e] = 0.0;
+    }
+    pc.coverage = env->counters ? 1.0 : NAN;
+
+    const bench_sampling *smp = env->sampling;
+    const int adaptive = smp->ci > 0.0;
+    const double deadline = now_seconds() + smp->budget;
+    bench_stats st;
+    noise_sample noise_start, noise;
+    int reps = 0, next_check = ctx->m, noisy = 0;
+    if (env->quiet) {
+        noise_read(env->quiet, &noise_start);
+    }
+    while (reps < ctx->m || (adaptive && reps < BENCH_MAX_REPS && now_seconds() < deadline)) {
+        if (adaptive && reps == next_check) {
+            stats_compute(ctx->results, reps, smp->filter, &st);
+            if (stats_ci_rel_width(&st) <= smp->ci) {
+                break;
+            }
+            next_check = reps + reps / 4 + 1;
+        }
+        if (reps == ctx->rcap && matrix_ctx_reserve_results(ctx, 2 * reps) != 0) {
+            break;
+        }
+        const int m = reps++;
+        perf_sample before, after;
+        trace_begin(k->name);
+        if (env->counters) {
+            perf_group_read(env->counters, &before);
+        }
+        unsigned long long start = start_timer();
+        k->run(env);
+        unsigned long long end = stop_timer();
+        if (env->counters) {
+            perf_group_read(env->counters, &after);
+        }
+        add_result(ctx, dtime(start, end), m);
+        trace_end(k->name);
+        if (env->counters) {
+            double c[PC_EVENTS];
+            double coverage = perf_group_delta(env->counters, &before, &after, c);
+            for (int e = 0; e < PC_EVENTS; e++) {
+                if (!isnan(c[e])) {
+                    pc.count[e] += c[e];
+                    counted[e]++;
+                }
+            }
+            if (coverage < pc.coverage) {
+                pc.coverage = coverage;
+            }
+        }
+    }
+    for (int e = 0; e < PC_EVENTS; e++) {
+        pc.count[e] = counted[e] > 0 ? pc.count[e] / counted[e] : NAN;
+    }
+    if (env->quiet) {
+        noise_sample noise_stop;
+        noise_read(env->quiet, &noise_stop);
+        noisy = noise_delta(&noise_start, &noise_stop, &noise);
+    }
+    stats_compute(ctx->results, reps, smp->filter, &st);
+    report_kernel(r, env, k, warmup, &st, &pc, env->quiet ? &noise : NULL, noisy);
+    if (k->finish) {
+        k->finish(env);
+    }
+    env->state = NULL;
+    return 0;
+}
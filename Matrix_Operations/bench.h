@@ -0,0 +1,151 @@
+/**
+ * @file bench.h
+ * @brief Kernel registry and benchmark runner: warm-up, timed repetitions, statistics and reports.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "matrix_ops.h"
+#include "cpu_features.h"
+#include "perf_counters.h"
+#include "stats.h"
+#include "quiet.h"
+
+#ifndef BENCH_MAX_REPS
+#define BENCH_MAX_REPS 100000 /**< Upper bound of the adaptive repetitions of one kernel */
+#endif
+
+#ifndef BENCH_ROW_SAMPLES
+#define BENCH_ROW_SAMPLES 64 /**< Text rows list the samples only up to this count */
+#endif
+
+/**
+ * @brief How many timed repetitions a kernel gets, and how they are summarized.
+ *
+ * With ci = 0 a kernel gets exactly ctx->m repetitions. Otherwise it gets at least ctx->m, then
+ * more until the median's interval is narrower than ci * median, the budget is spent or
+ * BENCH_MAX_REPS is reached: short kernels get thousands of samples, long ones only a few.
+ */
+typedef struct {
+    double ci;     /**< Target relative width of the median's interval (e.g. 0.01), 0 for a fixed count */
+    double budget; /**< Seconds per kernel of adaptive sampling (timed runs and statistics) */
+    int filter;    /**< outlier_filter */
+} bench_sampling;
+
+/**
+ * @brief State shared by the kernels of one size.
+ */
+typedef struct {
+    matrix_ctx *ctx;           /**< Buffers, size and repetitions */
+    const cpu_caches *caches;  /**< Detected cache geometry (tiled multiplication) */
+    int crossover;             /**< Strassen-Winograd crossover size */
+    FILE *notes;               /**< Where kernels print plans and error checks */
+    perf_group *counters;      /**< Hardware counters read around each timed run, NULL if not collected */
+    const bench_sampling *sampling; /**< Repetitions and outlier filter */
+    const quiet_state *quiet;  /**< Quiet-run state; noise is sampled around each kernel unless NULL */
+    void *state;               /**< Kernel-private state created by setup, released by finish */
+} bench_env;
+
+/**
+ * @brief How the report row of a kernel names its SIMD variant.
+ */
+typedef enum {
+    KERNEL_PLAIN = 0,   /**< Row printed as is */
+    KERNEL_SIMD = 1,    /**< "<row>_SIMD[simd.name]" (byte-level primitives, any TYPE) */
+    KERNEL_SIMD_TYPED = 2 /**< "<row>_SIMD[matrix_simd_variant()]" (float/double primitives) */
+} kernel_simd;
+
+/**
+ * @brief One registered kernel.
+ *
+ * Work is described per unit = n^order: results are reported in cycles per
+ * (norm * unit), flops = flops * unit and the compulsory traffic is
+ * bytes * n^2 * sizeof(TYPE).
+ */
+typedef struct {
+    const char *name;  /**< Name used by --kernel (e.g. "mm_ikj") */
+    const char *row;   /**< Report row (e.g. "MATRIX_MULT_IKJ") */
+    int simd;          /**< Row naming (kernel_simd) */
+    int order;         /**< 2 for vector/matrix sweeps, 3 for multiplications */
+    double norm;       /**< Normalization units per n^order */
+    double flops;      /**< Arithmetic operations per n^order */
+    double bytes;      /**< Compulsory traffic in elements per n^2 */
+    int (*setup)(bench_env *env);   /**< Untimed preparation, NULL if none; 0 on success */
+    void (*run)(bench_env *env);    /**< One execution */
+    void (*finish)(bench_env *env); /**< Untimed check and cleanup, NULL if none */
+} kernel_desc;
+
+extern const kernel_desc kernel_table[]; /**< Registered kernels, in report order */
+extern const int kernel_count;           /**< Entries of kernel_table */
+
+/**
+ * @brief Whether a kernel name matches a comma-separated list of glob patterns ("mm_*,dot").
+ *
+ * A NULL or empty list matches every kernel.
+ */
+int kernel_match(const char *name, const char *patterns);
+
+/**
+ * @brief Output format of a report.
+ */
+typedef enum {
+    REPORT_TEXT = 0, /**< Tab-separated rows of normalized cycles plus a _STATS row */
+    REPORT_CSV = 1,  /**< One line per kernel and size, with a header */
+    REPORT_JSON = 2  /**< One array of objects, one per kernel and size */
+} report_format;
+
+/**
+ * @brief Destination of the benchmark results.
+ */
+typedef struct {
+    FILE *out;
+    int format;   /**< report_format */
+    int records;  /**< Records written so far */
+} bench_report;
+
+/**
+ * @brief Hardware counters of the timed repetitions of one kernel.
+ */
+typedef struct {
+    double count[PC_EVENTS]; /**< Mean scaled count per run, NAN if not collected */
+    double coverage;         /**< Smallest fraction of a run during which the counters were scheduled */
+} bench_counters;
+
+/**
+ * @brief Parses "text", "csv" or "json".
+ * @return The report_format, or -1 if unknown.
+ */
+int report_parse_format(const char *name);
+
+/**
+ * @brief Opens a report on @p path (stdout if NULL or "-") and writes its header.
+ *
+ * Text reports start with the TSC calibration; CSV and JSON records carry its overhead and frequency.
+ * @return 0 on success, -1 if the file cannot be created.
+ */
+int report_open(bench_report *r, const char *path, int format);
+
+/**
+ * @brief Writes the trailer of the report and closes its file.
+ */
+void report_close(bench_report *r);
+
+/**
+ * @brief Prints the header of one evaluated size (text reports only).
+ */
+void report_size(bench_report *r, const bench_env *env);
+
+/**
+ * @brief Runs one kernel: setup, @p warmup untimed runs, the timed runs chosen by env->sampling,
+ *        finish, then reports it.
+ *
+ * With env->counters, the counters are read just outside start_timer()/stop_timer() of every
+ * timed run and the report adds the IPC and the misses per element (per normalization unit).
+ * With env->quiet, context switches and interrupts are counted from the first to the last timed
+ * run and the kernel is flagged noisy if any happened.
+ * @return 0 on success, -1 if its setup failed (nothing is reported).
+ */
+int bench_kernel(bench_env *env, const kernel_desc *k, int warmup, bench_report *r);
+
+#endif /* BENCH_H */
@@ -0,0 +1,141 @@
+/**
+ * @file cpu_features.c
+ * @brief CPUID/XGETBV based feature detection and sysfs cache geometry.
+ */
+
+#include "cpu_features.h"
+#include <cpuid.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * @brief Reads extended control register 0 (enabled register state).
+ */
+static unsigned long long xgetbv0(void) {
+    unsigned int lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((unsigned long long)hi << 32) | lo;
+}
+
+void cpu_detect(cpu_features *f) {
+    unsigned int eax, ebx, ecx, edx, max_leaf;
+
+    memset(f, 0, sizeof(*f));
+    if (!__get_cpuid(0, &max_leaf, &ebx, &ecx, &edx)) {
+        return;
+    }
+    memcpy(f->vendor, &ebx, 4);
+    memcpy(f->vendor + 4, &edx, 4);
+    memcpy(f->vendor + 8, &ecx, 4);
+
+    __cpuid(1, eax, ebx, ecx, edx);
+    f->sse2 = (edx >> 26) & 1;
+    int osxsave = (ecx >> 27) & 1;
+    int cpu_avx = (ecx >> 28) & 1;
+    int cpu_fma = (ecx >> 12) & 1;
+
+    /* The OS must save XMM|YMM (bits 1-2) and, for AVX-512, opmask|ZMM (bits 5-7). */
+    unsigned long long xcr0 = osxsave ? xgetbv0() : 0;
+    int ymm_state = (xcr0 & 0x6) == 0x6;
+    int zmm_state = (xcr0 & 0xe6) == 0xe6;
+
+    f->avx = cpu_avx && ymm_state;
+    f->fma = cpu_fma && ymm_state;
+    if (max_leaf >= 7) {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        f->avx2 = f->avx && ((ebx >> 5) & 1);
+        f->avx512f = zmm_state && ((ebx >> 16) & 1);
+    }
+}
+
+/**
+ * @brief Reads the first line of a sysfs attribute.
+ * @return 0 on success, -1 if the file cannot be read.
+ */
+static int read_attr(const char *dir, const char *attr, char *buf, int len) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", dir, attr);
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return -1;
+    }
+    int ok = fgets(buf, len, f) != NULL;
+    fclose(f);
+    buf[strcspn(buf, "\n")] = '\0';
+    return ok ? 0 : -1;
+}
+
+/**
+ * @brief Parses a sysfs size such as "48K" or "16M" into bytes.
+ */
+static int parse_size(const char *s) {
+    char unit = 0;
+    int v = 0;
+    if (sscanf(s, "%d%c", &v, &unit) < 1) {
+        return 0;
+    }
+    if (unit == 'K') return v << 10;
+    if (unit == 'M') return v << 20;
+    if (unit == 'G') return v << 30;
+    return v;
+}
+
+/**
+ * @brief Reads 4 KB-page data/unified TLB sizes from CPUID leaf 0x18 (deterministic address translation).
+ */
+static void detect_tlbs(cpu_caches *c) {
+    unsigned int max_leaf, eax, ebx, ecx, edx;
+    c->dtlb_entries = DEFAULT_DTLB_ENTRIES;
+    c->stlb_entries = DEFAULT_STLB_ENTRIES;
+    if (!__get_cpuid(0, &max_leaf, &ebx, &ecx, &edx) || max_leaf < 0x18) {
+        return;
+    }
+    __cpuid_count(0x18, 0, eax, ebx, ecx, edx);
+    unsigned int max_sub = eax;
+    for (unsigned int sub = 0; sub <= max_sub && sub < 64; sub++) {
+        __cpuid_count(0x18, sub, eax, ebx, ecx, edx);
+        unsigned int type = edx & 0x1f, level = (edx >> 5) & 0x7;
+        int entries = (int)((ebx >> 16) * ecx);
+        if (!(ebx & 0x1) || entries <= 0) {
+            continue; /* invalid sub-leaf or no 4 KB support */
+        }
+        if (level == 1 && (type == 1 || type == 3 || type == 4)) {
+            c->dtlb_entries = entries;
+        } else if (level == 2 && (type == 3 || type == 1)) {
+            c->stlb_entries = entries;
+        }
+    }
+}
+
+int cpu_detect_caches(cpu_caches *c) {
+    memset(c, 0, sizeof(*c));
+    for (int idx = 0; idx < 16; idx++) {
+        char dir[128], buf[64];
+        snprintf(dir, sizeof(dir), "/sys/devices/system/cpu/cpu0/cache/index%d", idx);
+        if (read_attr(dir, "level", buf, sizeof(buf)) != 0) {
+            break;
+        }
+        int level = 0;
+        sscanf(buf, "%d", &level);
+        if (read_attr(dir, "type", buf, sizeof(buf)) != 0 || strcmp(buf, "Instruction") == 0) {
+            continue;
+        }
+        cache_level_info info = { 0, 64, 0 };
+        if (read_attr(dir, "size", buf, sizeof(buf)) == 0) info.size = parse_size(buf);
+        if (read_attr(dir, "coherency_line_size", buf, sizeof(buf)) == 0) sscanf(buf, "%d", &info.line);
+        if (read_attr(dir, "ways_of_associativity", buf, sizeof(buf)) == 0) sscanf(buf, "%d", &info.ways);
+        if (level == 1) c->l1d = info;
+        else if (level == 2) c->l2 = info;
+        else if (level == 3) c->l3 = info;
+        c->from_sysfs = 1;
+    }
+
+    if (c->l1d.size == 0) c->l1d = (cache_level_info){ DEFAULT_L1D_SIZE, 64, 8 };
+    if (c->l2.size == 0) c->l2 = (cache_level_info){ DEFAULT_L2_SIZE, 64, 8 };
+    if (c->l3.size == 0) c->l3 = (cache_level_info){ DEFAULT_L3_SIZE, 64, 16 };
+    long page = sysconf(_SC_PAGESIZE);
+    c->page_size = page > 0 ? (int)page : 4096;
+    detect_tlbs(c);
+    return c->from_sysfs ? 0 : -1;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file cpu_features.h
+ * @brief Runtime detection of the x86 instruction set extensions used by the SIMD kernels
+ *        and of the data cache geometry used to size blocks.
+ */
+
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+/**
+ * @brief Instruction set extensions usable by this process (CPU and OS support).
+ */
+typedef struct {
+    char vendor[13]; /**< CPUID vendor string, e.g. "GenuineIntel" */
+    int sse2;        /**< SSE2 (always set on x86-64) */
+    int avx;         /**< AVX with YMM state enabled by the OS */
+    int avx2;        /**< AVX2 */
+    int fma;         /**< FMA3 */
+    int avx512f;     /**< AVX-512 Foundation with ZMM/opmask state enabled by the OS */
+} cpu_features;
+
+/**
+ * @brief Queries CPUID (and XGETBV for OS register state support).
+ * @param f Structure filled with the detected features.
+ */
+void cpu_detect(cpu_features *f);
+
+/**
+ * @brief Geometry of one cache level.
+ */
+typedef struct {
+    int size; /**< Capacity in bytes */
+    int line; /**< Line size in bytes */
+    int ways; /**< Associativity */
+} cache_level_info;
+
+/**
+ * @brief Data/unified cache hierarchy seen by CPU 0.
+ */
+typedef struct {
+    cache_level_info l1d;
+    cache_level_info l2;
+    cache_level_info l3;
+    int dtlb_entries; /**< First-level data TLB entries for base pages */
+    int stlb_entries; /**< Second-level (shared) TLB entries for base pages */
+    int page_size;    /**< Base page size in bytes */
+    int from_sysfs;   /**< 0 if sysfs was unavailable and the defaults below were used */
+} cpu_caches;
+
+/** @brief Fallback sizes when sysfs cannot be read. */
+#define DEFAULT_L1D_SIZE (32 << 10)
+#define DEFAULT_L2_SIZE  (256 << 10)
+#define DEFAULT_L3_SIZE  (8 << 20)
+#define DEFAULT_DTLB_ENTRIES 64
+#define DEFAULT_STLB_ENTRIES 1536
+
+/**
+ * @brief Reads the cache hierarchy from /sys/devices/system/cpu/cpu0/cache/index*.
+ *
+ * TLB sizes come from CPUID leaf 0x18 (Intel) when available, otherwise the defaults.
+ * @param c Structure filled with the detected (or default) geometry.
+ * @return 0 if read from sysfs, -1 if the defaults were used.
+ */
+int cpu_detect_caches(cpu_caches *c);
+
+#endif /* CPU_FEATURES_H */
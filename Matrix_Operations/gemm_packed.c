@@ -0,0 +1,200 @@
+/**
+ * @file gemm_packed.c
+ * @brief Implementation of the packed, register-blocked matrix multiplication.
+ *
+ * Loop nest (outer to inner): jc over GEMM_NC columns of B, pc over GEMM_KC of the
+ * shared dimension (pack B), ic over GEMM_MC rows of A (pack A), then jr/ir over the
+ * nr x GEMM_MR register tiles handed to the micro-kernel. The micro-kernel is built once per
+ * instruction set with a target attribute (as in simd_kernels.c) and its tile width follows
+ * the vector width, so the accumulators never exceed the register file.
+ */
+
+#include "gemm_packed.h"
+#include "simd_kernels.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Computes the minimum of two integers.
+ */
+static inline int min(int a, int b) {
+    return (a < b) ? a : b;
+}
+
+/**
+ * @brief Packs an mc x kc block of A into GEMM_MR-row slivers, zero-padding the last one.
+ */
+static void pack_a(int mc, int kc, const TYPE *A, size_t lda, TYPE *restrict Ap) {
+    for (int ir = 0; ir < mc; ir += GEMM_MR) {
+        int mr = min(GEMM_MR, mc - ir);
+        for (int p = 0; p < kc; p++) {
+            for (int i = 0; i < mr; i++) {
+                Ap[i] = A[(size_t)(ir + i) * lda + p];
+            }
+            for (int i = mr; i < GEMM_MR; i++) {
+                Ap[i] = ZERO;
+            }
+            Ap += GEMM_MR;
+        }
+    }
+}
+
+/**
+ * @brief Packs a kc x nc block of B into @p tile_nr-column slivers, zero-padding the last one.
+ */
+static void pack_b(int kc, int nc, const TYPE *B, size_t ldb, TYPE *restrict Bp, int tile_nr) {
+    for (int jr = 0; jr < nc; jr += tile_nr) {
+        int nr = min(tile_nr, nc - jr);
+        for (int p = 0; p < kc; p++) {
+            const TYPE *b = B + (size_t)p * ldb + jr;
+            for (int j = 0; j < nr; j++) {
+                Bp[j] = b[j];
+            }
+            for (int j = nr; j < tile_nr; j++) {
+                Bp[j] = ZERO;
+            }
+            Bp += tile_nr;
+        }
+    }
+}
+
+/**
+ * @brief Defines micro_<isa>(), the GEMM_MR x (2 * @p vbytes / sizeof(TYPE)) micro-kernel built
+ *        for target @p tgt with GCC vector types of @p vbytes bytes.
+ *
+ * Each tile row has two vector accumulators, so the 2 * GEMM_MR chains of multiply-adds are
+ * independent and stay in registers (FMA where the target has it); nothing is stored to
+ * memory until the kc loop is done. Only the mr x nr valid part of the tile is written to C.
+ */
+#define GEMM_MICRO_KERNEL(isa, tgt, vbytes)                                                           \
+    typedef TYPE gemm_vec_##isa __attribute__((vector_size(vbytes)));                                 \
+    __attribute__((target(tgt))) static void micro_##isa(int kc, const TYPE *restrict a,              \
+                                                         const TYPE *restrict b, TYPE *restrict C,    \
+                                                         size_t ldc, int mr, int nr, int accumulate) { \
+        enum { VL = (vbytes) / (int)sizeof(TYPE), NR = 2 * VL };                                      \
+        gemm_vec_##isa acc0[GEMM_MR], acc1[GEMM_MR];                                                  \
+        for (int i = 0; i < GEMM_MR; i++) {                                                           \
+            acc0[i] = (gemm_vec_##isa){ ZERO };                                                       \
+            acc1[i] = (gemm_vec_##isa){ ZERO };                                                       \
+        }                                                                                             \
+        for (int p = 0; p < kc; p++) {                                                                \
+            gemm_vec_##isa b0, b1;                                                                    \
+            memcpy(&b0, b, sizeof(b0));                                                               \
+            memcpy(&b1, b + VL, sizeof(b1));                                                          \
+            for (int i = 0; i < GEMM_MR; i++) {                                                       \
+                acc0[i] += a[i] * b0;                                                                 \
+                acc1[i] += a[i] * b1;                                                                 \
+            }                                                                                         \
+            a += GEMM_MR;                                                                             \
+            b += NR;                                                                                  \
+        }                                                                                             \
+        for (int i = 0; i < mr; i++) {                                                                \
+            TYPE *c = C + (size_t)i * ldc;                                                            \
+            if (nr == NR) {                                                                           \
+                gemm_vec_##isa c0 = acc0[i], c1 = acc1[i];                                            \
+                if (accumulate) {                                                                     \
+                    gemm_vec_##isa o0, o1;                                                            \
+                    memcpy(&o0, c, sizeof(o0));                                                       \
+                    memcpy(&o1, c + VL, sizeof(o1));                                                  \
+                    c0 += o0;                                                                         \
+                    c1 += o1;                                                                         \
+                }                                                                                     \
+                memcpy(c, &c0, sizeof(c0));                                                           \
+                memcpy(c + VL, &c1, sizeof(c1));                                                      \
+            } else {                                                                                  \
+                for (int j = 0; j < nr; j++) {                                                        \
+                    TYPE v = j < VL ? acc0[i][j] : acc1[i][j - VL];                                   \
+                    c[j] = accumulate ? c[j] + v : v;                                                 \
+                }                                                                                     \
+            }                                                                                         \
+        }                                                                                             \
+    }
+
+GEMM_MICRO_KERNEL(sse2, "sse2", 16)
+GEMM_MICRO_KERNEL(avx2, "avx2,fma", 32)
+GEMM_MICRO_KERNEL(avx512, "avx512f", 64)
+
+typedef void (*gemm_micro)(int kc, const TYPE *restrict a, const TYPE *restrict b, TYPE *restrict C,
+                           size_t ldc, int mr, int nr, int accumulate);
+
+/** @brief Micro-kernels by instruction set; simd_select() has already checked the CPU supports it. */
+static const struct {
+    const char *isa;
+    int vbytes;
+    gemm_micro kernel;
+} variants[] = {
+    { "sse2", 16, micro_sse2 },
+    { "avx2", 32, micro_avx2 },
+    { "avx512", 64, micro_avx512 },
+};
+
+const char *gemm_workspace_isa(const gemm_workspace *ws) {
+    return variants[ws->variant].isa;
+}
+
+int gemm_workspace_init(gemm_workspace *ws, int mc, int kc, int nc) {
+    memset(ws, 0, sizeof(*ws));
+    if (mc <= 0 || kc <= 0 || nc <= 0) {
+        return -1;
+    }
+    for (int v = 0; v < (int)(sizeof(variants) / sizeof(variants[0])); v++) {
+        if (strcmp(simd.name, variants[v].isa) == 0) {
+            ws->variant = v;
+        }
+    }
+    ws->nr = 2 * variants[ws->variant].vbytes / (int)sizeof(TYPE);
+    ws->mc = (mc + GEMM_MR - 1) / GEMM_MR * GEMM_MR;
+    ws->kc = kc;
+    ws->nc = (nc + ws->nr - 1) / ws->nr * ws->nr;
+    void *a = NULL, *b = NULL;
+    if (posix_memalign(&a, MATRIX_ALIGN, (size_t)ws->mc * ws->kc * sizeof(TYPE)) != 0) {
+        return -1;
+    }
+    if (posix_memalign(&b, MATRIX_ALIGN, (size_t)ws->kc * ws->nc * sizeof(TYPE)) != 0) {
+        free(a);
+        return -1;
+    }
+    ws->Ap = a;
+    ws->Bp = b;
+    return 0;
+}
+
+void gemm_workspace_free(gemm_workspace *ws) {
+    free(ws->Ap);
+    free(ws->Bp);
+    ws->Ap = ws->Bp = NULL;
+}
+
+void gemm_packed(gemm_workspace *ws, int m, int n, int k,
+                 const TYPE *A, size_t lda, const TYPE *B, size_t ldb,
+                 TYPE *C, size_t ldc, int accumulate) {
+    const gemm_micro micro = variants[ws->variant].kernel;
+    const int tile_nr = ws->nr;
+
+    for (int jc = 0; jc < n; jc += ws->nc) {
+        int nc = min(ws->nc, n - jc);
+        for (int pc = 0; pc < k; pc += ws->kc) {
+            int kc = min(ws->kc, k - pc);
+            int acc = accumulate || pc > 0;
+            trace_begin("pack_b");
+            pack_b(kc, nc, B + (size_t)pc * ldb + jc, ldb, ws->Bp, tile_nr);
+            trace_end("pack_b");
+            for (int ic = 0; ic < m; ic += ws->mc) {
+                int mc = min(ws->mc, m - ic);
+                trace_begin("pack_a");
+                pack_a(mc, kc, A + (size_t)ic * lda + pc, lda, ws->Ap);
+                trace_end("pack_a");
+                trace_begin("macro_kernel");
+                for (int jr = 0; jr < nc; jr += tile_nr) {
+                    for (int ir = 0; ir < mc; ir += GEMM_MR) {
+                        micro(kc, ws->Ap + (size_t)ir * kc, ws->Bp + (size_t)jr * kc,
+                              C + (size_t)(ic + ir) * ldc + jc + jr, ldc,
+                              min(GEMM_MR, mc - ir), min(tile_nr, nc - jr), acc);
+                    }
+                }
+                trace_end("macro_kernel");
+            }
+        }
+    }
+}
@@ -0,0 +1,67 @@
+/**
+ * @file gemm_packed.h
+ * @brief Packed, register-blocked general matrix multiplication (GotoBLAS/BLIS style).
+ */
+
+#ifndef GEMM_PACKED_H
+#define GEMM_PACKED_H
+
+#include "matrix_ops.h"
+
+/**
+ * @brief Aligned packing buffers reused across calls of gemm_packed().
+ */
+typedef struct {
+    int mc;   /**< Rows of the packed A panel */
+    int kc;   /**< Depth of the packed panels */
+    int nc;   /**< Columns of the packed B panel */
+    int variant; /**< Micro-kernel, chosen from simd.name by gemm_workspace_init() */
+    int nr;      /**< Columns of its register tile: two vectors of the ISA */
+    TYPE *Ap; /**< Packed MC x KC panel of A, GEMM_MR-row slivers stored k-major */
+    TYPE *Bp; /**< Packed KC x NC panel of B, nr-column slivers stored k-major */
+} gemm_workspace;
+
+/**
+ * @brief Allocates the packing buffers for the given panel sizes and picks the micro-kernel
+ *        of the selected SIMD variant (the SSE2 one for "scalar").
+ *
+ * Every micro-kernel computes a GEMM_MR x nr tile with GEMM_MR x 2 vector accumulators
+ * (12 for the default GEMM_MR), which fit in the 16 registers of SSE2 and AVX2.
+ * @param ws Workspace to initialize.
+ * @param mc Rows of the A panel, rounded up to a multiple of GEMM_MR.
+ * @param kc Depth of the panels.
+ * @param nc Columns of the B panel, rounded up to a multiple of the micro-kernel's nr.
+ * @return 0 on success, -1 on invalid sizes or allocation failure.
+ */
+int gemm_workspace_init(gemm_workspace *ws, int mc, int kc, int nc);
+
+/**
+ * @brief Name of the instruction set of the workspace's micro-kernel ("sse2", "avx2" or "avx512").
+ */
+const char *gemm_workspace_isa(const gemm_workspace *ws);
+
+/**
+ * @brief Releases the packing buffers.
+ * @param ws Workspace to release.
+ */
+void gemm_workspace_free(gemm_workspace *ws);
+
+/**
+ * @brief Computes C = A * B (or C += A * B) for row-major operands.
+ * @param ws Packing buffers.
+ * @param m Rows of A and C.
+ * @param n Columns of B and C.
+ * @param k Columns of A, rows of B.
+ * @param A Left operand, row stride @p lda.
+ * @param lda Leading dimension of A.
+ * @param B Right operand, row stride @p ldb.
+ * @param ldb Leading dimension of B.
+ * @param C Result, row stride @p ldc.
+ * @param ldc Leading dimension of C.
+ * @param accumulate Nonzero to add the product to C instead of overwriting it.
+ */
+void gemm_packed(gemm_workspace *ws, int m, int n, int k,
+                 const TYPE *A, size_t lda, const TYPE *B, size_t ldb,
+                 TYPE *C, size_t ldc, int accumulate);
+
+#endif /* GEMM_PACKED_H */
@@ -0,0 +1,111 @@
+/**
+ * @file gemm_tiled.c
+ * @brief Implementation of the multi-level (L1/L2/L3/TLB) tiled multiplication.
+ */
+
+#include "gemm_tiled.h"
+#include <math.h>
+#include <string.h>
+
+static inline int min(int a, int b) {
+    return (a < b) ? a : b;
+}
+
+/**
+ * @brief Distinct pages touched by a rows x cols block of a matrix with row stride ld:
+ *        each row covers ceil(cols / page) pages, unless rows are close enough to share them.
+ */
+static long block_pages(int rows, int cols, int ld, int page) {
+    const long es = (long)sizeof(TYPE);
+    const long per_row = ((long)cols * es + page - 1) / page;
+    const long span = ((long)(rows - 1) * ld + cols) * es;
+    const long dense = (span + page - 1) / page;
+    return rows * per_row < dense ? rows * per_row : dense;
+}
+
+/**
+ * @brief Largest edge, a multiple of step (at least step, at most n), whose pages fit in the TLB:
+ *        a T x T tile of XF plus one row of AF and YF for the first-level dTLB (level 0),
+ *        the three T x T tiles for the STLB (level 1).
+ */
+static int tlb_edge(int level, int entries, int step, int n, int ld, int page) {
+    int t = step;
+    for (int next = step; next <= n; next += step) {
+        long pages = level == 0 ? block_pages(next, next, ld, page) + 2 * block_pages(1, next, ld, page)
+                                : 3 * block_pages(next, next, ld, page);
+        if (pages > entries) {
+            break;
+        }
+        t = next;
+    }
+    return t;
+}
+
+void tile_plan_compute(const cpu_caches *caches, int n, int ld, tile_plan *plan) {
+    const int es = (int)sizeof(TYPE);
+    const int capacity[3] = { caches->l1d.size, caches->l2.size, caches->l3.size / 2 };
+    const int tlb_entries[2] = { caches->dtlb_entries, caches->stlb_entries };
+    int below = caches->l1d.line / es > 0 ? caches->l1d.line / es : 1;
+
+    memset(plan, 0, sizeof(*plan));
+    for (int level = 0; level < 3; level++) {
+        int t = (int)sqrt(capacity[level] / (3.0 * es));
+        t = t / below * below;
+        if (level < 2) {
+            plan->tlb_cap[level] = tlb_edge(level, tlb_entries[level], below, n, ld, caches->page_size);
+            if (t > plan->tlb_cap[level]) {
+                t = plan->tlb_cap[level];
+            }
+        }
+        if (t < below) {
+            t = below;
+        }
+        if (t > n) {
+            t = n;
+        }
+        plan->tile[level] = t;
+        below = t;
+    }
+}
+
+/**
+ * @brief Walks the tiles of one level (i, k, j order) and recurses into the level below.
+ */
+static void tiled_level(matrix_ctx *ctx, const tile_plan *plan, int level,
+                        int i0, int i1, int k0, int k1, int j0, int j1) {
+    const size_t ld = ctx->ld;
+
+    if (level < 0) {
+        const TYPE *AF = ctx->AF, *XF = ctx->XF;
+        TYPE *YF = ctx->YF;
+        for (int i = i0; i < i1; i++) {
+            TYPE *y = YF + i * ld;
+            for (int k = k0; k < k1; k++) {
+                const TYPE a = AF[i * ld + k];
+                const TYPE *x = XF + k * ld;
+                for (int j = j0; j < j1; j++) {
+                    y[j] += a * x[j];
+                }
+            }
+        }
+        return;
+    }
+
+    const int t = plan->tile[level];
+    for (int i = i0; i < i1; i += t) {
+        for (int k = k0; k < k1; k += t) {
+            for (int j = j0; j < j1; j += t) {
+                tiled_level(ctx, plan, level - 1, i, min(i + t, i1), k, min(k + t, k1), j, min(j + t, j1));
+            }
+        }
+    }
+}
+
+void matrix_mult_tiled_run(matrix_ctx *ctx, const tile_plan *plan) {
+    const int n = ctx->n;
+    const size_t ld = ctx->ld;
+    for (int i = 0; i < n; i++) {
+        memset(ctx->YF + i * ld, 0, (size_t)n * sizeof(TYPE));
+    }
+    tiled_level(ctx, plan, 2, 0, n, 0, n, 0, n);
+}
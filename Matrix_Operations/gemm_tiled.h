@@ -0,0 +1,37 @@
+/**
+ * @file gemm_tiled.h
+ * @brief Blocked multiplication tiled separately for L1, L2, L3 and the TLB reach.
+ */
+
+#ifndef GEMM_TILED_H
+#define GEMM_TILED_H
+
+#include "matrix_ops.h"
+#include "cpu_features.h"
+
+/**
+ * @brief Square tile edges for each cache level, derived from the cache geometry.
+ */
+typedef struct {
+    int tile[3];    /**< Tile edge for L1 (tile[0]), L2 (tile[1]) and L3 (tile[2]) */
+    int tlb_cap[2]; /**< Largest edge the first-level dTLB (L1 tile) and STLB (L2 tile) can map */
+} tile_plan;
+
+/**
+ * @brief Chooses the tile of each level for n x n matrices with row stride ld.
+ *
+ * Level c holds three T x T tiles (AF, XF, YF): 3 T^2 sizeof(TYPE) <= capacity, with half
+ * of the (shared) L3. Tiles are multiples of a cache line of elements and of the tile
+ * below. Each tile is also capped so that the distinct pages it touches (rows times the
+ * pages a row of the tile spans, fewer when rows share pages) fit in the TLB: the pages
+ * of the XF tile plus one row of AF and YF in the first-level dTLB for the L1 tile (the
+ * inner ikj sweep), those of the three tiles in the STLB for the L2 tile.
+ */
+void tile_plan_compute(const cpu_caches *caches, int n, int ld, tile_plan *plan);
+
+/**
+ * @brief One untimed multi-level tiled multiplication AF * XF = YF.
+ */
+void matrix_mult_tiled_run(matrix_ctx *ctx, const tile_plan *plan);
+
+#endif /* GEMM_TILED_H */
@@ -0,0 +1,285 @@
+/**
+ * @file kernels.c
+ * @brief Registry of the benchmarked kernels: names, work counts and setup/run/finish hooks.
+ */
+
+#include "bench.h"
+#include "gemm_packed.h"
+#include "gemm_tiled.h"
+#include "morton.h"
+#include "strassen.h"
+#include "transpose.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static inline int min(int a, int b) {
+    return (a < b) ? a : b;
+}
+
+/** @brief Defines run_<fn>(env), calling the single-run kernel fn(ctx). */
+#define CTX_KERNEL(fn) \
+    static void run_##fn(bench_env *env) { fn(env->ctx); }
+
+CTX_KERNEL(zero_vector)
+CTX_KERNEL(zero_vector_simd)
+CTX_KERNEL(copy_matrix_ij)
+CTX_KERNEL(copy_matrix_ij_simd)
+CTX_KERNEL(copy_matrix_ji)
+CTX_KERNEL(add_matrix_ij)
+CTX_KERNEL(add_matrix_ij_simd)
+CTX_KERNEL(add_matrix_ji)
+CTX_KERNEL(scalar_product)
+CTX_KERNEL(scalar_product_opt)
+CTX_KERNEL(scalar_product_simd)
+CTX_KERNEL(matrix_mult_ijk)
+CTX_KERNEL(matrix_mult_ikj)
+CTX_KERNEL(matrix_mult_blocked)
+CTX_KERNEL(matrix_mult_trans_ijk)
+
+/**
+ * @brief Prints the largest and the relative Frobenius error of YF against the transposed i-j-k product.
+ *
+ * YF is replaced by the reference.
+ */
+static void check_error(bench_env *env, const char *row) {
+    matrix_ctx *ctx = env->ctx;
+    const int n = ctx->n;
+    const size_t ld = ctx->ld;
+    TYPE *result = malloc((size_t)n * ld * sizeof(TYPE));
+    if (!result) {
+        return;
+    }
+
+    memcpy(result, ctx->YF, (size_t)n * ld * sizeof(TYPE));
+    matrix_mult_trans_ijk_run(ctx);
+    double max_abs = 0.0, diff2 = 0.0, ref2 = 0.0;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            double ref = (double)ctx->YF[i * ld + j];
+            double d = (double)result[i * ld + j] - ref;
+            if (fabs(d) > max_abs) max_abs = fabs(d);
+            diff2 += d * d;
+            ref2 += ref * ref;
+        }
+    }
+    fprintf(env->notes, "%s_ERROR\tmax_abs=%.3e\trel_fro=%.3e\n\n", row, max_abs,
+            ref2 > 0.0 ? sqrt(diff2 / ref2) : sqrt(diff2));
+    free(result);
+}
+
+/* ----------------------------------------------------------------
+   Transposes
+   ---------------------------------------------------------------- */
+
+static void run_transpose_naive(bench_env *env) {
+    matrix_ctx *ctx = env->ctx;
+    transpose_naive(ctx->n, ctx->n, ctx->XF, ctx->ld, ctx->YT, ctx->ld);
+}
+
+static void run_transpose(bench_env *env) {
+    matrix_ctx *ctx = env->ctx;
+    transpose(ctx->n, ctx->n, ctx->XF, ctx->ld, ctx->YT, ctx->ld);
+}
+
+static void run_transpose_inplace(bench_env *env) {
+    transpose_inplace(env->ctx->n, env->ctx->YT, env->ctx->ld);
+}
+
+/** @brief XT for matrix_mult_trans_ijk(). */
+static int setup_trans_ijk(bench_env *env) {
+    run_transpose(env);
+    return 0;
+}
+
+/* ----------------------------------------------------------------
+   Tiled and packed multiplications
+   ---------------------------------------------------------------- */
+
+static int setup_tiled(bench_env *env) {
+    tile_plan *plan = malloc(sizeof(*plan));
+    if (!plan) {
+        return -1;
+    }
+    tile_plan_compute(env->caches, env->ctx->n, env->ctx->ld, plan);
+    fprintf(env->notes, "MATRIX_MULT_TILED_PLAN\tL1=%d\tL2=%d\tL3=%d\tdTLB_cap=%d\tSTLB_cap=%d\n",
+            plan->tile[0], plan->tile[1], plan->tile[2], plan->tlb_cap[0], plan->tlb_cap[1]);
+    env->state = plan;
+    return 0;
+}
+
+static void run_tiled(bench_env *env) {
+    matrix_mult_tiled_run(env->ctx, env->state);
+}
+
+/** @brief Releases a state allocated with a single malloc(). */
+static void finish_free(bench_env *env) {
+    free(env->state);
+}
+
+static int setup_packed(bench_env *env) {
+    const int n = env->ctx->n;
+    gemm_workspace *ws = malloc(sizeof(*ws));
+    if (!ws || gemm_workspace_init(ws, min(GEMM_MC, n), min(GEMM_KC, n), min(GEMM_NC, n)) != 0) {
+        free(ws);
+        return -1;
+    }
+    fprintf(env->notes, "MATRIX_MULT_PACKED_PLAN\tisa=%s\tMR=%d\tNR=%d\tMC=%d\tKC=%d\tNC=%d\n",
+            gemm_workspace_isa(ws), GEMM_MR, ws->nr, ws->mc, ws->kc, ws->nc);
+    env->state = ws;
+    return 0;
+}
+
+static void run_packed(bench_env *env) {
+    matrix_ctx *ctx = env->ctx;
+    gemm_packed(env->state, ctx->n, ctx->n, ctx->n, ctx->AF, ctx->ld, ctx->XF, ctx->ld, ctx->YF, ctx->ld, 0);
+}
+
+static void finish_packed(bench_env *env) {
+    check_error(env, "MATRIX_MULT_PACKED");
+    gemm_workspace_free(env->state);
+    free(env->state);
+}
+
+/* ----------------------------------------------------------------
+   Morton layout
+   ---------------------------------------------------------------- */
+
+/**
+ * @brief Morton copies of AF, XF and YF.
+ */
+typedef struct {
+    morton_layout l;
+    TYPE *A, *B, *C;
+} morton_state;
+
+static void finish_morton(bench_env *env) {
+    morton_state *s = env->state;
+    free(s->A);
+    free(s->B);
+    free(s->C);
+    free(s);
+}
+
+/**
+ * @brief Allocates the Morton buffers and converts the operands.
+ */
+static int setup_morton(bench_env *env) {
+    matrix_ctx *ctx = env->ctx;
+    morton_state *s = calloc(1, sizeof(*s));
+    if (!s) {
+        return -1;
+    }
+    env->state = s;
+    morton_layout_init(&s->l, ctx->n);
+    s->A = morton_alloc(&s->l);
+    s->B = morton_alloc(&s->l);
+    s->C = morton_alloc(&s->l);
+    if (!s->A || !s->B || !s->C) {
+        finish_morton(env);
+        return -1;
+    }
+    morton_from_rowmajor(&s->l, s->A, ctx->AF, ctx->ld);
+    morton_from_rowmajor(&s->l, s->B, ctx->XF, ctx->ld);
+    return 0;
+}
+
+static void run_morton_convert(bench_env *env) {
+    morton_state *s = env->state;
+    morton_from_rowmajor(&s->l, s->A, env->ctx->AF, env->ctx->ld);
+    morton_from_rowmajor(&s->l, s->B, env->ctx->XF, env->ctx->ld);
+}
+
+static void run_morton(bench_env *env) {
+    morton_state *s = env->state;
+    morton_mult(&s->l, s->C, s->A, s->B);
+}
+
+static void run_morton_convert_back(bench_env *env) {
+    morton_state *s = env->state;
+    morton_to_rowmajor(&s->l, env->ctx->YF, env->ctx->ld, s->C);
+}
+
+/** @brief Also computes C once, so that the conversion back copies a real product. */
+static int setup_morton_back(bench_env *env) {
+    if (setup_morton(env) != 0) {
+        return -1;
+    }
+    run_morton(env);
+    return 0;
+}
+
+/* ----------------------------------------------------------------
+   Strassen-Winograd
+   ---------------------------------------------------------------- */
+
+typedef struct {
+    strassen_plan plan;
+    strassen_arena arena;
+} strassen_state;
+
+static int setup_strassen(bench_env *env) {
+    strassen_state *s = malloc(sizeof(*s));
+    if (!s) {
+        return -1;
+    }
+    strassen_plan_init(&s->plan, env->ctx->n, env->crossover);
+    if (strassen_arena_init(&s->arena, s->plan.arena) != 0) {
+        free(s);
+        return -1;
+    }
+    fprintf(env->notes, "MATRIX_MULT_STRASSEN_PLAN\tcrossover=%d\tlevels=%d\tpadded=%d\tarena=%zuKB\n",
+            env->crossover, s->plan.levels, s->plan.padded, s->plan.arena * sizeof(TYPE) >> 10);
+    env->state = s;
+    return 0;
+}
+
+static void run_strassen(bench_env *env) {
+    strassen_state *s = env->state;
+    matrix_ctx *ctx = env->ctx;
+    strassen_mult(&s->plan, &s->arena, env->crossover, ctx->bl, ctx->bl_order,
+                  ctx->AF, ctx->ld, ctx->XF, ctx->ld, ctx->YF, ctx->ld);
+}
+
+static void finish_strassen(bench_env *env) {
+    strassen_state *s = env->state;
+    check_error(env, "MATRIX_MULT_STRASSEN");
+    strassen_arena_free(&s->arena);
+    free(s);
+}
+
+/* ----------------------------------------------------------------
+   Registry
+   ---------------------------------------------------------------- */
+
+const kernel_desc kernel_table[] = {
+    /* name                  row                       simd               ord norm flops bytes setup               run                      finish */
+    { "zero_vector",         "ZERO_VECTOR",            KERNEL_PLAIN,      2, 1, 0, 1, NULL,               run_zero_vector,         NULL },
+    { "zero_vector_simd",    "ZERO_VECTOR",            KERNEL_SIMD,       2, 1, 0, 1, NULL,               run_zero_vector_simd,    NULL },
+    { "copy_ij",             "COPY_MATRIX_IJ",         KERNEL_PLAIN,      2, 1, 0, 2, NULL,               run_copy_matrix_ij,      NULL },
+    { "copy_ij_simd",        "COPY_MATRIX_IJ",         KERNEL_SIMD,       2, 1, 0, 2, NULL,               run_copy_matrix_ij_simd, NULL },
+    { "copy_ji",             "COPY_MATRIX_JI",         KERNEL_PLAIN,      2, 1, 0, 2, NULL,               run_copy_matrix_ji,      NULL },
+    { "add_ij",              "ADD_MATRIX_IJ",          KERNEL_PLAIN,      2, 1, 1, 3, NULL,               run_add_matrix_ij,       NULL },
+    { "add_ij_simd",         "ADD_MATRIX_IJ",          KERNEL_SIMD_TYPED, 2, 1, 1, 3, NULL,               run_add_matrix_ij_simd,  NULL },
+    { "add_ji",              "ADD_MATRIX_JI",          KERNEL_PLAIN,      2, 1, 1, 3, NULL,               run_add_matrix_ji,       NULL },
+    { "dot",                 "SCALAR_PRODUCT",         KERNEL_PLAIN,      2, 1, 2, 2, NULL,               run_scalar_product,      NULL },
+    { "dot_opt",             "SCALAR_PRODUCT_OPT",     KERNEL_PLAIN,      2, 1, 2, 2, NULL,               run_scalar_product_opt,  NULL },
+    { "dot_simd",            "SCALAR_PRODUCT",         KERNEL_SIMD_TYPED, 2, 1, 2, 2, NULL,               run_scalar_product_simd, NULL },
+    { "mm_ijk",              "MATRIX_MULT_IJK",        KERNEL_PLAIN,      3, 1, 2, 3, NULL,               run_matrix_mult_ijk,     NULL },
+    { "mm_ikj",              "MATRIX_MULT_IKJ",        KERNEL_PLAIN,      3, 1, 2, 3, NULL,               run_matrix_mult_ikj,     NULL },
+    { "mm_blocked",          "MATRIX_MULT_BLOCKED",    KERNEL_PLAIN,      3, 1, 2, 3, NULL,               run_matrix_mult_blocked, NULL },
+    { "mm_tiled",            "MATRIX_MULT_TILED",      KERNEL_PLAIN,      3, 1, 2, 3, setup_tiled,        run_tiled,               finish_free },
+    { "mm_packed",           "MATRIX_MULT_PACKED",     KERNEL_PLAIN,      3, 1, 2, 3, setup_packed,       run_packed,              finish_packed },
+    { "morton_convert",      "MORTON_CONVERT",         KERNEL_PLAIN,      2, 2, 0, 4, setup_morton,       run_morton_convert,      finish_morton },
+    { "mm_morton",           "MATRIX_MULT_MORTON",     KERNEL_PLAIN,      3, 1, 2, 3, setup_morton,       run_morton,              finish_morton },
+    { "morton_convert_back", "MORTON_CONVERT_BACK",    KERNEL_PLAIN,      2, 1, 0, 2, setup_morton_back,  run_morton_convert_back, finish_morton },
+    { "mm_strassen",         "MATRIX_MULT_STRASSEN",   KERNEL_PLAIN,      3, 1, 2, 3, setup_strassen,     run_strassen,            finish_strassen },
+    { "transpose_naive",     "TRANSPOSE_NAIVE",        KERNEL_PLAIN,      2, 1, 0, 2, NULL,               run_transpose_naive,     NULL },
+    { "transpose",           "TRANSPOSE_BLOCKED",      KERNEL_SIMD_TYPED, 2, 1, 0, 2, NULL,               run_transpose,           NULL },
+    { "transpose_inplace",   "TRANSPOSE_INPLACE",      KERNEL_SIMD_TYPED, 2, 1, 0, 2, NULL,               run_transpose_inplace,   NULL },
+    /* The transpose done by mm_trans_ijk, normalized by n^3 so that both rows add up. */
+    { "mm_trans_ijk_transpose", "MM_TRANS_ijk_TRANSPOSE", KERNEL_PLAIN,  3, 1, 0, 2, NULL,               run_transpose,           NULL },
+    { "mm_trans_ijk",        "MM_TRANS_ijk",           KERNEL_PLAIN,      3, 1, 2, 3, setup_trans_ijk,    run_matrix_mult_trans_ijk, NULL },
+};
+
+const int kernel_count = (int)(sizeof(kernel_table) / sizeof(kernel_table[0]));
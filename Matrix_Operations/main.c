@@ -1,30 +1,317 @@
 /**
  * @file main.c
  * @brief Entry point for matrix operation performance evaluation.
+ * @details Usage: './matrix.elf [options] [n ...]' (see usage()).
+ * Every size n given on the command line (or with --n) is evaluated in turn by the same
+ * process, reusing buffers allocated once for the largest n. Without sizes, N is used.
+ * Each registered kernel selected with --kernel (glob patterns, all by default) gets
+ * --warmup untimed runs and --reps timed runs; the report is written as text, CSV or JSON.
+ * With --ci, --reps is only the minimum: sampling goes on until the bootstrap interval of the
+ * median is narrow enough or the --budget of the kernel is spent.
+ * The SIMD variant (scalar, sse2, avx2, avx512) defaults to the best one reported by CPUID.
+ * With -t, the parallel multiplications are also run on 1..threads pinned threads and a
+ * strong-scaling table is printed (do not restrict the process to a single core with taskset then).
+ * With -a, the block size and loop order of matrix_mult_blocked() are autotuned for every n
+ * and saved to this host's tuning file, which later runs load at startup (see autotune.h).
+ * -x sets the size below which Strassen-Winograd falls back to the blocked multiplication.
+ * With -Q, the process pins itself, locks and prefaults its memory, warns about frequency scaling
+ * and SMT, and flags every kernel whose timed runs were hit by context switches or interrupts.
+ * With -C, hardware counters (perf_event_open) are read around every timed run and each
+ * kernel's report row adds its IPC and cache, TLB and branch misses per element.
  */
 
 #include "matrix_ops.h"
+#include "simd_kernels.h"
+#include "matrix_parallel.h"
+#include "autotune.h"
+#include "bench.h"
+#include "strassen.h"
+#include "tsc.h"
+#include "trace.h"
+#include "perf_counters.h"
+#include <errno.h>
+#include <getopt.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Prints the command line usage.
+ * @param prog Program name.
+ */
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options] [n ...]\n"
+            "  -k, --kernel=PATTERNS  comma-separated globs of kernels to run (default: all)\n"
+            "  -n, --n=SIZES          comma-separated sizes (added to the positional ones)\n"
+            "  -m, --reps=R           timed repetitions per kernel, the minimum with --ci (default %d)\n"
+            "  -c, --ci=REL           sample until the median's 95%% interval is narrower than REL * median\n"
+            "  -b, --budget=SECONDS   time limit per kernel of --ci sampling (default 1)\n"
+            "  -F, --filter=FILTER    outlier filter: mad, iqr or none (default mad)\n"
+            "  -w, --warmup=W         untimed runs before timing (default 1)\n"
+            "  -f, --format=FMT       text, csv or json (default text)\n"
+            "  -o, --output=FILE      write the report to FILE instead of stdout\n"
+            "  -L, --list             list the registered kernels\n"
+            "  -T, --trace=FILE       record kernel phases and write a Chrome trace_event JSON at exit\n"
+            "  -C, --counters         report IPC and misses per element from the hardware counters\n"
+            "  -Q, --quiet-run[=CPU]  pin to CPU (default: the current one), mlockall, prefault, flag noisy kernels\n"
+            "  -R, --fifo=PRIO        with -Q, run with SCHED_FIFO priority PRIO\n"
+            "  -l LD                  leading dimension\n"
+            "  -s VARIANT             SIMD variant: scalar, sse2, avx2, avx512\n"
+            "  -t THREADS             strong-scaling table up to THREADS threads\n"
+            "  -a                     autotune the blocked multiplication\n"
+            "  -x CROSSOVER           Strassen-Winograd crossover size\n",
+            prog, M);
+}
+
+/**
+ * @brief Appends the sizes of a comma-separated list.
+ * @return 0 on success, -1 on an invalid size or allocation failure.
+ */
+static int parse_sizes(const char *list, int **sizes, int *nsizes) {
+    while (*list) {
+        char *end;
+        long v = strtol(list, &end, 10);
+        if (end == list || v <= 0 || (*end && *end != ',')) {
+            return -1;
+        }
+        int *grown = realloc(*sizes, (size_t)(*nsizes + 1) * sizeof(int));
+        if (!grown) {
+            return -1;
+        }
+        *sizes = grown;
+        (*sizes)[(*nsizes)++] = (int)v;
+        list = *end ? end + 1 : end;
+    }
+    return 0;
+}
 
 /**
  * @brief Main function to execute matrix operations.
  * @return int Exit status.
  */
-int main() {
-    printf("Evaluation: N=%d, type=%s, BL=%d\n", N, STR(TYPE), BL);
-
-    // Execute matrix operations
-    zero_vector();
-    copy_matrix_ij();
-    copy_matrix_ji();
-    add_matrix_ij();
-    add_matrix_ji();
-    scalar_product();
-    scalar_product_opt();
-    matrix_mult_ijk();
-    matrix_mult_ikj();
-    matrix_mult_blocked();
-    matrix_mult_trans_ijk();
-    
-    return 0;
+int main(int argc, char *argv[]) {
+    int reps = M, ld = 0, threads = 0, tune = 0, crossover = STRASSEN_CROSSOVER, warmup = 1, opt;
+    int format = REPORT_TEXT, nsizes = 0, counters = 0, quiet = 0, quiet_cpu = -1, fifo = 0;
+    int *sizes = NULL, status = 1;
+    bench_sampling sampling = { 0.0, 1.0, FILTER_MAD };
+    const char *variant = NULL, *patterns = NULL, *output = NULL, *trace_path = NULL;
+    static const struct option long_options[] = {
+        { "kernel", required_argument, NULL, 'k' },
+        { "n", required_argument, NULL, 'n' },
+        { "reps", required_argument, NULL, 'm' },
+        { "ci", required_argument, NULL, 'c' },
+        { "budget", required_argument, NULL, 'b' },
+        { "filter", required_argument, NULL, 'F' },
+        { "warmup", required_argument, NULL, 'w' },
+        { "format", required_argument, NULL, 'f' },
+        { "output", required_argument, NULL, 'o' },
+        { "list", no_argument, NULL, 'L' },
+        { "trace", required_argument, NULL, 'T' },
+        { "counters", no_argument, NULL, 'C' },
+        { "quiet-run", optional_argument, NULL, 'Q' },
+        { "fifo", required_argument, NULL, 'R' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    matrix_ctx ctx = { 0 };
+    bench_report report = { 0 };
+    perf_group pg, *group = NULL;
+
+    while ((opt = getopt_long(argc, argv, "k:n:m:c:b:F:w:f:o:LT:CQ::R:l:s:t:ax:h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'k': patterns = optarg; break;
+        case 'n':
+            if (parse_sizes(optarg, &sizes, &nsizes) != 0) {
+                fprintf(stderr, "Invalid size list '%s'\n", optarg);
+                goto done;
+            }
+            break;
+        case 'm': reps = atoi(optarg); break;
+        case 'c': sampling.ci = atof(optarg); break;
+        case 'b': sampling.budget = atof(optarg); break;
+        case 'F':
+            if ((sampling.filter = stats_parse_filter(optarg)) < 0) {
+                fprintf(stderr, "Unknown filter '%s'\n", optarg);
+                goto done;
+            }
+            break;
+        case 'w': warmup = atoi(optarg); break;
+        case 'f':
+            if ((format = report_parse_format(optarg)) < 0) {
+                fprintf(stderr, "Unknown format '%s'\n", optarg);
+                goto done;
+            }
+            break;
+        case 'o': output = optarg; break;
+        case 'T': trace_path = optarg; break;
+        case 'C': counters = 1; break;
+        case 'Q':
+            quiet = 1;
+            if (optarg) quiet_cpu = atoi(optarg);
+            break;
+        case 'R': fifo = atoi(optarg); break;
+        case 'L':
+            for (int k = 0; k < kernel_count; k++) {
+                printf("%s\t%s\n", kernel_table[k].name, kernel_table[k].row);
+            }
+            status = 0;
+            goto done;
+        case 'l': ld = atoi(optarg); break;
+        case 's': variant = optarg; break;
+        case 't': threads = atoi(optarg); break;
+        case 'a': tune = 1; break;
+        case 'x': crossover = atoi(optarg); break;
+        default:
+            usage(argv[0]);
+            status = opt == 'h' ? 0 : 1;
+            goto done;
+        }
+    }
+
+    for (int a = optind; a < argc; a++) {
+        if (parse_sizes(argv[a], &sizes, &nsizes) != 0) {
+            fprintf(stderr, "Invalid size '%s'\n", argv[a]);
+            goto done;
+        }
+    }
+    if (nsizes == 0 && parse_sizes(STR(N), &sizes, &nsizes) != 0) {
+        fprintf(stderr, "Invalid default size '%s'\n", STR(N));
+        goto done;
+    }
+    if (!sizes) {
+        fprintf(stderr, "Cannot allocate the size list\n");
+        goto done;
+    }
+    if (reps <= 0 || warmup < 0) {
+        fprintf(stderr, "Invalid repetitions %d / warm-up %d\n", reps, warmup);
+        goto done;
+    }
+    if (sampling.ci < 0.0 || sampling.budget < 0.0) {
+        fprintf(stderr, "Invalid CI width %g / budget %g\n", sampling.ci, sampling.budget);
+        goto done;
+    }
+    int max_n = 0;
+    for (int s = 0; s < nsizes; s++) {
+        if (ld != 0 && ld < sizes[s]) {
+            fprintf(stderr, "Invalid size %d (leading dimension %d)\n", sizes[s], ld);
+            goto done;
+        }
+        if (sizes[s] > max_n) max_n = sizes[s];
+    }
+    int selected = 0;
+    for (int k = 0; k < kernel_count; k++) {
+        selected += kernel_match(kernel_table[k].name, patterns);
+    }
+    if (selected == 0) {
+        fprintf(stderr, "No kernel matches '%s' (see --list)\n", patterns);
+        goto done;
+    }
+
+    if (simd_select(variant) != 0) {
+        fprintf(stderr, "SIMD variant '%s' is unknown or not supported by this CPU\n", variant);
+        goto done;
+    }
+
+    quiet_state qs;
+    if (quiet) {
+        if (threads > 0) {
+            fprintf(stderr, "Warning: -t needs several CPUs; the quiet run does not pin the process\n");
+        }
+        quiet_setup(&qs, threads == 0, quiet_cpu, fifo, stderr);
+    }
+
+    calibrate_tsc();
+    if (!tsc_cal.invariant) {
+        fprintf(stderr, "Warning: no invariant TSC; cycle counts depend on the P/C-state\n");
+    }
+
+    if (trace_path && trace_init(trace_path, threads + 1) != 0) {
+        fprintf(stderr, "Cannot allocate trace buffers\n");
+        goto done;
+    }
+
+    if (counters && perf_group_open(&pg) == 0) {
+        fprintf(stderr, "Warning: no hardware counters (perf_event_open: %s; see /proc/sys/kernel/perf_event_paranoid)\n",
+                strerror(errno));
+    } else if (counters) {
+        group = &pg;
+        if (!pg.grouped) {
+            fprintf(stderr, "Warning: the counters do not fit in one group; they are multiplexed and scaled\n");
+        }
+    }
+
+    char tuning_path[512];
+    cpu_caches caches;
+    tuning_default_path(tuning_path, sizeof(tuning_path));
+    tuning_load(tuning_path);
+    cpu_detect_caches(&caches);
+
+    if (matrix_ctx_init(&ctx, max_n, ld, reps) != 0) {
+        fprintf(stderr, "Cannot allocate matrices for N=%d\n", max_n);
+        goto done;
+    }
+
+    if (quiet) {
+        quiet_prefault(&ctx);
+    }
+
+    if (report_open(&report, output, format) != 0) {
+        fprintf(stderr, "Cannot create %s\n", output);
+        goto done;
+    }
+    bench_env env = { &ctx, &caches, crossover, format == REPORT_TEXT ? report.out : stderr,
+                      group, &sampling, quiet ? &qs : NULL, NULL };
+
+    for (int s = 0; s < nsizes; s++) {
+        if (matrix_ctx_resize(&ctx, sizes[s], ld) != 0) {
+            fprintf(stderr, "Cannot allocate matrices for N=%d\n", sizes[s]);
+            goto done;
+        }
+        matrix_ctx_fill(&ctx, 1);
+
+        tune_entry te;
+        if (tune) {
+            autotune_blocked(&ctx, &caches, &te, env.notes);
+            tuning_store(&te);
+        }
+        if (tuning_lookup(ctx.n, &te) == 0) {
+            ctx.bl = te.bl;
+            ctx.bl_order = te.order;
+        } else {
+            ctx.bl = BL;
+            ctx.bl_order = BLOCKED_IJK;
+        }
+        report_size(&report, &env);
+
+        for (int k = 0; k < kernel_count; k++) {
+            if (kernel_match(kernel_table[k].name, patterns)) {
+                bench_kernel(&env, &kernel_table[k], warmup, &report);
+            }
+        }
+
+        if (threads > 0 && parallel_scaling(&ctx, threads, env.notes) != 0) {
+            goto done;
+        }
+    }
+    if (tune) {
+        if (tuning_save(tuning_path) == 0) {
+            fprintf(env.notes, "Tuning saved to %s\n", tuning_path);
+        } else {
+            fprintf(stderr, "Cannot write tuning file %s\n", tuning_path);
+        }
+    }
+
+    status = 0;
+
+done:
+    if (report.out) {
+        report_close(&report);
+    }
+    if (group) {
+        perf_group_close(group);
+    }
+    matrix_ctx_free(&ctx);
+    free(sizes);
+    return status;
 }
@@ -4,15 +4,13 @@
  */
 
 #include "matrix_ops.h"
-#include "tsc.h"
+#include "simd_kernels.h"
+#include "transpose.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
 
-TYPE AF[N][N], YF[N][N], XF[N][N], YT[N][N]; /**< Matrices of size [N][N] */
-TYPE BF[N * N], CF[N * N];                  /**< Vectors of size N^2 */
 TYPE SF;                                     /**< Scalar accumulator */
-double results[M];                           /**< Array to store benchmark results in number of cycles*/
-
-unsigned long long start_time;
-double benchmark_time;
 
 /**
  * @brief Computes the minimum of two integers.
@@ -26,27 +24,161 @@ static inline int min(int a, int b) {
 }
 
 /**
- * @brief Stores a result in the results array.
- * 
- * @param res The result to store.
- * @param index The index where the result should be stored.
+ * @brief Allocates a zeroed, MATRIX_ALIGN-aligned buffer of TYPE elements.
+ *
+ * Zeroing also touches every page, so the first timed iteration does not pay the page faults.
+ *
+ * @param count Number of elements.
+ * @return The buffer, or NULL on failure.
+ */
+static TYPE *alloc_aligned(size_t count) {
+    size_t bytes = (count * sizeof(TYPE) + MATRIX_ALIGN - 1) & ~(size_t)(MATRIX_ALIGN - 1);
+    void *p = NULL;
+    if (bytes == 0 || posix_memalign(&p, MATRIX_ALIGN, bytes) != 0) {
+        return NULL;
+    }
+    memset(p, 0, bytes);
+    return (TYPE *)p;
+}
+
+/**
+ * @brief Next value of a small LCG: uniform in [-1, 1] for floating types, in [-3, 3] otherwise.
  */
-void add_result(double res, int index) {
-    results[index] = res;
+static inline TYPE random_element(unsigned int *state) {
+    *state = *state * 1103515245u + 12345u;
+    int v = (int)((*state >> 16) % 2001u) - 1000;
+    return IS_FLOATING_TYPE ? (TYPE)(v / 1000.0) : (TYPE)(v % 4);
+}
+
+int matrix_default_ld(int n) {
+    int per_line = MATRIX_ALIGN / (int)sizeof(TYPE);
+    if (per_line < 1) {
+        per_line = 1;
+    }
+    return (n + per_line - 1) / per_line * per_line;
 }
 
 /**
- * @brief Prints the benchmark results.
- * 
- * @param func_name Name of the function.
- * @param iterations Number of iterations for normalization.
+ * @brief Frees the matrix and vector buffers of the context.
  */
-void print_results(const char *func_name, double iterations) {
-    double normalize = 1.0 / iterations;
-    printf("%s\t", func_name);
-    for (int i = 0; i < M; i++) {
-        printf("%.3f%s", results[i] * normalize, (i == M - 1 ? "\n" : "\t"));
+static void free_buffers(matrix_ctx *ctx) {
+    free(ctx->AF);
+    free(ctx->YF);
+    free(ctx->XF);
+    free(ctx->YT);
+    free(ctx->BF);
+    free(ctx->CF);
+    ctx->AF = ctx->YF = ctx->XF = ctx->YT = ctx->BF = ctx->CF = NULL;
+    ctx->cap = ctx->vcap = 0;
+}
+
+/**
+ * @brief (Re)allocates the matrix and vector buffers for the given element counts.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int alloc_buffers(matrix_ctx *ctx, size_t cap, size_t vcap) {
+    free_buffers(ctx);
+    ctx->AF = alloc_aligned(cap);
+    ctx->YF = alloc_aligned(cap);
+    ctx->XF = alloc_aligned(cap);
+    ctx->YT = alloc_aligned(cap);
+    ctx->BF = alloc_aligned(vcap);
+    ctx->CF = alloc_aligned(vcap);
+    if (!ctx->AF || !ctx->YF || !ctx->XF || !ctx->YT || !ctx->BF || !ctx->CF) {
+        free_buffers(ctx);
+        return -1;
+    }
+    ctx->cap = cap;
+    ctx->vcap = vcap;
+    return 0;
+}
+
+int matrix_ctx_init(matrix_ctx *ctx, int n, int ld, int m) {
+    memset(ctx, 0, sizeof(*ctx));
+    if (m <= 0) {
+        return -1;
+    }
+    ctx->results = malloc((size_t)m * sizeof(double));
+    if (!ctx->results) {
+        return -1;
+    }
+    ctx->m = m;
+    ctx->rcap = m;
+    ctx->bl = BL;
+    ctx->bl_order = BLOCKED_IJK;
+    if (matrix_ctx_resize(ctx, n, ld) != 0) {
+        matrix_ctx_free(ctx);
+        return -1;
+    }
+    return 0;
+}
+
+int matrix_ctx_resize(matrix_ctx *ctx, int n, int ld) {
+    if (ld == 0) {
+        ld = matrix_default_ld(n);
+    }
+    if (n <= 0 || ld < n) {
+        return -1;
+    }
+    size_t cap = (size_t)n * (size_t)ld;
+    size_t vcap = (size_t)n * (size_t)n;
+    if (cap > ctx->cap || vcap > ctx->vcap) {
+        if (alloc_buffers(ctx, cap, vcap) != 0) {
+            return -1;
+        }
     }
+    ctx->n = n;
+    ctx->ld = ld;
+    return 0;
+}
+
+int matrix_ctx_reserve_results(matrix_ctx *ctx, int count) {
+    if (count <= ctx->rcap) {
+        return 0;
+    }
+    double *grown = realloc(ctx->results, (size_t)count * sizeof(double));
+    if (!grown) {
+        return -1;
+    }
+    ctx->results = grown;
+    ctx->rcap = count;
+    return 0;
+}
+
+void matrix_ctx_fill(matrix_ctx *ctx, unsigned int seed) {
+    const int n = ctx->n;
+    const size_t ld = ctx->ld;
+    const size_t nn = (size_t)n * n;
+    unsigned int r = seed;
+
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            ctx->AF[i * ld + j] = random_element(&r);
+            ctx->XF[i * ld + j] = random_element(&r);
+        }
+    }
+    for (size_t i = 0; i < nn; i++) {
+        ctx->BF[i] = random_element(&r);
+        ctx->CF[i] = random_element(&r);
+    }
+}
+
+void matrix_ctx_free(matrix_ctx *ctx) {
+    free_buffers(ctx);
+    free(ctx->results);
+    ctx->results = NULL;
+    ctx->rcap = 0;
+}
+
+/**
+ * @brief Stores a result in the results array.
+ * 
+ * @param ctx Benchmark context.
+ * @param res The result to store.
+ * @param index The index where the result should be stored.
+ */
+void add_result(matrix_ctx *ctx, double res, int index) {
+    ctx->results[index] = res;
 }
 
 /**
@@ -59,262 +191,330 @@ void separator() {
 /**
  * @brief Sets all elements of vector BF to zero.
  */
-void zero_vector() {
-    for (int m = 0; m < M; m++) {
-        start_time = start_timer();
-        for (int i = 0; i < (N * N); i++) {
-            BF[i] = ZERO;
-        }
-        benchmark_time = dtime(start_time, stop_timer());
-        add_result(benchmark_time, m);
+void zero_vector(matrix_ctx *ctx) {
+    const size_t nn = (size_t)ctx->n * ctx->n;
+    TYPE *BF = ctx->BF;
+    for (size_t i = 0; i < nn; i++) {
+        BF[i] = ZERO;
     }
-    print_results("ZERO_VECTOR", (N * N));
-    separator();
 }
 
 /**
  * @brief Copies matrix YF to AF in row-major order.
  */
-void copy_matrix_ij() {
-    for (int m = 0; m < M; m++) {
-        start_time = start_timer();
-        for (int i = 0; i < N; i++) {
-            for (int j = 0; j < N; j++) {
-                AF[i][j] = YF[i][j];
-            }
+void copy_matrix_ij(matrix_ctx *ctx) {
+    const int n = ctx->n;
+    const size_t ld = ctx->ld;
+    TYPE *AF = ctx->AF, *YF = ctx->YF;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            AF[i * ld + j] = YF[i * ld + j];
         }
-        benchmark_time = dtime(start_time, stop_timer());
-        add_result(benchmark_time, m);
     }
-    print_results("COPY_MATRIX_IJ", (N * N));
-    separator();
 }
 
 /**
  * @brief Copies matrix YF to AF in column-major order.
  */
-void copy_matrix_ji() {
-    for (int m = 0; m < M; m++) {
-        start_time = start_timer();
-        for (int j = 0; j < N; j++) {
-            for (int i = 0; i < N; i++) {
-                AF[i][j] = YF[i][j];
-            }
+void copy_matrix_ji(matrix_ctx *ctx) {
+    const int n = ctx->n;
+    const size_t ld = ctx->ld;
+    TYPE *AF = ctx->AF, *YF = ctx->YF;
+    for (int j = 0; j < n; j++) {
+        for (int i = 0; i < n; i++) {
+            AF[i * ld + j] = YF[i * ld + j];
         }
-        benchmark_time = dtime(start_time, stop_timer());
-        add_result(benchmark_time, m);
     }
-    print_results("COPY_MATRIX_JI", (N * N));
-    separator();
 }
 
 /**
  * @brief Adds matrix YF to AF in row-major order.
  */
-void add_matrix_ij() {
-    for (int m = 0; m < M; m++) {
-        start_time = start_timer();
-        for (int i = 0; i < N; i++) {
-            for (int j = 0; j < N; j++) {
-                AF[i][j] += YF[i][j];
-            }
+void add_matrix_ij(matrix_ctx *ctx) {
+    const int n = ctx->n;
+    const size_t ld = ctx->ld;
+    TYPE *AF = ctx->AF, *YF = ctx->YF;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            AF[i * ld + j] += YF[i * ld + j];
         }
-        benchmark_time = dtime(start_time, stop_timer());
-        add_result(benchmark_time, m);
     }
-    print_results("ADD_MATRIX_IJ", (N * N));
-    separator();
 }
 
 /**
  * @brief Adds matrix YF to AF in column-major order.
  */
-void add_matrix_ji() {
-    for (int m = 0; m < M; m++) {
-        start_time = start_timer();
-        for (int j = 0; j < N; j++) {
-            for (int i = 0; i < N; i++) {
-                AF[i][j] += YF[i][j];
-            }
+void add_matrix_ji(matrix_ctx *ctx) {
+    const int n = ctx->n;
+    const size_t ld = ctx->ld;
+    TYPE *AF = ctx->AF, *YF = ctx->YF;
+    for (int j = 0; j < n; j++) {
+        for (int i = 0; i < n; i++) {
+            AF[i * ld + j] += YF[i * ld + j];
         }
-        benchmark_time = dtime(start_time, stop_timer());
-        add_result(benchmark_time, m);
     }
-    print_results("ADD_MATRIX_JI", (N * N));
-    separator();
 }
 
 /**
  * @brief Computes the scalar product of vectors BF and CF.
  */
-void scalar_product() {
-    for (int m = 0; m < M; m++) {
-        start_time = start_timer();
-        SF = ZERO;
-        for (int i = 0; i < (N * N); i++) {
-            SF += BF[i] * CF[i];
-        }
-        benchmark_time = dtime(start_time, stop_timer());
-        add_result(benchmark_time, m);
+void scalar_product(matrix_ctx *ctx) {
+    const size_t nn = (size_t)ctx->n * ctx->n;
+    const TYPE *BF = ctx->BF, *CF = ctx->CF;
+    SF = ZERO;
+    for (size_t i = 0; i < nn; i++) {
+        SF += BF[i] * CF[i];
     }
-    print_results("SCALAR_PRODUCT", (N * N));
-    separator();
 }
 
 /**
  * @brief Computes the optimized scalar product of vectors BF and CF.
  */
-void scalar_product_opt()
+void scalar_product_opt(matrix_ctx *ctx)
 {
-    int i, m;
+    size_t i;
+    const size_t nn = (size_t)ctx->n * ctx->n;
+    const TYPE *BF = ctx->BF, *CF = ctx->CF;
     TYPE elem0, elem1, elem2, elem3;
 
-    for (m = 0; m < M; m++) 
+    SF = ZERO;
+    elem0 = elem1 = elem2 = elem3 = ZERO;
+    for (i = 0; i < nn / 3; i += 4)
     {
-        start_time = start_timer();
-        SF = ZERO;
-        elem0 = elem1 = elem2 = elem3 = ZERO;
-        for (i = 0; i < (int)((N * N) / 3); i += 4)
-        {
-            elem0 = BF[i] * CF[i];
-            elem1 = BF[i + 1] * CF[i + 1];
-            elem2 = BF[i + 2] * CF[i + 2];
-            elem3 = BF[i + 3] * CF[i + 3];
-
-            SF += elem0 + elem1 + elem2 + elem3;
-        }
-        for (i = (int)((N * N) / 3); i < (int)(2*(N * N) / 3); i += 4)
-        {
-            elem0 = BF[i] * CF[i];
-            elem1 = BF[i + 1] * CF[i + 1];
-            elem2 = BF[i + 2] * CF[i + 2];
-            elem3 = BF[i + 3] * CF[i + 3];
-
-            SF += elem0 + elem1 + elem2 + elem3;
-        }
-        for (i = (int)(2*(N * N) / 3); i < (int)(N * N) - 4; i += 4)
-        {
-            elem0 = BF[i] * CF[i];
-            elem1 = BF[i + 1] * CF[i + 1];
-            elem2 = BF[i + 2] * CF[i + 2];
-            elem3 = BF[i + 3] * CF[i + 3];
-
-            SF += elem0 + elem1 + elem2 + elem3;
-        }
+        elem0 = BF[i] * CF[i];
+        elem1 = BF[i + 1] * CF[i + 1];
+        elem2 = BF[i + 2] * CF[i + 2];
+        elem3 = BF[i + 3] * CF[i + 3];
 
-        benchmark_time = dtime(start_time, stop_timer());
-        add_result(benchmark_time, m);
+        SF += elem0 + elem1 + elem2 + elem3;
+    }
+    for (i = nn / 3; i < 2 * nn / 3; i += 4)
+    {
+        elem0 = BF[i] * CF[i];
+        elem1 = BF[i + 1] * CF[i + 1];
+        elem2 = BF[i + 2] * CF[i + 2];
+        elem3 = BF[i + 3] * CF[i + 3];
+
+        SF += elem0 + elem1 + elem2 + elem3;
+    }
+    for (i = 2 * nn / 3; i + 4 < nn; i += 4)
+    {
+        elem0 = BF[i] * CF[i];
+        elem1 = BF[i + 1] * CF[i + 1];
+        elem2 = BF[i + 2] * CF[i + 2];
+        elem3 = BF[i + 3] * CF[i + 3];
+
+        SF += elem0 + elem1 + elem2 + elem3;
     }
-    print_results("SCALAR_PRODUCT_OPT", (double)(N * N));
-    separator();
 }
 
 /**
  * @brief Performs matrix multiplication AF * XF = YF in ijk order.
  */
-void matrix_mult_ijk() {
-    for (int m = 0; m < M; m++) {
-        start_time = start_timer();
-        for (int i = 0; i < N; i++) {
-            for (int j = 0; j < N; j++) {
-                SF = ZERO;
-                for (int k = 0; k < N; k++) {
-                    SF += AF[i][k] * XF[k][j];
-                }
-                YF[i][j] = SF;
+void matrix_mult_ijk(matrix_ctx *ctx) {
+    const int n = ctx->n;
+    const size_t ld = ctx->ld;
+    const TYPE *AF = ctx->AF, *XF = ctx->XF;
+    TYPE *YF = ctx->YF;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            SF = ZERO;
+            for (int k = 0; k < n; k++) {
+                SF += AF[i * ld + k] * XF[k * ld + j];
             }
+            YF[i * ld + j] = SF;
         }
-        benchmark_time = dtime(start_time, stop_timer());
-        add_result(benchmark_time, m);
     }
-    print_results("MATRIX_MULT_IJK", ((long long)N * N * N));
-    separator();
 }
 
 /**
  * @brief Performs matrix multiplication AF * XF = YF in ikj order.
  */
-void matrix_mult_ikj()
+void matrix_mult_ikj(matrix_ctx *ctx)
 {
-    int i, j, k, m;
-    for (m = 0; m < M; m++) {
-        start_time = start_timer();
-        for (i = 0; i < N; i++) {
-            for (k = 0; k < N; k++) {
-                SF = AF[i][k];
-                for (j = 0; j < N; j++) {
-                    YF[i][j] += SF * XF[k][j];
-                }
+    int i, j, k;
+    const int n = ctx->n;
+    const size_t ld = ctx->ld;
+    const TYPE *AF = ctx->AF, *XF = ctx->XF;
+    TYPE *YF = ctx->YF;
+    for (i = 0; i < n; i++) {
+        for (k = 0; k < n; k++) {
+            SF = AF[i * ld + k];
+            for (j = 0; j < n; j++) {
+                YF[i * ld + j] += SF * XF[k * ld + j];
             }
         }
-        benchmark_time = dtime(start_time, stop_timer());
-        add_result(benchmark_time, m);
     }
-    print_results("MATRIX_MULT_IKJ", ((long long)N * N * N));
-    separator();
 }
 
-/**
- * @brief Performs blocked matrix multiplication for optimized cache usage.
- */
-void matrix_mult_blocked() {
-    for (int m = 0; m < M; m++) {
-        start_time = start_timer();
-        for (int jj = 0; jj < N; jj += BL) {
-            for (int kk = 0; kk < N; kk += BL) {
-                for (int i = 0; i < N; i++) {
-                    for (int j = jj; j < min(jj + BL, N); j++) {
-                        SF = ZERO;
-                        for (int k = kk; k < min(kk + BL, N); k++) {
-                            SF += AF[i][k] * XF[k][j];
+const char *blocked_order_name(int order) {
+    return order == BLOCKED_IKJ ? "ikj" : "ijk";
+}
+
+void blocked_mult(int n, const TYPE *AF, size_t lda, const TYPE *XF, size_t ldx,
+                  TYPE *YF, size_t ldy, int bl, int order) {
+    if (order == BLOCKED_IKJ) {
+        for (int jj = 0; jj < n; jj += bl) {
+            int jend = min(jj + bl, n);
+            for (int kk = 0; kk < n; kk += bl) {
+                int kend = min(kk + bl, n);
+                trace_begin("blocked_tile");
+                for (int i = 0; i < n; i++) {
+                    TYPE *y = YF + i * ldy;
+                    if (kk == 0) {
+                        for (int j = jj; j < jend; j++) {
+                            y[j] = ZERO;
+                        }
+                    }
+                    for (int k = kk; k < kend; k++) {
+                        SF = AF[i * lda + k];
+                        for (int j = jj; j < jend; j++) {
+                            y[j] += SF * XF[k * ldx + j];
                         }
-                        YF[i][j] = SF;
                     }
                 }
+                trace_end("blocked_tile");
             }
         }
-        benchmark_time = dtime(start_time, stop_timer());
-        add_result(benchmark_time, m);
+        return;
     }
-    print_results("MATRIX_MULT_BLOCKED", ((long long)N * N * N));
-    separator();
+
+    for (int jj = 0; jj < n; jj += bl) {
+        for (int kk = 0; kk < n; kk += bl) {
+            trace_begin("blocked_tile");
+            for (int i = 0; i < n; i++) {
+                for (int j = jj; j < min(jj + bl, n); j++) {
+                    SF = (kk == 0) ? ZERO : YF[i * ldy + j];
+                    for (int k = kk; k < min(kk + bl, n); k++) {
+                        SF += AF[i * lda + k] * XF[k * ldx + j];
+                    }
+                    YF[i * ldy + j] = SF;
+                }
+            }
+            trace_end("blocked_tile");
+        }
+    }
+}
+
+void matrix_mult_blocked_run(matrix_ctx *ctx, int bl, int order) {
+    blocked_mult(ctx->n, ctx->AF, ctx->ld, ctx->XF, ctx->ld, ctx->YF, ctx->ld, bl, order);
+}
+
+/**
+ * @brief Performs blocked matrix multiplication for optimized cache usage.
+ *
+ * Block size and loop order come from the context (BL/ijk unless a tuning entry applies).
+ */
+void matrix_mult_blocked(matrix_ctx *ctx) {
+    matrix_mult_blocked_run(ctx, ctx->bl, ctx->bl_order);
 }
 
 /**
  * @brief Matrix multiplication using the transposed matrix (i-j-k order).
  *
  * This function multiplies matrix A with the transposed matrix of X (XT) to improve cache efficiency.
- * The result is stored in matrix Y.
+ * The result is stored in matrix Y. XT must already be in the context's heap scratch matrix YT.
  */
-void matrix_mult_trans_ijk() {
-    int i, j, k, m;
-    TYPE XT[N][N];  // Transposed matrix of X
-
-    // Transpose the matrix X to improve memory access
-    for (i = 0; i < N; i++) {
-        for (j = 0; j < N; j++) {
-            XT[j][i] = XF[i][j];
+void matrix_mult_trans_ijk(matrix_ctx *ctx) {
+    int i, j, k;
+    const int n = ctx->n;
+    const size_t ld = ctx->ld;
+    const TYPE *AF = ctx->AF;
+    TYPE *YF = ctx->YF;
+    const TYPE *XT = ctx->YT;  // Transposed matrix of X
+
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < n; j++) {
+            SF = ZERO;
+            for (k = 0; k < n; k++) {
+                SF += AF[i * ld + k] * XT[j * ld + k];  // Use the transposed matrix XT
+            }
+            YF[i * ld + j] = SF;
         }
     }
+}
 
-    // Perform the matrix multiplication M times to measure performance
-    for (m = 0; m < M; m++) {
-        start_time = start_timer();
-        
-        for (i = 0; i < N; i++) {
-            for (j = 0; j < N; j++) {
-                SF = ZERO;
-                for (k = 0; k < N; k++) {
-                    SF += AF[i][k] * XT[j][k];  // Use the transposed matrix XT
-                }
-                YF[i][j] = SF;
-            }
+void matrix_mult_trans_ijk_run(matrix_ctx *ctx) {
+    transpose(ctx->n, ctx->n, ctx->XF, ctx->ld, ctx->YT, ctx->ld);
+    matrix_mult_trans_ijk(ctx);
+}
+
+/* ----------------------------------------------------------------
+   SIMD variants (primitives selected at startup by simd_select())
+   ---------------------------------------------------------------- */
+
+/**
+ * @brief Scalar dot product for element types without a vector primitive.
+ */
+static inline TYPE dot_generic(const TYPE *x, const TYPE *y, size_t n) {
+    TYPE s = ZERO;
+    for (size_t i = 0; i < n; i++) {
+        s += x[i] * y[i];
+    }
+    return s;
+}
+
+/**
+ * @brief Scalar y += x for element types without a vector primitive.
+ */
+static inline void add_generic(TYPE *y, const TYPE *x, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        y[i] += x[i];
+    }
+}
+
+/** @brief Dot product primitive for TYPE. */
+#define SIMD_DOT _Generic((TYPE)0, float: simd.dot_f32, double: simd.dot_f64, default: dot_generic)
+/** @brief y += x primitive for TYPE. */
+#define SIMD_ADD _Generic((TYPE)0, float: simd.add_f32, double: simd.add_f64, default: add_generic)
+/** @brief Variant actually used by SIMD_DOT/SIMD_ADD for TYPE. */
+#define SIMD_TYPED_NAME _Generic((TYPE)0, float: simd.name, double: simd.name, default: "scalar")
+
+const char *matrix_simd_variant(void) {
+    return SIMD_TYPED_NAME;
+}
+
+/**
+ * @brief Sets all elements of vector BF to zero with the selected SIMD primitive.
+ */
+void zero_vector_simd(matrix_ctx *ctx) {
+    const size_t bytes = (size_t)ctx->n * ctx->n * sizeof(TYPE);
+    const int stream = bytes > SIMD_STREAM_BYTES;
+    simd.zero(ctx->BF, bytes, stream);
+}
+
+/**
+ * @brief Copies matrix YF to AF row by row with the selected SIMD primitive.
+ */
+void copy_matrix_ij_simd(matrix_ctx *ctx) {
+    const int n = ctx->n;
+    const size_t ld = ctx->ld;
+    const size_t row_bytes = (size_t)n * sizeof(TYPE);
+    const int stream = row_bytes * n > SIMD_STREAM_BYTES;
+    if (ld == (size_t)n) {
+        simd.copy(ctx->AF, ctx->YF, row_bytes * n, stream);
+    } else {
+        for (int i = 0; i < n; i++) {
+            simd.copy(ctx->AF + i * ld, ctx->YF + i * ld, row_bytes, stream);
         }
+    }
+}
 
-        benchmark_time = dtime(start_time, stop_timer());
-        add_result(benchmark_time, m);
+/**
+ * @brief Adds matrix YF to AF row by row with the selected SIMD primitive.
+ */
+void add_matrix_ij_simd(matrix_ctx *ctx) {
+    const int n = ctx->n;
+    const size_t ld = ctx->ld;
+    for (int i = 0; i < n; i++) {
+        SIMD_ADD(ctx->AF + i * ld, ctx->YF + i * ld, n);
     }
+}
 
-    print_results("MM_TRANS_ijk", ((double)N * N * N));
-    separator();
+/**
+ * @brief Computes the scalar product of vectors BF and CF with the selected SIMD primitive.
+ */
+void scalar_product_simd(matrix_ctx *ctx) {
+    const size_t nn = (size_t)ctx->n * ctx->n;
+    SF = SIMD_DOT(ctx->BF, ctx->CF, nn);
 }
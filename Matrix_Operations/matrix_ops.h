@@ -7,14 +7,15 @@
 #define MATRIX_OPS_H
 
 #include <stdio.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #ifndef N
-#define N 500 /**< Size of matrices [N][N] and vectors [N^2] */
+#define N 500 /**< Default size of matrices [N][N] and vectors [N^2] when none is given at runtime */
 #endif
 
 #ifndef M
-#define M 16 /**< Number of iterations for each function */
+#define M 16 /**< Default number of iterations for each function */
 #endif
 
 #ifndef TYPE
@@ -32,69 +33,261 @@
     #define ZERO 0.0
 #endif
 
+/**
+ * @brief 1 if TYPE is a floating-point type (usable in ordinary, not preprocessor, conditions).
+ */
+#define IS_FLOATING_TYPE _Generic((TYPE)0, float: 1, double: 1, long double: 1, default: 0)
+
 #ifndef BL
 #define BL 16 /**< Block size for blocked matrix multiplication */
 #endif
 
+#ifndef GEMM_MR
+#define GEMM_MR 6 /**< Rows of the YF register tile computed by the packed micro-kernel */
+#endif
+
+#ifndef GEMM_NR
+#define GEMM_NR (128 / (int)sizeof(TYPE)) /**< Widest YF register tile of the packed micro-kernels (two 64-byte vectors) */
+#endif
+
+#ifndef GEMM_MC
+#define GEMM_MC 96 /**< Rows of the packed AF panel (multiple of GEMM_MR, sized for L2) */
+#endif
+
+#ifndef GEMM_KC
+#define GEMM_KC 256 /**< Depth of the packed AF/XF panels (a GEMM_NR sliver of XF stays in L1) */
+#endif
+
+#ifndef GEMM_NC
+#define GEMM_NC 4096 /**< Columns of the packed XF panel (multiple of GEMM_NR, sized for L3) */
+#endif
+
+/**
+ * @brief Alignment in bytes of every heap buffer (one cache line, one AVX-512 register).
+ */
+#define MATRIX_ALIGN 64
+
 #define STR1(x) #x
 #define STR(x) STR1(x)
 
+/**
+ * @brief Loop order inside the tiles of the blocked multiplication.
+ */
+typedef enum {
+    BLOCKED_IJK = 0, /**< Dot product over the k block for each (i, j) */
+    BLOCKED_IKJ = 1  /**< Row update: YF[i][j block] += AF[i][k] * XF[k][j block] */
+} blocked_order;
+
+/**
+ * @brief Runtime state of the benchmark: sizes, repetitions and the heap buffers.
+ *
+ * Matrices are stored row-major with a row stride of @c ld elements, so element
+ * (i, j) of AF lives at @c AF[i * ld + j]. Vectors are dense with n^2 elements.
+ * Buffers are allocated once for the largest size of a sweep and reused by
+ * matrix_ctx_resize() for smaller sizes, keeping pages and TLB entries warm.
+ */
+typedef struct {
+    int n;              /**< Size of matrices [n][n] and vectors [n^2] */
+    int ld;             /**< Leading dimension (row stride in elements) of the matrices */
+    int m;              /**< Number of iterations for each function */
+    int bl;             /**< Block size of matrix_mult_blocked() (BL unless tuned) */
+    int bl_order;       /**< Loop order inside the blocks of matrix_mult_blocked() (blocked_order) */
+    size_t cap;         /**< Elements allocated per matrix */
+    size_t vcap;        /**< Elements allocated per vector */
+    TYPE *AF, *YF, *XF; /**< Matrices of size [n][ld] */
+    TYPE *YT;           /**< Scratch matrix of size [n][ld] (transposes) */
+    TYPE *BF, *CF;      /**< Vectors of size n^2 */
+    double *results;    /**< Benchmark results in number of cycles, one per iteration */
+    int rcap;           /**< Entries allocated in results (>= m; grown by adaptive sampling) */
+} matrix_ctx;
+
+/**
+ * @brief Smallest leading dimension >= n that keeps every row MATRIX_ALIGN-aligned.
+ * @param n Matrix dimension.
+ * @return The padded leading dimension.
+ */
+int matrix_default_ld(int n);
+
+/**
+ * @brief Allocates aligned, zeroed buffers for n x n matrices.
+ * @param ctx Context to initialize.
+ * @param n Matrix dimension.
+ * @param ld Leading dimension, or 0 for matrix_default_ld(n).
+ * @param m Number of iterations for each function.
+ * @return 0 on success, -1 on invalid arguments or allocation failure.
+ */
+int matrix_ctx_init(matrix_ctx *ctx, int n, int ld, int m);
+
+/**
+ * @brief Switches the context to a new size, reallocating only if the buffers are too small.
+ * @param ctx Initialized context.
+ * @param n New matrix dimension.
+ * @param ld New leading dimension, or 0 for matrix_default_ld(n).
+ * @return 0 on success, -1 on invalid arguments or allocation failure.
+ */
+int matrix_ctx_resize(matrix_ctx *ctx, int n, int ld);
+
+/**
+ * @brief Grows the results array to at least @p count entries (never shrinks it).
+ * @return 0 on success, -1 on allocation failure (the array is left unchanged).
+ */
+int matrix_ctx_reserve_results(matrix_ctx *ctx, int count);
+
+/**
+ * @brief Fills AF, XF, BF and CF with reproducible pseudo-random values.
+ *
+ * Values are in [-1, 1] for floating types and small integers otherwise, so products
+ * stay representable and numerical errors of the fast multiplications are visible.
+ *
+ * @param ctx Context sized with matrix_ctx_init()/matrix_ctx_resize().
+ * @param seed Seed of the generator.
+ */
+void matrix_ctx_fill(matrix_ctx *ctx, unsigned int seed);
+
+/**
+ * @brief Releases all buffers of the context.
+ * @param ctx Context to release.
+ */
+void matrix_ctx_free(matrix_ctx *ctx);
+
+/**
+ * @brief Stores a result in the context's results array.
+ * @param ctx Benchmark context.
+ * @param res The result to store.
+ * @param index The index where the result should be stored.
+ */
+void add_result(matrix_ctx *ctx, double res, int index);
+
+/**
+ * @brief Separator for result output.
+ */
+void separator();
+
+/*
+ * Kernels: each call performs one untimed execution on the context's buffers.
+ * Repetitions, timing and reporting are done by the benchmark runner (bench.h).
+ */
+
 /**
  * @brief Sets all elements of vector BF to zero.
  */
-void zero_vector();
+void zero_vector(matrix_ctx *ctx);
 
 /**
  * @brief Copies matrix YF to AF in row-major order.
  */
-void copy_matrix_ij();
+void copy_matrix_ij(matrix_ctx *ctx);
 
 /**
  * @brief Copies matrix YF to AF in column-major order.
  */
-void copy_matrix_ji();
+void copy_matrix_ji(matrix_ctx *ctx);
 
 /**
  * @brief Adds matrix YF to AF in row-major order.
  */
-void add_matrix_ij();
+void add_matrix_ij(matrix_ctx *ctx);
 
 /**
  * @brief Adds matrix YF to AF in column-major order.
  */
-void add_matrix_ji();
+void add_matrix_ji(matrix_ctx *ctx);
 
 /**
  * @brief Computes the scalar product of vectors BF and CF.
  */
-void scalar_product();
+void scalar_product(matrix_ctx *ctx);
 
 /**
  * @brief Performs matrix multiplication AF * XF = YF in ijk order.
  */
-void matrix_mult_ijk();
+void matrix_mult_ijk(matrix_ctx *ctx);
 
 /**
  * @brief Performs matrix multiplication AF * XF = YF in ikj order.
  */
-void matrix_mult_ikj();
+void matrix_mult_ikj(matrix_ctx *ctx);
 
 /**
  * @brief Performs blocked matrix multiplication for optimized cache usage.
+ *
+ * Uses the context's block size and loop order (ctx->bl, ctx->bl_order).
  */
-void matrix_mult_blocked();
+void matrix_mult_blocked(matrix_ctx *ctx);
+
+/**
+ * @brief One untimed blocked multiplication AF * XF = YF with the given block size and loop order.
+ * @param ctx Benchmark context.
+ * @param bl Block size of the j and k tiles.
+ * @param order Loop order inside the tiles (blocked_order).
+ */
+void matrix_mult_blocked_run(matrix_ctx *ctx, int bl, int order);
+
+/**
+ * @brief Blocked multiplication YF = AF * XF of n x n operands with arbitrary row strides.
+ * @param n Matrix dimension.
+ * @param AF Left operand, row stride @p lda.
+ * @param lda Leading dimension of AF.
+ * @param XF Right operand, row stride @p ldx.
+ * @param ldx Leading dimension of XF.
+ * @param YF Result (overwritten), row stride @p ldy.
+ * @param ldy Leading dimension of YF.
+ * @param bl Block size of the j and k tiles.
+ * @param order Loop order inside the tiles (blocked_order).
+ */
+void blocked_mult(int n, const TYPE *AF, size_t lda, const TYPE *XF, size_t ldx,
+                  TYPE *YF, size_t ldy, int bl, int order);
+
+/**
+ * @brief Name of a blocked_order value ("ijk" or "ikj").
+ */
+const char *blocked_order_name(int order);
 
 /**
  * @brief Performs matrix multiplication using the transposed matrix (i-j-k order).
  *
  * This function multiplies matrix A with the transposed matrix of X (XT) to improve cache efficiency.
- * The result is stored in matrix Y. The function also measures the execution time.
+ * The result is stored in matrix Y. XT must already be in the scratch matrix YT (see transpose()).
  */
-void matrix_mult_trans_ijk();
+void matrix_mult_trans_ijk(matrix_ctx *ctx);
 
-/** 
+/**
+ * @brief Transposes XF into YT, then runs matrix_mult_trans_ijk(); the reference for error checks.
+ */
+void matrix_mult_trans_ijk_run(matrix_ctx *ctx);
+
+/**
  * @brief Computes the optimized scalar product of vectors BF and CF.
  */
-void scalar_product_opt();
+void scalar_product_opt(matrix_ctx *ctx);
+
+/**
+ * @brief Sets all elements of vector BF to zero with the SIMD primitive chosen by simd_select().
+ *
+ * Vectors larger than SIMD_STREAM_BYTES are cleared with non-temporal stores.
+ */
+void zero_vector_simd(matrix_ctx *ctx);
+
+/**
+ * @brief Copies matrix YF to AF in row-major order with the SIMD primitive chosen by simd_select().
+ */
+void copy_matrix_ij_simd(matrix_ctx *ctx);
+
+/**
+ * @brief Adds matrix YF to AF in row-major order with the SIMD primitive chosen by simd_select().
+ */
+void add_matrix_ij_simd(matrix_ctx *ctx);
+
+/**
+ * @brief Computes the scalar product of vectors BF and CF with the SIMD primitive chosen by simd_select().
+ */
+void scalar_product_simd(matrix_ctx *ctx);
+
+/**
+ * @brief Name of the SIMD variant used by the typed kernels (add, dot, transpose) for TYPE.
+ *
+ * simd.name for float and double, "scalar" for element types without vector primitives.
+ */
+const char *matrix_simd_variant(void);
 
 #endif /* MATRIX_OPS_H */
@@ -0,0 +1,355 @@
+/**
+ * @file matrix_parallel.c
+ * @brief Implementation of the thread pool and the parallel matrix multiplications.
+ */
+
+#define _GNU_SOURCE
+#include "matrix_parallel.h"
+#include "transpose.h"
+#include "tsc.h"
+#include "trace.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+struct thread_pool {
+    int nthreads;
+    pthread_t *threads;
+    int *cpus;              /**< CPU each worker is pinned to */
+    double *spans;          /**< Cycles spent by each worker in the last job */
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned long generation; /**< Incremented for every job */
+    int nactive;
+    int pending;            /**< Active workers that have not finished the current job */
+    int quit;
+    pool_fn fn;
+    void *arg;
+};
+
+/**
+ * @brief Arguments of one worker thread.
+ */
+typedef struct {
+    thread_pool *pool;
+    int tid;
+} worker_arg;
+
+static inline int min(int a, int b) {
+    return (a < b) ? a : b;
+}
+
+static void *worker_main(void *p) {
+    worker_arg *w = p;
+    thread_pool *pool = w->pool;
+    int tid = w->tid;
+    unsigned long seen = 0;
+    free(w);
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(pool->cpus[tid], &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->generation == seen && !pool->quit) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->quit) {
+            break;
+        }
+        seen = pool->generation;
+        if (tid >= pool->nactive) {
+            continue;
+        }
+        pool_fn fn = pool->fn;
+        void *arg = pool->arg;
+        int nactive = pool->nactive;
+        pthread_mutex_unlock(&pool->lock);
+
+        unsigned long long t0 = start_timer();
+        trace_begin("pool_job");
+        fn(arg, tid, nactive);
+        trace_end("pool_job");
+        pool->spans[tid] = dtime(t0, stop_timer());
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    trace_detach();
+    return NULL;
+}
+
+thread_pool *pool_create(int nthreads) {
+    if (nthreads <= 0) {
+        return NULL;
+    }
+    thread_pool *pool = calloc(1, sizeof(*pool));
+    if (!pool) {
+        return NULL;
+    }
+    pool->threads = calloc((size_t)nthreads, sizeof(pthread_t));
+    pool->cpus = calloc((size_t)nthreads, sizeof(int));
+    pool->spans = calloc((size_t)nthreads, sizeof(double));
+    if (!pool->threads || !pool->cpus || !pool->spans) {
+        pool_destroy(pool);
+        return NULL;
+    }
+
+    /* Pin round-robin over the CPUs we are allowed to run on (respects taskset). */
+    cpu_set_t allowed;
+    int ncpus = 0, allowed_cpus[CPU_SETSIZE];
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; c++) {
+            if (CPU_ISSET(c, &allowed)) {
+                allowed_cpus[ncpus++] = c;
+            }
+        }
+    }
+    for (int t = 0; t < nthreads; t++) {
+        pool->cpus[t] = ncpus > 0 ? allowed_cpus[t % ncpus] : t;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    for (int t = 0; t < nthreads; t++) {
+        worker_arg *w = malloc(sizeof(*w));
+        if (!w) {
+            pool_destroy(pool);
+            return NULL;
+        }
+        w->pool = pool;
+        w->tid = t;
+        if (pthread_create(&pool->threads[t], NULL, worker_main, w) != 0) {
+            free(w);
+            pool_destroy(pool);
+            return NULL;
+        }
+        pool->nthreads++;
+    }
+    return pool;
+}
+
+void pool_run(thread_pool *pool, int nactive, pool_fn fn, void *arg) {
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->arg = arg;
+    pool->nactive = min(nactive, pool->nthreads);
+    pool->pending = pool->nactive;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    while (pool->pending > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+const double *pool_spans(const thread_pool *pool) {
+    return pool->spans;
+}
+
+void pool_destroy(thread_pool *pool) {
+    if (!pool) {
+        return;
+    }
+    if (pool->nthreads > 0) {
+        pthread_mutex_lock(&pool->lock);
+        pool->quit = 1;
+        pthread_cond_broadcast(&pool->start);
+        pthread_mutex_unlock(&pool->lock);
+        for (int t = 0; t < pool->nthreads; t++) {
+            pthread_join(pool->threads[t], NULL);
+        }
+        pthread_mutex_destroy(&pool->lock);
+        pthread_cond_destroy(&pool->start);
+        pthread_cond_destroy(&pool->done);
+    }
+    free(pool->threads);
+    free(pool->cpus);
+    free(pool->spans);
+    free(pool);
+}
+
+/* ----------------------------------------------------------------
+   Parallel kernels
+   ---------------------------------------------------------------- */
+
+/**
+ * @brief Shared description of one parallel multiplication.
+ */
+typedef struct {
+    matrix_ctx *ctx;
+    atomic_int next_tile; /**< Next unclaimed tile (dynamic scheduling) */
+    int tile;             /**< Edge of the YF tiles and of the k blocks (ctx->bl) */
+    int tiles_per_row;    /**< Tiles along the columns of YF */
+    int ntiles;
+} par_job;
+
+/**
+ * @brief Contiguous static share [*lo, *hi) of n rows for worker tid.
+ */
+static void row_range(int n, int tid, int nthreads, int *lo, int *hi) {
+    int chunk = (n + nthreads - 1) / nthreads;
+    *lo = min(n, tid * chunk);
+    *hi = min(n, *lo + chunk);
+}
+
+static void ikj_worker(void *arg, int tid, int nthreads) {
+    par_job *job = arg;
+    const int n = job->ctx->n;
+    const size_t ld = job->ctx->ld;
+    const TYPE *AF = job->ctx->AF, *XF = job->ctx->XF;
+    TYPE *YF = job->ctx->YF;
+    int lo, hi;
+
+    row_range(n, tid, nthreads, &lo, &hi);
+    for (int i = lo; i < hi; i++) {
+        for (int k = 0; k < n; k++) {
+            TYPE a = AF[i * ld + k];
+            for (int j = 0; j < n; j++) {
+                YF[i * ld + j] += a * XF[k * ld + j];
+            }
+        }
+    }
+}
+
+static void blocked_worker(void *arg, int tid, int nthreads) {
+    par_job *job = arg;
+    const int n = job->ctx->n;
+    const size_t ld = job->ctx->ld;
+    const int bl = job->tile;
+    const TYPE *AF = job->ctx->AF, *XF = job->ctx->XF;
+    TYPE *YF = job->ctx->YF;
+    (void)tid;
+    (void)nthreads;
+
+    for (int t; (t = atomic_fetch_add_explicit(&job->next_tile, 1, memory_order_relaxed)) < job->ntiles;) {
+        int ii = (t / job->tiles_per_row) * bl;
+        int jj = (t % job->tiles_per_row) * bl;
+        int iend = min(ii + bl, n), jend = min(jj + bl, n);
+        trace_begin("par_tile");
+
+        for (int i = ii; i < iend; i++) {
+            for (int j = jj; j < jend; j++) {
+                YF[i * ld + j] = ZERO;
+            }
+        }
+        for (int kk = 0; kk < n; kk += bl) {
+            int kend = min(kk + bl, n);
+            for (int i = ii; i < iend; i++) {
+                for (int k = kk; k < kend; k++) {
+                    TYPE a = AF[i * ld + k];
+                    for (int j = jj; j < jend; j++) {
+                        YF[i * ld + j] += a * XF[k * ld + j];
+                    }
+                }
+            }
+        }
+        trace_end("par_tile");
+    }
+}
+
+static void trans_worker(void *arg, int tid, int nthreads) {
+    par_job *job = arg;
+    const int n = job->ctx->n;
+    const size_t ld = job->ctx->ld;
+    const TYPE *AF = job->ctx->AF, *XT = job->ctx->YT;
+    TYPE *YF = job->ctx->YF;
+    int lo, hi;
+
+    row_range(n, tid, nthreads, &lo, &hi);
+    for (int i = lo; i < hi; i++) {
+        for (int j = 0; j < n; j++) {
+            TYPE s = ZERO;
+            for (int k = 0; k < n; k++) {
+                s += AF[i * ld + k] * XT[j * ld + k];
+            }
+            YF[i * ld + j] = s;
+        }
+    }
+}
+
+void matrix_mult_ikj_par(matrix_ctx *ctx, thread_pool *pool, int nthreads) {
+    par_job job = { .ctx = ctx };
+    pool_run(pool, nthreads, ikj_worker, &job);
+}
+
+void matrix_mult_blocked_par(matrix_ctx *ctx, thread_pool *pool, int nthreads) {
+    par_job job = { .ctx = ctx };
+    job.tile = ctx->bl;
+    job.tiles_per_row = (ctx->n + job.tile - 1) / job.tile;
+    job.ntiles = job.tiles_per_row * job.tiles_per_row;
+    atomic_init(&job.next_tile, 0);
+    pool_run(pool, nthreads, blocked_worker, &job);
+}
+
+void matrix_mult_trans_ijk_par(matrix_ctx *ctx, thread_pool *pool, int nthreads) {
+    par_job job = { .ctx = ctx };
+    pool_run(pool, nthreads, trans_worker, &job);
+}
+
+/* ----------------------------------------------------------------
+   Strong-scaling report
+   ---------------------------------------------------------------- */
+
+typedef void (*par_kernel)(matrix_ctx *ctx, thread_pool *pool, int nthreads);
+
+/**
+ * @brief Times one parallel kernel for 1..max_threads threads and prints its scaling table.
+ */
+static void scaling_table(matrix_ctx *ctx, thread_pool *pool, int max_threads,
+                          const char *name, par_kernel kernel, FILE *out) {
+    const double flops = (double)ctx->n * ctx->n * ctx->n;
+    double t1 = 0.0;
+
+    fprintf(out, "%s_PAR\tthreads\tcycles\tcycles/iter\tspeedup\tefficiency\timbalance\n", name);
+    for (int p = 1; p <= max_threads; p = (p == max_threads) ? p + 1 : min(2 * p, max_threads)) {
+        double best = 0.0, best_imbalance = 1.0;
+        for (int m = 0; m < ctx->m; m++) {
+            unsigned long long start = start_timer();
+            kernel(ctx, pool, p);
+            double t = dtime(start, stop_timer());
+            if (m == 0 || t < best) {
+                const double *spans = pool_spans(pool);
+                double sum = 0.0, max = 0.0;
+                for (int i = 0; i < p; i++) {
+                    sum += spans[i];
+                    if (spans[i] > max) max = spans[i];
+                }
+                best = t;
+                best_imbalance = sum > 0.0 ? max / (sum / p) : 1.0;
+            }
+        }
+        if (p == 1) {
+            t1 = best;
+        }
+        double speedup = t1 / best;
+        fprintf(out, "%s_PAR\t%d\t%.0f\t%.3f\t%.2f\t%.2f\t%.3f\n", name, p, best, best / flops,
+                speedup, speedup / p, best_imbalance);
+    }
+    fprintf(out, "\n");
+}
+
+int parallel_scaling(matrix_ctx *ctx, int max_threads, FILE *out) {
+    thread_pool *pool = pool_create(max_threads);
+    if (!pool) {
+        fprintf(stderr, "Cannot start %d worker threads\n", max_threads);
+        return -1;
+    }
+
+    transpose(ctx->n, ctx->n, ctx->XF, ctx->ld, ctx->YT, ctx->ld);
+
+    scaling_table(ctx, pool, max_threads, "MATRIX_MULT_IKJ", matrix_mult_ikj_par, out);
+    scaling_table(ctx, pool, max_threads, "MATRIX_MULT_BLOCKED", matrix_mult_blocked_par, out);
+    scaling_table(ctx, pool, max_threads, "MM_TRANS_ijk", matrix_mult_trans_ijk_par, out);
+
+    pool_destroy(pool);
+    return 0;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file matrix_parallel.h
+ * @brief Pinned pthread pool and parallel matrix multiplications with per-thread TSC timing.
+ */
+
+#ifndef MATRIX_PARALLEL_H
+#define MATRIX_PARALLEL_H
+
+#include "matrix_ops.h"
+
+/**
+ * @brief Opaque pool of worker threads, each pinned to one CPU.
+ */
+typedef struct thread_pool thread_pool;
+
+/**
+ * @brief Work function run by every active worker.
+ * @param arg Shared job description.
+ * @param tid Worker index in [0, nthreads).
+ * @param nthreads Number of active workers.
+ */
+typedef void (*pool_fn)(void *arg, int tid, int nthreads);
+
+/**
+ * @brief Starts @p nthreads workers pinned round-robin to the CPUs of the process affinity mask.
+ * @param nthreads Number of workers.
+ * @return The pool, or NULL on failure.
+ */
+thread_pool *pool_create(int nthreads);
+
+/**
+ * @brief Runs @p fn on the first @p nactive workers and waits until all of them return.
+ *
+ * Each worker times its own call with start_timer()/stop_timer(); see pool_spans().
+ */
+void pool_run(thread_pool *pool, int nactive, pool_fn fn, void *arg);
+
+/**
+ * @brief Per-worker elapsed cycles of the last pool_run(), indexed by worker.
+ */
+const double *pool_spans(const thread_pool *pool);
+
+/**
+ * @brief Stops and joins the workers and frees the pool.
+ */
+void pool_destroy(thread_pool *pool);
+
+/**
+ * @brief AF * XF += YF in ikj order, rows of YF split statically across @p nthreads workers.
+ */
+void matrix_mult_ikj_par(matrix_ctx *ctx, thread_pool *pool, int nthreads);
+
+/**
+ * @brief Blocked AF * XF = YF; ctx->bl x ctx->bl tiles of YF, multiplied in ctx->bl blocks of k, are claimed
+ *        dynamically from a shared counter.
+ */
+void matrix_mult_blocked_par(matrix_ctx *ctx, thread_pool *pool, int nthreads);
+
+/**
+ * @brief AF * XT = YF with XT = transpose(XF) in YT, rows of YF split statically across @p nthreads workers.
+ */
+void matrix_mult_trans_ijk_par(matrix_ctx *ctx, thread_pool *pool, int nthreads);
+
+/**
+ * @brief Prints a strong-scaling table (1..max_threads) for the three parallel multiplications.
+ *
+ * For each thread count the best of ctx->m runs is reported with speedup, parallel
+ * efficiency and load imbalance (slowest worker span over mean worker span).
+ *
+ * @param ctx Benchmark context.
+ * @param max_threads Largest number of threads.
+ * @param out Where the tables are printed (the report's notes stream).
+ * @return 0 on success, -1 if the pool cannot be created.
+ */
+int parallel_scaling(matrix_ctx *ctx, int max_threads, FILE *out);
+
+#endif /* MATRIX_PARALLEL_H */
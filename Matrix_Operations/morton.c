@@ -0,0 +1,117 @@
+/**
+ * @file morton.c
+ * @brief Implementation of the Morton layout conversions and the recursive multiplication.
+ */
+
+#include "morton.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define LEAF (MORTON_BASE * MORTON_BASE) /**< Elements per leaf block */
+
+static inline int min(int a, int b) {
+    return (a < b) ? a : b;
+}
+
+void morton_layout_init(morton_layout *l, int n) {
+    int need = (n + MORTON_BASE - 1) / MORTON_BASE;
+    l->n = n;
+    l->used = need;
+    l->blocks = 1;
+    while (l->blocks < need) {
+        l->blocks *= 2;
+    }
+    l->elems = (size_t)l->blocks * l->blocks * LEAF;
+}
+
+void morton_from_rowmajor(const morton_layout *l, TYPE *dst, const TYPE *src, size_t ld) {
+    const int n = l->n;
+    for (int bi = 0; bi * MORTON_BASE < n; bi++) {
+        for (int bj = 0; bj * MORTON_BASE < n; bj++) {
+            int i0 = bi * MORTON_BASE, j0 = bj * MORTON_BASE;
+            int rows = min(MORTON_BASE, n - i0), cols = min(MORTON_BASE, n - j0);
+            TYPE *blk = dst + morton_offset(i0, j0);
+            for (int i = 0; i < rows; i++) {
+                memcpy(blk + i * MORTON_BASE, src + (i0 + i) * ld + j0, (size_t)cols * sizeof(TYPE));
+            }
+        }
+    }
+}
+
+void morton_to_rowmajor(const morton_layout *l, TYPE *dst, size_t ld, const TYPE *src) {
+    const int n = l->n;
+    for (int bi = 0; bi * MORTON_BASE < n; bi++) {
+        for (int bj = 0; bj * MORTON_BASE < n; bj++) {
+            int i0 = bi * MORTON_BASE, j0 = bj * MORTON_BASE;
+            int rows = min(MORTON_BASE, n - i0), cols = min(MORTON_BASE, n - j0);
+            const TYPE *blk = src + morton_offset(i0, j0);
+            for (int i = 0; i < rows; i++) {
+                memcpy(dst + (i0 + i) * ld + j0, blk + i * MORTON_BASE, (size_t)cols * sizeof(TYPE));
+            }
+        }
+    }
+}
+
+/**
+ * @brief Base case: C += A * B on MORTON_BASE x MORTON_BASE row-major leaf blocks.
+ *
+ * All trip counts are compile-time constants, so the j loop is fully vectorized.
+ */
+static void leaf_kernel(TYPE *restrict C, const TYPE *restrict A, const TYPE *restrict B) {
+    for (int i = 0; i < MORTON_BASE; i++) {
+        TYPE *c = C + i * MORTON_BASE;
+        for (int k = 0; k < MORTON_BASE; k++) {
+            const TYPE a = A[i * MORTON_BASE + k];
+            const TYPE *b = B + k * MORTON_BASE;
+            for (int j = 0; j < MORTON_BASE; j++) {
+                c[j] += a * b[j];
+            }
+        }
+    }
+}
+
+/**
+ * @brief C += A * B for matrices of @p blocks x @p blocks leaf blocks, each one contiguous in Z order.
+ *
+ * Quadrant q (0 = top-left, 1 = top-right, 2 = bottom-left, 3 = bottom-right) starts at
+ * q * quarter elements. Only the first @p rows block rows of C and A, @p inner block columns
+ * of A (rows of B) and @p cols block columns of C and B hold elements; products involving
+ * padding blocks alone are skipped.
+ */
+static void mult_rec(TYPE *C, const TYPE *A, const TYPE *B, int blocks, int rows, int inner, int cols) {
+    if (rows <= 0 || inner <= 0 || cols <= 0) {
+        return;
+    }
+    if (blocks == 1) {
+        leaf_kernel(C, A, B);
+        return;
+    }
+    const int h = blocks / 2;
+    const size_t q = (size_t)h * h * LEAF;
+    const int r0 = min(rows, h), r1 = rows - r0;
+    const int k0 = min(inner, h), k1 = inner - k0;
+    const int c0 = min(cols, h), c1 = cols - c0;
+
+    mult_rec(C,         A,         B,         h, r0, k0, c0);  /* C00 += A00 B00 */
+    mult_rec(C,         A + q,     B + 2 * q, h, r0, k1, c0);  /* C00 += A01 B10 */
+    mult_rec(C + q,     A,         B + q,     h, r0, k0, c1);  /* C01 += A00 B01 */
+    mult_rec(C + q,     A + q,     B + 3 * q, h, r0, k1, c1);  /* C01 += A01 B11 */
+    mult_rec(C + 2 * q, A + 2 * q, B,         h, r1, k0, c0);  /* C10 += A10 B00 */
+    mult_rec(C + 2 * q, A + 3 * q, B + 2 * q, h, r1, k1, c0);  /* C10 += A11 B10 */
+    mult_rec(C + 3 * q, A + 2 * q, B + q,     h, r1, k0, c1);  /* C11 += A10 B01 */
+    mult_rec(C + 3 * q, A + 3 * q, B + 3 * q, h, r1, k1, c1);  /* C11 += A11 B11 */
+}
+
+void morton_mult(const morton_layout *l, TYPE *C, const TYPE *A, const TYPE *B) {
+    memset(C, 0, l->elems * sizeof(TYPE));
+    mult_rec(C, A, B, l->blocks, l->used, l->used, l->used);
+}
+
+TYPE *morton_alloc(const morton_layout *l) {
+    void *p = NULL;
+    if (posix_memalign(&p, MATRIX_ALIGN, l->elems * sizeof(TYPE)) != 0) {
+        return NULL;
+    }
+    memset(p, 0, l->elems * sizeof(TYPE));
+    return p;
+}
@@ -0,0 +1,80 @@
+/**
+ * @file morton.h
+ * @brief Z-order (Morton) blocked matrix layout and cache-oblivious recursive multiplication.
+ */
+
+#ifndef MORTON_H
+#define MORTON_H
+
+#include "matrix_ops.h"
+
+#ifndef MORTON_BASE
+#define MORTON_BASE 32 /**< Edge of the row-major leaf blocks (and of the base-case kernel) */
+#endif
+
+/**
+ * @brief Geometry of an n x n matrix in Morton blocked layout.
+ *
+ * The matrix is padded with zeros to blocks x blocks leaf blocks of MORTON_BASE^2
+ * elements, blocks being a power of two. Leaf blocks are row-major and stored in
+ * Z order of (block row, block column), so every quadrant at every recursion
+ * level is one contiguous range. Only the first used x used blocks hold matrix
+ * elements; the multiplication skips the quadrants made of padding blocks alone.
+ */
+typedef struct {
+    int n;        /**< Logical matrix size */
+    int used;     /**< Leaf blocks per side holding elements: ceil(n / MORTON_BASE) */
+    int blocks;   /**< Leaf blocks per side of the storage (power of two) */
+    size_t elems; /**< Elements of the padded matrix: (blocks * MORTON_BASE)^2 */
+} morton_layout;
+
+/**
+ * @brief Spreads the low 32 bits of @p x to the even bit positions.
+ */
+static inline uint64_t morton_spread(uint64_t x) {
+    x &= 0xffffffffULL;
+    x = (x | (x << 16)) & 0x0000ffff0000ffffULL;
+    x = (x | (x << 8)) & 0x00ff00ff00ff00ffULL;
+    x = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    x = (x | (x << 2)) & 0x3333333333333333ULL;
+    x = (x | (x << 1)) & 0x5555555555555555ULL;
+    return x;
+}
+
+/**
+ * @brief Element offset of (i, j) in the Morton layout.
+ */
+static inline size_t morton_offset(int i, int j) {
+    uint64_t block = (morton_spread((uint64_t)(i / MORTON_BASE)) << 1) | morton_spread((uint64_t)(j / MORTON_BASE));
+    return (size_t)block * MORTON_BASE * MORTON_BASE + (size_t)(i % MORTON_BASE) * MORTON_BASE + (size_t)(j % MORTON_BASE);
+}
+
+/**
+ * @brief Computes the padded geometry for an n x n matrix.
+ */
+void morton_layout_init(morton_layout *l, int n);
+
+/**
+ * @brief Converts a row-major matrix (row stride ld) into Morton layout; the padding of @p dst must already be zero.
+ */
+void morton_from_rowmajor(const morton_layout *l, TYPE *dst, const TYPE *src, size_t ld);
+
+/**
+ * @brief Converts a Morton-layout matrix back to row-major (row stride ld), dropping the padding.
+ */
+void morton_to_rowmajor(const morton_layout *l, TYPE *dst, size_t ld, const TYPE *src);
+
+/**
+ * @brief C = A * B for three Morton-layout matrices, by recursive quadrant splitting down to one leaf block.
+ *
+ * Only the used x used leaf blocks are multiplied: used^3 leaf products, not blocks^3.
+ */
+void morton_mult(const morton_layout *l, TYPE *C, const TYPE *A, const TYPE *B);
+
+/**
+ * @brief Allocates a zeroed, MATRIX_ALIGN-aligned buffer of l->elems elements (release with free()).
+ * @return The buffer, or NULL on allocation failure.
+ */
+TYPE *morton_alloc(const morton_layout *l);
+
+#endif /* MORTON_H */
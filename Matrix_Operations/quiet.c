@@ -0,0 +1,192 @@
+/**
+ * @file quiet.c
+ * @brief Implementation of the quiet-run mode.
+ */
+
+#define _GNU_SOURCE
+#include "quiet.h"
+#include <errno.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+/**
+ * @brief Reads the first line of a sysfs file, without its newline.
+ * @return 0 on success, -1 if the file cannot be read.
+ */
+static int read_sysfs(const char *path, char *buf, size_t len) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return -1;
+    }
+    int ok = fgets(buf, (int)len, f) != NULL;
+    fclose(f);
+    if (!ok) {
+        return -1;
+    }
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+/**
+ * @brief Warns about the frequency scaling and the SMT siblings of @p cpu.
+ */
+static void check_cpu(quiet_state *q, int cpu, FILE *log) {
+    char path[128], value[256];
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_governor", cpu);
+    if (read_sysfs(path, value, sizeof(value)) == 0 && strcmp(value, "performance") != 0) {
+        fprintf(log, "Warning: CPU %d uses the '%s' cpufreq governor, not 'performance'\n", cpu, value);
+        q->warnings++;
+    }
+    if (read_sysfs("/sys/devices/system/cpu/intel_pstate/no_turbo", value, sizeof(value)) == 0 &&
+        strcmp(value, "0") == 0) {
+        fprintf(log, "Warning: turbo boost is enabled (intel_pstate/no_turbo = 0); core cycles will not match TSC cycles\n");
+        q->warnings++;
+    } else if (read_sysfs("/sys/devices/system/cpu/cpufreq/boost", value, sizeof(value)) == 0 &&
+               strcmp(value, "1") == 0) {
+        fprintf(log, "Warning: frequency boost is enabled (cpufreq/boost = 1); core cycles will not match TSC cycles\n");
+        q->warnings++;
+    }
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+    if (read_sysfs(path, value, sizeof(value)) == 0 && strpbrk(value, ",-")) {
+        fprintf(log, "Warning: CPU %d shares its core with SMT siblings %s; keep them idle or disable SMT\n",
+                cpu, value);
+        q->warnings++;
+    }
+}
+
+void quiet_setup(quiet_state *q, int pin, int cpu, int fifo, FILE *log) {
+    q->cpu = -1;
+    q->locked = 0;
+    q->fifo = 0;
+    q->warnings = 0;
+
+    if (pin) {
+        cpu_set_t set;
+        if (cpu < 0) {
+            cpu = sched_getcpu();
+        }
+        int pinned = 0;
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pinned = sched_setaffinity(0, sizeof(set), &set) == 0;
+        } else {
+            errno = EINVAL;
+        }
+        if (pinned) {
+            q->cpu = cpu;
+        } else {
+            fprintf(log, "Warning: cannot pin to CPU %d (%s)\n", cpu, strerror(errno));
+            q->warnings++;
+        }
+    }
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) {
+        q->locked = 1;
+    } else {
+        fprintf(log, "Warning: mlockall failed (%s; see ulimit -l); pages may still be reclaimed\n", strerror(errno));
+        q->warnings++;
+    }
+    if (fifo > 0) {
+        struct sched_param sp = { .sched_priority = fifo };
+        if (sched_setscheduler(0, SCHED_FIFO, &sp) == 0) {
+            q->fifo = fifo;
+        } else {
+            fprintf(log, "Warning: cannot set SCHED_FIFO priority %d (%s)\n", fifo, strerror(errno));
+            q->warnings++;
+        }
+    }
+    check_cpu(q, q->cpu >= 0 ? q->cpu : sched_getcpu(), log);
+}
+
+static void touch_pages(void *p, size_t bytes) {
+    volatile char *c = p;
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+    for (size_t off = 0; p && off < bytes; off += page) {
+        c[off] = c[off];
+    }
+}
+
+void quiet_prefault(matrix_ctx *ctx) {
+    TYPE *matrices[] = { ctx->AF, ctx->YF, ctx->XF, ctx->YT };
+    for (int i = 0; i < 4; i++) {
+        touch_pages(matrices[i], ctx->cap * sizeof(TYPE));
+    }
+    touch_pages(ctx->BF, ctx->vcap * sizeof(TYPE));
+    touch_pages(ctx->CF, ctx->vcap * sizeof(TYPE));
+    touch_pages(ctx->results, (size_t)ctx->rcap * sizeof(double));
+}
+
+/**
+ * @brief Sum of the /proc/interrupts column of @p cpu, or -1 if it cannot be read.
+ *
+ * Timer rows (LOC, and sources described as a timer) are left out: the periodic tick hits
+ * every run longer than a few milliseconds and says nothing about interference.
+ */
+static long long cpu_interrupts(int cpu) {
+    FILE *f = fopen("/proc/interrupts", "r");
+    char *line = NULL, name[16];
+    size_t cap = 0;
+    int col = -1;
+    long long total = 0;
+
+    if (!f) {
+        return -1;
+    }
+    snprintf(name, sizeof(name), "CPU%d", cpu);
+    if (getline(&line, &cap, f) > 0) {
+        int c = 0;
+        for (char *tok = strtok(line, " \t\n"); tok; tok = strtok(NULL, " \t\n"), c++) {
+            if (strcmp(tok, name) == 0) {
+                col = c;
+            }
+        }
+    }
+    while (col >= 0 && getline(&line, &cap, f) > 0) {
+        char *p = strchr(line, ':');
+        if (!p || strstr(line, "timer") || strncmp(line + strspn(line, " "), "LOC:", 4) == 0) {
+            continue;
+        }
+        p++;
+        for (int c = 0; c <= col; c++) {
+            char *end;
+            unsigned long long v = strtoull(p, &end, 10);
+            if (end == p) {
+                break;
+            }
+            if (c == col) {
+                total += (long long)v;
+            }
+            p = end;
+        }
+    }
+    free(line);
+    fclose(f);
+    return col >= 0 ? total : -1;
+}
+
+void noise_read(const quiet_state *q, noise_sample *s) {
+    struct rusage ru;
+
+    if (getrusage(RUSAGE_THREAD, &ru) == 0) {
+        s->vcsw = ru.ru_nvcsw;
+        s->ivcsw = ru.ru_nivcsw;
+        s->faults = ru.ru_minflt + ru.ru_majflt;
+    } else {
+        s->vcsw = s->ivcsw = s->faults = 0;
+    }
+    s->irq = q->cpu >= 0 ? cpu_interrupts(q->cpu) : -1;
+}
+
+int noise_delta(const noise_sample *start, const noise_sample *stop, noise_sample *delta) {
+    delta->vcsw = stop->vcsw - start->vcsw;
+    delta->ivcsw = stop->ivcsw - start->ivcsw;
+    delta->faults = stop->faults - start->faults;
+    delta->irq = (start->irq >= 0 && stop->irq >= 0) ? stop->irq - start->irq : -1;
+    return delta->vcsw > 0 || delta->ivcsw > 0 || delta->irq > 0;
+}
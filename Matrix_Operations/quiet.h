@@ -0,0 +1,58 @@
+/**
+ * @file quiet.h
+ * @brief Quiet-run mode: CPU pinning, memory locking, prefaulting, checks of the frequency
+ *        and SMT setup, and detection of the context switches and interrupts hitting a measurement.
+ */
+
+#ifndef QUIET_H
+#define QUIET_H
+
+#include "matrix_ops.h"
+
+/**
+ * @brief What quiet_setup() managed to do.
+ */
+typedef struct {
+    int cpu;      /**< CPU the process is pinned to, -1 if not pinned */
+    int locked;   /**< 1 if mlockall() succeeded */
+    int fifo;     /**< SCHED_FIFO priority in effect, 0 if none */
+    int warnings; /**< Number of warnings printed */
+} quiet_state;
+
+/**
+ * @brief Context switches, page faults and interrupts counted so far.
+ */
+typedef struct {
+    long vcsw;     /**< Voluntary context switches of the calling thread */
+    long ivcsw;    /**< Involuntary context switches (preemptions) */
+    long faults;   /**< Minor and major page faults */
+    long long irq; /**< Interrupts on the pinned CPU (/proc/interrupts, timer ticks excluded), -1 if unknown */
+} noise_sample;
+
+/**
+ * @brief Enters quiet-run mode and warns (on @p log) about what could still disturb the timings.
+ *
+ * Pins the calling thread to @p cpu (the CPU it runs on if < 0, not at all if @p pin is 0),
+ * locks current and future memory, sets SCHED_FIFO with priority @p fifo if > 0, then checks the
+ * cpufreq governor, turbo and the SMT siblings of the CPU. Failures are warnings, not errors.
+ * Call it before calibrate_tsc(), which must run on the measured CPU.
+ */
+void quiet_setup(quiet_state *q, int pin, int cpu, int fifo, FILE *log);
+
+/**
+ * @brief Writes to every page of the context's buffers so that no timed run takes a page fault.
+ */
+void quiet_prefault(matrix_ctx *ctx);
+
+/**
+ * @brief Reads the noise counters (getrusage() and /proc/interrupts, a few tens of microseconds).
+ */
+void noise_read(const quiet_state *q, noise_sample *s);
+
+/**
+ * @brief Counts between two samples; irq stays -1 if unknown.
+ * @return 1 if a context switch or an interrupt happened in between (the measurement is noisy).
+ */
+int noise_delta(const noise_sample *start, const noise_sample *stop, noise_sample *delta);
+
+#endif /* QUIET_H */
@@ -0,0 +1,649 @@
+/**
+ * @file simd_kernels.c
+ * @brief Implementation of the per-ISA vector primitives and their CPUID dispatch.
+ *
+ * Every ISA-specific function carries a target attribute, so the whole file is built
+ * with the baseline flags and one binary runs on any x86-64 machine. Reductions keep
+ * four independent vector accumulators to cover the add/FMA latency. Loads use the
+ * unaligned forms, which cost nothing extra on the 64-byte-aligned matrix_ctx buffers
+ * but stay correct for arbitrary pointers; the last partial vector is handled with
+ * masked loads/stores (AVX2, AVX-512) or a scalar loop (SSE2), so no kernel reads
+ * past the end of its operands. Block transposes work on whole in-register tiles and
+ * finish the right and bottom fringes with the scalar loop.
+ */
+
+#include "simd_kernels.h"
+#include "cpu_features.h"
+#include <immintrin.h>
+#include <stdint.h>
+#include <string.h>
+
+/* ----------------------------------------------------------------
+   Scalar reference
+   ---------------------------------------------------------------- */
+
+static float dot_scalar_f32(const float *x, const float *y, size_t n) {
+    float s = 0.0f;
+    for (size_t i = 0; i < n; i++) {
+        s += x[i] * y[i];
+    }
+    return s;
+}
+
+static double dot_scalar_f64(const double *x, const double *y, size_t n) {
+    double s = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        s += x[i] * y[i];
+    }
+    return s;
+}
+
+static void add_scalar_f32(float *y, const float *x, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        y[i] += x[i];
+    }
+}
+
+static void add_scalar_f64(double *y, const double *x, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        y[i] += x[i];
+    }
+}
+
+static void copy_scalar(void *dst, const void *src, size_t bytes, int stream) {
+    (void)stream;
+    memcpy(dst, src, bytes);
+}
+
+static void zero_scalar(void *dst, size_t bytes, int stream) {
+    (void)stream;
+    memset(dst, 0, bytes);
+}
+
+static void tr_scalar_f32(float *dst, size_t ldd, const float *src, size_t lds, int rows, int cols) {
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            dst[j * ldd + i] = src[i * lds + j];
+        }
+    }
+}
+
+static void tr_scalar_f64(double *dst, size_t ldd, const double *src, size_t lds, int rows, int cols) {
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            dst[j * ldd + i] = src[i * lds + j];
+        }
+    }
+}
+
+/**
+ * @brief Transposes the elements outside the [0, r0) x [0, c0) corner covered by full tiles.
+ */
+static void tr_fringe_f32(float *dst, size_t ldd, const float *src, size_t lds, int rows, int cols, int r0, int c0) {
+    for (int i = 0; i < rows; i++) {
+        for (int j = i < r0 ? c0 : 0; j < cols; j++) {
+            dst[j * ldd + i] = src[i * lds + j];
+        }
+    }
+}
+
+static void tr_fringe_f64(double *dst, size_t ldd, const double *src, size_t lds, int rows, int cols, int r0, int c0) {
+    for (int i = 0; i < rows; i++) {
+        for (int j = i < r0 ? c0 : 0; j < cols; j++) {
+            dst[j * ldd + i] = src[i * lds + j];
+        }
+    }
+}
+
+/**
+ * @brief Bytes to skip so that @p p becomes aligned to @p align (a power of two), capped at @p bytes.
+ */
+static inline size_t head_bytes(const void *p, size_t align, size_t bytes) {
+    size_t head = (size_t)(-(uintptr_t)p & (align - 1));
+    return head < bytes ? head : bytes;
+}
+
+/* ----------------------------------------------------------------
+   SSE2
+   ---------------------------------------------------------------- */
+
+__attribute__((target("sse2")))
+static float dot_sse2_f32(const float *x, const float *y, size_t n) {
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps(), s2 = _mm_setzero_ps(), s3 = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(y + i)));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(x + i + 4), _mm_loadu_ps(y + i + 4)));
+        s2 = _mm_add_ps(s2, _mm_mul_ps(_mm_loadu_ps(x + i + 8), _mm_loadu_ps(y + i + 8)));
+        s3 = _mm_add_ps(s3, _mm_mul_ps(_mm_loadu_ps(x + i + 12), _mm_loadu_ps(y + i + 12)));
+    }
+    for (; i + 4 <= n; i += 4) {
+        s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(y + i)));
+    }
+    s0 = _mm_add_ps(_mm_add_ps(s0, s1), _mm_add_ps(s2, s3));
+    s0 = _mm_add_ps(s0, _mm_movehl_ps(s0, s0));
+    s0 = _mm_add_ss(s0, _mm_shuffle_ps(s0, s0, 1));
+    float s = _mm_cvtss_f32(s0);
+    for (; i < n; i++) {
+        s += x[i] * y[i];
+    }
+    return s;
+}
+
+__attribute__((target("sse2")))
+static double dot_sse2_f64(const double *x, const double *y, size_t n) {
+    __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd(), s2 = _mm_setzero_pd(), s3 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+        s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(x + i + 2), _mm_loadu_pd(y + i + 2)));
+        s2 = _mm_add_pd(s2, _mm_mul_pd(_mm_loadu_pd(x + i + 4), _mm_loadu_pd(y + i + 4)));
+        s3 = _mm_add_pd(s3, _mm_mul_pd(_mm_loadu_pd(x + i + 6), _mm_loadu_pd(y + i + 6)));
+    }
+    for (; i + 2 <= n; i += 2) {
+        s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+    }
+    s0 = _mm_add_pd(_mm_add_pd(s0, s1), _mm_add_pd(s2, s3));
+    s0 = _mm_add_sd(s0, _mm_unpackhi_pd(s0, s0));
+    double s = _mm_cvtsd_f64(s0);
+    for (; i < n; i++) {
+        s += x[i] * y[i];
+    }
+    return s;
+}
+
+__attribute__((target("sse2")))
+static void add_sse2_f32(float *y, const float *x, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_loadu_ps(x + i)));
+        _mm_storeu_ps(y + i + 4, _mm_add_ps(_mm_loadu_ps(y + i + 4), _mm_loadu_ps(x + i + 4)));
+    }
+    for (; i < n; i++) {
+        y[i] += x[i];
+    }
+}
+
+__attribute__((target("sse2")))
+static void add_sse2_f64(double *y, const double *x, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_loadu_pd(x + i)));
+        _mm_storeu_pd(y + i + 2, _mm_add_pd(_mm_loadu_pd(y + i + 2), _mm_loadu_pd(x + i + 2)));
+    }
+    for (; i < n; i++) {
+        y[i] += x[i];
+    }
+}
+
+__attribute__((target("sse2")))
+static void copy_sse2(void *dst, const void *src, size_t bytes, int stream) {
+    char *d = dst;
+    const char *s = src;
+    if (stream) {
+        size_t head = head_bytes(d, 16, bytes);
+        memcpy(d, s, head);
+        d += head; s += head; bytes -= head;
+        for (; bytes >= 64; d += 64, s += 64, bytes -= 64) {
+            _mm_stream_si128((__m128i *)d, _mm_loadu_si128((const __m128i *)s));
+            _mm_stream_si128((__m128i *)(d + 16), _mm_loadu_si128((const __m128i *)(s + 16)));
+            _mm_stream_si128((__m128i *)(d + 32), _mm_loadu_si128((const __m128i *)(s + 32)));
+            _mm_stream_si128((__m128i *)(d + 48), _mm_loadu_si128((const __m128i *)(s + 48)));
+        }
+        _mm_sfence();
+    } else {
+        for (; bytes >= 64; d += 64, s += 64, bytes -= 64) {
+            _mm_storeu_si128((__m128i *)d, _mm_loadu_si128((const __m128i *)s));
+            _mm_storeu_si128((__m128i *)(d + 16), _mm_loadu_si128((const __m128i *)(s + 16)));
+            _mm_storeu_si128((__m128i *)(d + 32), _mm_loadu_si128((const __m128i *)(s + 32)));
+            _mm_storeu_si128((__m128i *)(d + 48), _mm_loadu_si128((const __m128i *)(s + 48)));
+        }
+    }
+    memcpy(d, s, bytes);
+}
+
+__attribute__((target("sse2")))
+static void zero_sse2(void *dst, size_t bytes, int stream) {
+    char *d = dst;
+    const __m128i z = _mm_setzero_si128();
+    if (stream) {
+        size_t head = head_bytes(d, 16, bytes);
+        memset(d, 0, head);
+        d += head; bytes -= head;
+        for (; bytes >= 64; d += 64, bytes -= 64) {
+            _mm_stream_si128((__m128i *)d, z);
+            _mm_stream_si128((__m128i *)(d + 16), z);
+            _mm_stream_si128((__m128i *)(d + 32), z);
+            _mm_stream_si128((__m128i *)(d + 48), z);
+        }
+        _mm_sfence();
+    } else {
+        for (; bytes >= 64; d += 64, bytes -= 64) {
+            _mm_storeu_si128((__m128i *)d, z);
+            _mm_storeu_si128((__m128i *)(d + 16), z);
+            _mm_storeu_si128((__m128i *)(d + 32), z);
+            _mm_storeu_si128((__m128i *)(d + 48), z);
+        }
+    }
+    memset(d, 0, bytes);
+}
+
+__attribute__((target("sse2")))
+static void tr_sse2_f32(float *dst, size_t ldd, const float *src, size_t lds, int rows, int cols) {
+    const int r0 = rows & ~3, c0 = cols & ~3;
+    for (int i = 0; i < r0; i += 4) {
+        for (int j = 0; j < c0; j += 4) {
+            const float *s = src + i * lds + j;
+            float *d = dst + j * ldd + i;
+            __m128 a = _mm_loadu_ps(s), b = _mm_loadu_ps(s + lds);
+            __m128 c = _mm_loadu_ps(s + 2 * lds), e = _mm_loadu_ps(s + 3 * lds);
+            _MM_TRANSPOSE4_PS(a, b, c, e);
+            _mm_storeu_ps(d, a);
+            _mm_storeu_ps(d + ldd, b);
+            _mm_storeu_ps(d + 2 * ldd, c);
+            _mm_storeu_ps(d + 3 * ldd, e);
+        }
+    }
+    tr_fringe_f32(dst, ldd, src, lds, rows, cols, r0, c0);
+}
+
+__attribute__((target("sse2")))
+static void tr_sse2_f64(double *dst, size_t ldd, const double *src, size_t lds, int rows, int cols) {
+    const int r0 = rows & ~1, c0 = cols & ~1;
+    for (int i = 0; i < r0; i += 2) {
+        for (int j = 0; j < c0; j += 2) {
+            const double *s = src + i * lds + j;
+            double *d = dst + j * ldd + i;
+            __m128d a = _mm_loadu_pd(s), b = _mm_loadu_pd(s + lds);
+            _mm_storeu_pd(d, _mm_unpacklo_pd(a, b));
+            _mm_storeu_pd(d + ldd, _mm_unpackhi_pd(a, b));
+        }
+    }
+    tr_fringe_f64(dst, ldd, src, lds, rows, cols, r0, c0);
+}
+
+/* ----------------------------------------------------------------
+   AVX2 + FMA
+   ---------------------------------------------------------------- */
+
+/**
+ * @brief Sliding window for AVX2 tail masks: loading 8 lanes at offset 8-r enables the first r lanes.
+ */
+static const int32_t mask_window32[16] = { -1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0 };
+static const int64_t mask_window64[8] = { -1, -1, -1, -1, 0, 0, 0, 0 };
+
+__attribute__((target("avx2,fma")))
+static inline float hsum_avx2_f32(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+__attribute__((target("avx2,fma")))
+static inline double hsum_avx2_f64(__m256d v) {
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    s = _mm_add_sd(s, _mm_unpackhi_pd(s, s));
+    return _mm_cvtsd_f64(s);
+}
+
+__attribute__((target("avx2,fma")))
+static float dot_avx2_f32(const float *x, const float *y, size_t n) {
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps(), s2 = _mm256_setzero_ps(), s3 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        s0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), s0);
+        s1 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(y + i + 8), s1);
+        s2 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 16), _mm256_loadu_ps(y + i + 16), s2);
+        s3 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 24), _mm256_loadu_ps(y + i + 24), s3);
+    }
+    for (; i + 8 <= n; i += 8) {
+        s0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), s0);
+    }
+    if (i < n) {
+        __m256i m = _mm256_loadu_si256((const __m256i *)(mask_window32 + 8 - (n - i)));
+        s1 = _mm256_fmadd_ps(_mm256_maskload_ps(x + i, m), _mm256_maskload_ps(y + i, m), s1);
+    }
+    return hsum_avx2_f32(_mm256_add_ps(_mm256_add_ps(s0, s1), _mm256_add_ps(s2, s3)));
+}
+
+__attribute__((target("avx2,fma")))
+static double dot_avx2_f64(const double *x, const double *y, size_t n) {
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd(), s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), s0);
+        s1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4), s1);
+        s2 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 8), _mm256_loadu_pd(y + i + 8), s2);
+        s3 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 12), _mm256_loadu_pd(y + i + 12), s3);
+    }
+    for (; i + 4 <= n; i += 4) {
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), s0);
+    }
+    if (i < n) {
+        __m256i m = _mm256_loadu_si256((const __m256i *)(mask_window64 + 4 - (n - i)));
+        s1 = _mm256_fmadd_pd(_mm256_maskload_pd(x + i, m), _mm256_maskload_pd(y + i, m), s1);
+    }
+    return hsum_avx2_f64(_mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3)));
+}
+
+__attribute__((target("avx2,fma")))
+static void add_avx2_f32(float *y, const float *x, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_loadu_ps(x + i)));
+        _mm256_storeu_ps(y + i + 8, _mm256_add_ps(_mm256_loadu_ps(y + i + 8), _mm256_loadu_ps(x + i + 8)));
+    }
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_loadu_ps(x + i)));
+    }
+    if (i < n) {
+        __m256i m = _mm256_loadu_si256((const __m256i *)(mask_window32 + 8 - (n - i)));
+        _mm256_maskstore_ps(y + i, m, _mm256_add_ps(_mm256_maskload_ps(y + i, m), _mm256_maskload_ps(x + i, m)));
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void add_avx2_f64(double *y, const double *x, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_loadu_pd(y + i), _mm256_loadu_pd(x + i)));
+        _mm256_storeu_pd(y + i + 4, _mm256_add_pd(_mm256_loadu_pd(y + i + 4), _mm256_loadu_pd(x + i + 4)));
+    }
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_loadu_pd(y + i), _mm256_loadu_pd(x + i)));
+    }
+    if (i < n) {
+        __m256i m = _mm256_loadu_si256((const __m256i *)(mask_window64 + 4 - (n - i)));
+        _mm256_maskstore_pd(y + i, m, _mm256_add_pd(_mm256_maskload_pd(y + i, m), _mm256_maskload_pd(x + i, m)));
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void copy_avx2(void *dst, const void *src, size_t bytes, int stream) {
+    char *d = dst;
+    const char *s = src;
+    if (stream) {
+        size_t head = head_bytes(d, 32, bytes);
+        memcpy(d, s, head);
+        d += head; s += head; bytes -= head;
+        for (; bytes >= 128; d += 128, s += 128, bytes -= 128) {
+            _mm256_stream_si256((__m256i *)d, _mm256_loadu_si256((const __m256i *)s));
+            _mm256_stream_si256((__m256i *)(d + 32), _mm256_loadu_si256((const __m256i *)(s + 32)));
+            _mm256_stream_si256((__m256i *)(d + 64), _mm256_loadu_si256((const __m256i *)(s + 64)));
+            _mm256_stream_si256((__m256i *)(d + 96), _mm256_loadu_si256((const __m256i *)(s + 96)));
+        }
+        _mm_sfence();
+    } else {
+        for (; bytes >= 128; d += 128, s += 128, bytes -= 128) {
+            _mm256_storeu_si256((__m256i *)d, _mm256_loadu_si256((const __m256i *)s));
+            _mm256_storeu_si256((__m256i *)(d + 32), _mm256_loadu_si256((const __m256i *)(s + 32)));
+            _mm256_storeu_si256((__m256i *)(d + 64), _mm256_loadu_si256((const __m256i *)(s + 64)));
+            _mm256_storeu_si256((__m256i *)(d + 96), _mm256_loadu_si256((const __m256i *)(s + 96)));
+        }
+    }
+    for (; bytes >= 32; d += 32, s += 32, bytes -= 32) {
+        _mm256_storeu_si256((__m256i *)d, _mm256_loadu_si256((const __m256i *)s));
+    }
+    memcpy(d, s, bytes);
+}
+
+__attribute__((target("avx2,fma")))
+static void zero_avx2(void *dst, size_t bytes, int stream) {
+    char *d = dst;
+    const __m256i z = _mm256_setzero_si256();
+    if (stream) {
+        size_t head = head_bytes(d, 32, bytes);
+        memset(d, 0, head);
+        d += head; bytes -= head;
+        for (; bytes >= 128; d += 128, bytes -= 128) {
+            _mm256_stream_si256((__m256i *)d, z);
+            _mm256_stream_si256((__m256i *)(d + 32), z);
+            _mm256_stream_si256((__m256i *)(d + 64), z);
+            _mm256_stream_si256((__m256i *)(d + 96), z);
+        }
+        _mm_sfence();
+    } else {
+        for (; bytes >= 128; d += 128, bytes -= 128) {
+            _mm256_storeu_si256((__m256i *)d, z);
+            _mm256_storeu_si256((__m256i *)(d + 32), z);
+            _mm256_storeu_si256((__m256i *)(d + 64), z);
+            _mm256_storeu_si256((__m256i *)(d + 96), z);
+        }
+    }
+    for (; bytes >= 32; d += 32, bytes -= 32) {
+        _mm256_storeu_si256((__m256i *)d, z);
+    }
+    memset(d, 0, bytes);
+}
+
+__attribute__((target("avx2,fma")))
+static void tr_avx2_f32(float *dst, size_t ldd, const float *src, size_t lds, int rows, int cols) {
+    const int r0 = rows & ~7, c0 = cols & ~7;
+    for (int i = 0; i < r0; i += 8) {
+        for (int j = 0; j < c0; j += 8) {
+            const float *s = src + i * lds + j;
+            float *d = dst + j * ldd + i;
+            __m256 r[8], t[8];
+            for (int k = 0; k < 8; k++) {
+                r[k] = _mm256_loadu_ps(s + k * lds);
+            }
+            for (int k = 0; k < 8; k += 2) {
+                t[k] = _mm256_unpacklo_ps(r[k], r[k + 1]);
+                t[k + 1] = _mm256_unpackhi_ps(r[k], r[k + 1]);
+            }
+            for (int k = 0; k < 8; k += 4) {
+                r[k] = _mm256_shuffle_ps(t[k], t[k + 2], _MM_SHUFFLE(1, 0, 1, 0));
+                r[k + 1] = _mm256_shuffle_ps(t[k], t[k + 2], _MM_SHUFFLE(3, 2, 3, 2));
+                r[k + 2] = _mm256_shuffle_ps(t[k + 1], t[k + 3], _MM_SHUFFLE(1, 0, 1, 0));
+                r[k + 3] = _mm256_shuffle_ps(t[k + 1], t[k + 3], _MM_SHUFFLE(3, 2, 3, 2));
+            }
+            for (int k = 0; k < 4; k++) {
+                _mm256_storeu_ps(d + k * ldd, _mm256_permute2f128_ps(r[k], r[k + 4], 0x20));
+                _mm256_storeu_ps(d + (k + 4) * ldd, _mm256_permute2f128_ps(r[k], r[k + 4], 0x31));
+            }
+        }
+    }
+    tr_fringe_f32(dst, ldd, src, lds, rows, cols, r0, c0);
+}
+
+__attribute__((target("avx2,fma")))
+static void tr_avx2_f64(double *dst, size_t ldd, const double *src, size_t lds, int rows, int cols) {
+    const int r0 = rows & ~3, c0 = cols & ~3;
+    for (int i = 0; i < r0; i += 4) {
+        for (int j = 0; j < c0; j += 4) {
+            const double *s = src + i * lds + j;
+            double *d = dst + j * ldd + i;
+            __m256d a = _mm256_loadu_pd(s), b = _mm256_loadu_pd(s + lds);
+            __m256d c = _mm256_loadu_pd(s + 2 * lds), e = _mm256_loadu_pd(s + 3 * lds);
+            __m256d t0 = _mm256_unpacklo_pd(a, b), t1 = _mm256_unpackhi_pd(a, b);
+            __m256d t2 = _mm256_unpacklo_pd(c, e), t3 = _mm256_unpackhi_pd(c, e);
+            _mm256_storeu_pd(d, _mm256_permute2f128_pd(t0, t2, 0x20));
+            _mm256_storeu_pd(d + ldd, _mm256_permute2f128_pd(t1, t3, 0x20));
+            _mm256_storeu_pd(d + 2 * ldd, _mm256_permute2f128_pd(t0, t2, 0x31));
+            _mm256_storeu_pd(d + 3 * ldd, _mm256_permute2f128_pd(t1, t3, 0x31));
+        }
+    }
+    tr_fringe_f64(dst, ldd, src, lds, rows, cols, r0, c0);
+}
+
+/* ----------------------------------------------------------------
+   AVX-512
+   ---------------------------------------------------------------- */
+
+__attribute__((target("avx512f")))
+static float dot_avx512_f32(const float *x, const float *y, size_t n) {
+    __m512 s0 = _mm512_setzero_ps(), s1 = _mm512_setzero_ps(), s2 = _mm512_setzero_ps(), s3 = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        s0 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i), s0);
+        s1 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i + 16), _mm512_loadu_ps(y + i + 16), s1);
+        s2 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i + 32), _mm512_loadu_ps(y + i + 32), s2);
+        s3 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i + 48), _mm512_loadu_ps(y + i + 48), s3);
+    }
+    for (; i + 16 <= n; i += 16) {
+        s0 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i), s0);
+    }
+    if (i < n) {
+        __mmask16 k = (__mmask16)((1u << (n - i)) - 1);
+        s1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(k, x + i), _mm512_maskz_loadu_ps(k, y + i), s1);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(_mm512_add_ps(s0, s1), _mm512_add_ps(s2, s3)));
+}
+
+__attribute__((target("avx512f")))
+static double dot_avx512_f64(const double *x, const double *y, size_t n) {
+    __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd(), s2 = _mm512_setzero_pd(), s3 = _mm512_setzero_pd();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        s0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), s0);
+        s1 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8), s1);
+        s2 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 16), _mm512_loadu_pd(y + i + 16), s2);
+        s3 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 24), _mm512_loadu_pd(y + i + 24), s3);
+    }
+    for (; i + 8 <= n; i += 8) {
+        s0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), s0);
+    }
+    if (i < n) {
+        __mmask8 k = (__mmask8)((1u << (n - i)) - 1);
+        s1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(k, x + i), _mm512_maskz_loadu_pd(k, y + i), s1);
+    }
+    return _mm512_reduce_add_pd(_mm512_add_pd(_mm512_add_pd(s0, s1), _mm512_add_pd(s2, s3)));
+}
+
+__attribute__((target("avx512f")))
+static void add_avx512_f32(float *y, const float *x, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        _mm512_storeu_ps(y + i, _mm512_add_ps(_mm512_loadu_ps(y + i), _mm512_loadu_ps(x + i)));
+        _mm512_storeu_ps(y + i + 16, _mm512_add_ps(_mm512_loadu_ps(y + i + 16), _mm512_loadu_ps(x + i + 16)));
+    }
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(y + i, _mm512_add_ps(_mm512_loadu_ps(y + i), _mm512_loadu_ps(x + i)));
+    }
+    if (i < n) {
+        __mmask16 k = (__mmask16)((1u << (n - i)) - 1);
+        _mm512_mask_storeu_ps(y + i, k, _mm512_add_ps(_mm512_maskz_loadu_ps(k, y + i), _mm512_maskz_loadu_ps(k, x + i)));
+    }
+}
+
+__attribute__((target("avx512f")))
+static void add_avx512_f64(double *y, const double *x, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_pd(y + i, _mm512_add_pd(_mm512_loadu_pd(y + i), _mm512_loadu_pd(x + i)));
+        _mm512_storeu_pd(y + i + 8, _mm512_add_pd(_mm512_loadu_pd(y + i + 8), _mm512_loadu_pd(x + i + 8)));
+    }
+    for (; i + 8 <= n; i += 8) {
+        _mm512_storeu_pd(y + i, _mm512_add_pd(_mm512_loadu_pd(y + i), _mm512_loadu_pd(x + i)));
+    }
+    if (i < n) {
+        __mmask8 k = (__mmask8)((1u << (n - i)) - 1);
+        _mm512_mask_storeu_pd(y + i, k, _mm512_add_pd(_mm512_maskz_loadu_pd(k, y + i), _mm512_maskz_loadu_pd(k, x + i)));
+    }
+}
+
+__attribute__((target("avx512f")))
+static void copy_avx512(void *dst, const void *src, size_t bytes, int stream) {
+    char *d = dst;
+    const char *s = src;
+    if (stream) {
+        size_t head = head_bytes(d, 64, bytes);
+        memcpy(d, s, head);
+        d += head; s += head; bytes -= head;
+        for (; bytes >= 256; d += 256, s += 256, bytes -= 256) {
+            _mm512_stream_si512((void *)d, _mm512_loadu_si512(s));
+            _mm512_stream_si512((void *)(d + 64), _mm512_loadu_si512(s + 64));
+            _mm512_stream_si512((void *)(d + 128), _mm512_loadu_si512(s + 128));
+            _mm512_stream_si512((void *)(d + 192), _mm512_loadu_si512(s + 192));
+        }
+        _mm_sfence();
+    } else {
+        for (; bytes >= 256; d += 256, s += 256, bytes -= 256) {
+            _mm512_storeu_si512(d, _mm512_loadu_si512(s));
+            _mm512_storeu_si512(d + 64, _mm512_loadu_si512(s + 64));
+            _mm512_storeu_si512(d + 128, _mm512_loadu_si512(s + 128));
+            _mm512_storeu_si512(d + 192, _mm512_loadu_si512(s + 192));
+        }
+    }
+    for (; bytes >= 64; d += 64, s += 64, bytes -= 64) {
+        _mm512_storeu_si512(d, _mm512_loadu_si512(s));
+    }
+    memcpy(d, s, bytes);
+}
+
+__attribute__((target("avx512f")))
+static void zero_avx512(void *dst, size_t bytes, int stream) {
+    char *d = dst;
+    const __m512i z = _mm512_setzero_si512();
+    if (stream) {
+        size_t head = head_bytes(d, 64, bytes);
+        memset(d, 0, head);
+        d += head; bytes -= head;
+        for (; bytes >= 256; d += 256, bytes -= 256) {
+            _mm512_stream_si512((void *)d, z);
+            _mm512_stream_si512((void *)(d + 64), z);
+            _mm512_stream_si512((void *)(d + 128), z);
+            _mm512_stream_si512((void *)(d + 192), z);
+        }
+        _mm_sfence();
+    } else {
+        for (; bytes >= 256; d += 256, bytes -= 256) {
+            _mm512_storeu_si512(d, z);
+            _mm512_storeu_si512(d + 64, z);
+            _mm512_storeu_si512(d + 128, z);
+            _mm512_storeu_si512(d + 192, z);
+        }
+    }
+    for (; bytes >= 64; d += 64, bytes -= 64) {
+        _mm512_storeu_si512(d, z);
+    }
+    memset(d, 0, bytes);
+}
+
+/* ----------------------------------------------------------------
+   Dispatch
+   ---------------------------------------------------------------- */
+
+/* The AVX-512 entry reuses the 8x8/4x4 AVX2 transposes: a 16x16 in-register transpose
+   needs 64 shuffles for the same 256-byte tile and is bound by the same stores. It
+   therefore also needs what those are compiled for (supported()). */
+static const simd_ops variants[] = {
+    { "avx512", dot_avx512_f32, dot_avx512_f64, add_avx512_f32, add_avx512_f64, copy_avx512, zero_avx512, tr_avx2_f32,   tr_avx2_f64 },
+    { "avx2",   dot_avx2_f32,   dot_avx2_f64,   add_avx2_f32,   add_avx2_f64,   copy_avx2,   zero_avx2,   tr_avx2_f32,   tr_avx2_f64 },
+    { "sse2",   dot_sse2_f32,   dot_sse2_f64,   add_sse2_f32,   add_sse2_f64,   copy_sse2,   zero_sse2,   tr_sse2_f32,   tr_sse2_f64 },
+    { "scalar", dot_scalar_f32, dot_scalar_f64, add_scalar_f32, add_scalar_f64, copy_scalar, zero_scalar, tr_scalar_f32, tr_scalar_f64 },
+};
+
+simd_ops simd = { "scalar", dot_scalar_f32, dot_scalar_f64, add_scalar_f32, add_scalar_f64, copy_scalar, zero_scalar,
+                  tr_scalar_f32, tr_scalar_f64 };
+
+/**
+ * @brief Whether the variant at @p index of variants[] runs on this CPU.
+ */
+static int supported(const cpu_features *f, int index) {
+    switch (index) {
+    case 0: return f->avx512f && f->avx2 && f->fma;
+    case 1: return f->avx2 && f->fma;
+    case 2: return f->sse2;
+    default: return 1;
+    }
+}
+
+int simd_select(const char *name) {
+    cpu_features f;
+    cpu_detect(&f);
+    for (int i = 0; i < (int)(sizeof(variants) / sizeof(variants[0])); i++) {
+        if (name && strcmp(name, variants[i].name) != 0) {
+            continue;
+        }
+        if (supported(&f, i)) {
+            simd = variants[i];
+            return 0;
+        }
+        if (name) {
+            return -1;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file simd_kernels.h
+ * @brief SSE2, AVX2/FMA and AVX-512 vector primitives selected once at startup via CPUID.
+ */
+
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+#include <stddef.h>
+
+#ifndef SIMD_STREAM_BYTES
+#define SIMD_STREAM_BYTES (8u << 20) /**< Buffers larger than this are written with non-temporal stores */
+#endif
+
+/**
+ * @brief Table of vector primitives for one instruction set.
+ *
+ * dot/add are provided for float and double; copy and zero work on raw bytes and
+ * serve every element type. With @p stream set, copy/zero bypass the caches with
+ * non-temporal stores (for buffers that will not be reread before eviction).
+ * tr_f32/tr_f64 write the transpose of a rows x cols block of src (row stride lds)
+ * into dst (row stride ldd) using in-register 4x4/8x8 (float) or 2x2/4x4 (double) tiles.
+ */
+typedef struct {
+    const char *name; /**< Variant name: "scalar", "sse2", "avx2" or "avx512" */
+    float (*dot_f32)(const float *x, const float *y, size_t n);
+    double (*dot_f64)(const double *x, const double *y, size_t n);
+    void (*add_f32)(float *y, const float *x, size_t n);
+    void (*add_f64)(double *y, const double *x, size_t n);
+    void (*copy)(void *dst, const void *src, size_t bytes, int stream);
+    void (*zero)(void *dst, size_t bytes, int stream);
+    void (*tr_f32)(float *dst, size_t ldd, const float *src, size_t lds, int rows, int cols);
+    void (*tr_f64)(double *dst, size_t ldd, const double *src, size_t lds, int rows, int cols);
+} simd_ops;
+
+/**
+ * @brief The selected primitives; valid after simd_select().
+ */
+extern simd_ops simd;
+
+/**
+ * @brief Selects the primitives for this CPU.
+ * @param name Variant to force ("scalar", "sse2", "avx2", "avx512"), or NULL for the best supported one.
+ * @return 0 on success, -1 if the variant is unknown or not supported by this CPU (the selection is unchanged).
+ */
+int simd_select(const char *name);
+
+#endif /* SIMD_KERNELS_H */
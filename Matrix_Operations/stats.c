@@ -0,0 +1,176 @@
+/**
+ * @file stats.c
+ * @brief Implementation of the sample statistics used by the benchmark runner.
+ */
+
+#include "stats.h"
+#include "tsc.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+int stats_parse_filter(const char *name) {
+    if (strcmp(name, "none") == 0) return FILTER_NONE;
+    if (strcmp(name, "mad") == 0) return FILTER_MAD;
+    if (strcmp(name, "iqr") == 0) return FILTER_IQR;
+    return -1;
+}
+
+const char *stats_filter_name(int filter) {
+    return filter == FILTER_MAD ? "mad" : filter == FILTER_IQR ? "iqr" : "none";
+}
+
+static int cmp_double(const void *x, const void *y) {
+    double a = *(const double *)x, b = *(const double *)y;
+    return (a < b) ? -1 : (a > b);
+}
+
+static double median_sorted(const double *x, int n) {
+    return (n % 2) ? x[n / 2] : 0.5 * (x[n / 2 - 1] + x[n / 2]);
+}
+
+/**
+ * @brief Quantile @p q of sorted samples, interpolated between order statistics.
+ */
+static double quantile_sorted(const double *x, int n, double q) {
+    double pos = q * (n - 1);
+    int i = (int)pos;
+    return i + 1 < n ? x[i] + (pos - i) * (x[i + 1] - x[i]) : x[n - 1];
+}
+
+/**
+ * @brief xorshift64* generator (the bootstrap only needs speed and reproducibility).
+ */
+static unsigned long long next_random(unsigned long long *s) {
+    *s ^= *s >> 12;
+    *s ^= *s << 25;
+    *s ^= *s >> 27;
+    return *s * 0x2545F4914F6CDD1Dull;
+}
+
+/**
+ * @brief Percentile bootstrap interval of the median of @p n sorted samples.
+ *
+ * A resample only needs how often each index is drawn: walking those counts in
+ * order finds its median in O(n), without sorting it.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int bootstrap_median(const double *sorted, int n, double *lo, double *hi) {
+    int *counts = malloc((size_t)n * sizeof(int));
+    double *medians = malloc(STATS_BOOTSTRAP * sizeof(double));
+    unsigned long long seed = 0x9E3779B97F4A7C15ull;
+    const int rank_lo = (n - 1) / 2, rank_hi = n / 2;
+
+    if (!counts || !medians) {
+        free(counts);
+        free(medians);
+        return -1;
+    }
+    for (int b = 0; b < STATS_BOOTSTRAP; b++) {
+        memset(counts, 0, (size_t)n * sizeof(int));
+        for (int i = 0; i < n; i++) {
+            counts[next_random(&seed) % (unsigned long long)n]++;
+        }
+        double a = sorted[0], c = sorted[0];
+        for (int i = 0, below = 0; i < n; i++) {
+            int next = below + counts[i];
+            if (below <= rank_lo && rank_lo < next) a = sorted[i];
+            if (below <= rank_hi && rank_hi < next) {
+                c = sorted[i];
+                break;
+            }
+            below = next;
+        }
+        medians[b] = 0.5 * (a + c);
+    }
+    qsort(medians, STATS_BOOTSTRAP, sizeof(double), cmp_double);
+    *lo = quantile_sorted(medians, STATS_BOOTSTRAP, 0.5 * (1.0 - STATS_CI_LEVEL));
+    *hi = quantile_sorted(medians, STATS_BOOTSTRAP, 0.5 * (1.0 + STATS_CI_LEVEL));
+    free(counts);
+    free(medians);
+    return 0;
+}
+
+/**
+ * @brief Sarle's bimodality coefficient with the sample-size corrected skewness and excess kurtosis.
+ */
+static double bimodality_coefficient(const double *x, int n) {
+    if (n < 4) {
+        return 0.0;
+    }
+    double mean = 0.0, m2 = 0.0, m3 = 0.0, m4 = 0.0;
+    for (int i = 0; i < n; i++) {
+        mean += x[i];
+    }
+    mean /= n;
+    for (int i = 0; i < n; i++) {
+        double d = x[i] - mean, d2 = d * d;
+        m2 += d2;
+        m3 += d2 * d;
+        m4 += d2 * d2;
+    }
+    m2 /= n;
+    m3 /= n;
+    m4 /= n;
+    if (m2 <= 0.0) {
+        return 0.0;
+    }
+    double g1 = m3 / pow(m2, 1.5), g2 = m4 / (m2 * m2) - 3.0;
+    double skew = sqrt((double)n * (n - 1)) / (n - 2) * g1;
+    double kurt = (double)(n - 1) / ((double)(n - 2) * (n - 3)) * ((n + 1) * g2 + 6.0);
+    return (skew * skew + 1.0) / (kurt + 3.0 * (n - 1.0) * (n - 1.0) / ((n - 2.0) * (n - 3.0)));
+}
+
+int stats_compute(const double *samples, int n, int filter, bench_stats *st) {
+    double *sorted = malloc((size_t)n * sizeof(double));
+    double *dev = malloc((size_t)n * sizeof(double));
+
+    memset(st, 0, sizeof(*st));
+    st->reps = st->kept = n;
+    if (!sorted || !dev) {
+        free(sorted);
+        free(dev);
+        st->min = st->median = st->ci_lo = st->ci_hi = st->tmean = samples[0];
+        return -1;
+    }
+    memcpy(sorted, samples, (size_t)n * sizeof(double));
+    qsort(sorted, n, sizeof(double), cmp_double);
+    st->min = sorted[0];
+
+    double med = median_sorted(sorted, n);
+    for (int i = 0; i < n; i++) {
+        dev[i] = fabs(sorted[i] - med);
+    }
+    qsort(dev, n, sizeof(double), cmp_double);
+    st->mad = median_sorted(dev, n);
+
+    double q1 = quantile_sorted(sorted, n, 0.25), q3 = quantile_sorted(sorted, n, 0.75);
+    double lo = sorted[0], hi = sorted[n - 1];
+    if (filter == FILTER_MAD && st->mad > 0.0) {
+        lo = med - STATS_MAD_K * 1.4826 * st->mad;
+        hi = med + STATS_MAD_K * 1.4826 * st->mad;
+    } else if (filter != FILTER_NONE && q3 > q1) {
+        lo = q1 - 1.5 * (q3 - q1);
+        hi = q3 + 1.5 * (q3 - q1);
+    }
+    int first = 0, last = n;
+    while (first < n && sorted[first] < lo) first++;
+    while (last > first && sorted[last - 1] > hi) last--;
+
+    const double *kept = sorted + first;
+    st->kept = last - first;
+    st->median = median_sorted(kept, st->kept);
+    st->bimodality = bimodality_coefficient(kept, st->kept);
+    st->bimodal = st->bimodality > 5.0 / 9.0;
+    if (bootstrap_median(kept, st->kept, &st->ci_lo, &st->ci_hi) != 0) {
+        st->ci_lo = st->ci_hi = st->median;
+    }
+    st->tmean = tmean(sorted + first, st->kept);
+    free(sorted);
+    free(dev);
+    return 0;
+}
+
+double stats_ci_rel_width(const bench_stats *st) {
+    return st->median != 0.0 ? (st->ci_hi - st->ci_lo) / fabs(st->median) : 0.0;
+}
@@ -0,0 +1,75 @@
+/**
+ * @file stats.h
+ * @brief Robust statistics of timing samples: outlier filters, bootstrap confidence interval
+ *        of the median and a bimodality test.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#ifndef STATS_BOOTSTRAP
+#define STATS_BOOTSTRAP 1000 /**< Bootstrap resamples of the median */
+#endif
+
+#ifndef STATS_CI_LEVEL
+#define STATS_CI_LEVEL 0.95 /**< Coverage of the median's confidence interval */
+#endif
+
+#ifndef STATS_MAD_K
+#define STATS_MAD_K 3.5 /**< Samples further than STATS_MAD_K robust deviations from the median are outliers */
+#endif
+
+/**
+ * @brief Outlier filter applied before the median, its interval and the trimmed mean.
+ */
+typedef enum {
+    FILTER_NONE = 0, /**< Keep every sample */
+    FILTER_MAD = 1,  /**< |x - median| <= STATS_MAD_K * 1.4826 * MAD (falls back to the IQR when MAD = 0) */
+    FILTER_IQR = 2   /**< Tukey fences: [Q1 - 1.5 IQR, Q3 + 1.5 IQR] */
+} outlier_filter;
+
+/**
+ * @brief Statistics of the timed repetitions of one kernel, in cycles per run
+ *        (overhead-corrected by dtime(); see cycles_to_ns() for wall time).
+ *
+ * min and mad are taken over all samples; median, its interval, tmean and the bimodality
+ * over the samples kept by the filter.
+ */
+typedef struct {
+    int reps;          /**< Samples taken */
+    int kept;          /**< Samples left by the outlier filter */
+    double min;
+    double median;
+    double ci_lo;      /**< Lower bound of the median's bootstrap interval (STATS_CI_LEVEL) */
+    double ci_hi;      /**< Upper bound of the same interval */
+    double tmean;      /**< Trimmed mean (tmean() from tsc.c) */
+    double mad;        /**< Median absolute deviation */
+    double bimodality; /**< Sarle's bimodality coefficient (0 with fewer than 4 samples) */
+    int bimodal;       /**< 1 if bimodality exceeds 5/9, the value of a uniform distribution */
+} bench_stats;
+
+/**
+ * @brief Parses "none", "mad" or "iqr".
+ * @return The outlier_filter, or -1 if unknown.
+ */
+int stats_parse_filter(const char *name);
+
+/**
+ * @brief Name of an outlier_filter.
+ */
+const char *stats_filter_name(int filter);
+
+/**
+ * @brief Computes the statistics of @p n > 0 samples (left unchanged).
+ *
+ * The bootstrap uses a fixed seed, so equal samples give equal intervals.
+ * @return 0 on success, -1 on allocation failure (only min, median and tmean are set, unfiltered).
+ */
+int stats_compute(const double *samples, int n, int filter, bench_stats *st);
+
+/**
+ * @brief Width of the median's interval relative to the median (0 if the median is 0).
+ */
+double stats_ci_rel_width(const bench_stats *st);
+
+#endif /* STATS_H */
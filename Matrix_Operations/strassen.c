@@ -0,0 +1,177 @@
+/**
+ * @file strassen.c
+ * @brief Implementation of the Strassen-Winograd multiplication.
+ *
+ * Schedule of one level (Douglas et al., GEMMW), with X and Y the only temporaries:
+ *   X = A11 - A21, Y = B22 - B12, C21 = X Y          (M7)
+ *   X = A21 + A22, Y = B12 - B11, C22 = X Y          (M5)
+ *   X = X - A11,   Y = B22 - Y,   C12 = X Y          (M6)
+ *   X = A12 - X,   C11 = X B22                       (M3)
+ *   X = A11 B11                                      (M1)
+ *   C12 += X, C21 += C12, C12 += C22, C22 += C21, C12 += C11
+ *   Y = Y - B21,   C11 = A22 Y, C21 -= C11           (M4)
+ *   C11 = A12 B21, C11 += X                          (M2 + M1)
+ */
+
+#include "strassen.h"
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief Arena allocations are rounded to whole cache lines to keep every block aligned. */
+#define ARENA_ROUND (MATRIX_ALIGN / sizeof(TYPE) > 0 ? MATRIX_ALIGN / sizeof(TYPE) : 1)
+
+static size_t round_elems(size_t count) {
+    return (count + ARENA_ROUND - 1) / ARENA_ROUND * ARENA_ROUND;
+}
+
+static TYPE *arena_alloc(strassen_arena *arena, size_t count) {
+    TYPE *p = arena->base + arena->top;
+    arena->top += round_elems(count);
+    return p;
+}
+
+void strassen_plan_init(strassen_plan *plan, int n, int crossover) {
+    if (crossover < 1) {
+        crossover = 1;
+    }
+    plan->n = n;
+    plan->levels = 0;
+    while ((n + (1 << plan->levels) - 1) >> plan->levels > crossover) {
+        plan->levels++;
+    }
+    int leaf = (n + (1 << plan->levels) - 1) >> plan->levels;
+    plan->padded = leaf << plan->levels;
+
+    plan->arena = 0;
+    if (plan->padded != n) {
+        plan->arena = 3 * round_elems((size_t)plan->padded * plan->padded);
+    }
+    for (int s = plan->padded; s > leaf; s /= 2) {
+        plan->arena += 2 * round_elems((size_t)(s / 2) * (s / 2));
+    }
+}
+
+int strassen_arena_init(strassen_arena *arena, size_t elems) {
+    void *p = NULL;
+    arena->base = NULL;
+    arena->cap = elems;
+    arena->top = 0;
+    if (elems == 0) {
+        return 0;
+    }
+    if (posix_memalign(&p, MATRIX_ALIGN, elems * sizeof(TYPE)) != 0) {
+        return -1;
+    }
+    arena->base = p;
+    return 0;
+}
+
+void strassen_arena_free(strassen_arena *arena) {
+    free(arena->base);
+    arena->base = NULL;
+    arena->cap = arena->top = 0;
+}
+
+/** @brief Z = X + Y on h x h strided blocks (Z may alias X or Y). */
+static void madd(int h, TYPE *Z, size_t ldz, const TYPE *X, size_t ldx, const TYPE *Y, size_t ldy) {
+    for (int i = 0; i < h; i++) {
+        for (int j = 0; j < h; j++) {
+            Z[i * ldz + j] = X[i * ldx + j] + Y[i * ldy + j];
+        }
+    }
+}
+
+/** @brief Z = X - Y on h x h strided blocks (Z may alias X or Y). */
+static void msub(int h, TYPE *Z, size_t ldz, const TYPE *X, size_t ldx, const TYPE *Y, size_t ldy) {
+    for (int i = 0; i < h; i++) {
+        for (int j = 0; j < h; j++) {
+            Z[i * ldz + j] = X[i * ldx + j] - Y[i * ldy + j];
+        }
+    }
+}
+
+/**
+ * @brief Parameters shared by every level of one multiplication.
+ */
+typedef struct {
+    strassen_arena *arena;
+    int crossover;
+    int bl;
+    int order;
+} sw_args;
+
+static void sw_rec(const sw_args *a, int n, const TYPE *A, size_t lda, const TYPE *B, size_t ldb,
+                   TYPE *C, size_t ldc) {
+    if (n <= a->crossover || (n & 1)) {
+        blocked_mult(n, A, lda, B, ldb, C, ldc, a->bl, a->order);
+        return;
+    }
+
+    const int h = n / 2;
+    const TYPE *A11 = A, *A12 = A + h, *A21 = A + h * lda, *A22 = A + h * lda + h;
+    const TYPE *B11 = B, *B12 = B + h, *B21 = B + h * ldb, *B22 = B + h * ldb + h;
+    TYPE *C11 = C, *C12 = C + h, *C21 = C + h * ldc, *C22 = C + h * ldc + h;
+
+    size_t mark = a->arena->top;
+    TYPE *X = arena_alloc(a->arena, (size_t)h * h);
+    TYPE *Y = arena_alloc(a->arena, (size_t)h * h);
+    const size_t ldt = h;
+
+    msub(h, X, ldt, A11, lda, A21, lda);
+    msub(h, Y, ldt, B22, ldb, B12, ldb);
+    sw_rec(a, h, X, ldt, Y, ldt, C21, ldc);            /* C21 = M7 */
+    madd(h, X, ldt, A21, lda, A22, lda);
+    msub(h, Y, ldt, B12, ldb, B11, ldb);
+    sw_rec(a, h, X, ldt, Y, ldt, C22, ldc);            /* C22 = M5 */
+    msub(h, X, ldt, X, ldt, A11, lda);
+    msub(h, Y, ldt, B22, ldb, Y, ldt);
+    sw_rec(a, h, X, ldt, Y, ldt, C12, ldc);            /* C12 = M6 */
+    msub(h, X, ldt, A12, lda, X, ldt);
+    sw_rec(a, h, X, ldt, B22, ldb, C11, ldc);          /* C11 = M3 */
+    sw_rec(a, h, A11, lda, B11, ldb, X, ldt);          /* X = M1 */
+    madd(h, C12, ldc, X, ldt, C12, ldc);               /* C12 = M1 + M6 */
+    madd(h, C21, ldc, C12, ldc, C21, ldc);             /* C21 = M1 + M6 + M7 */
+    madd(h, C12, ldc, C12, ldc, C22, ldc);             /* C12 = M1 + M6 + M5 */
+    madd(h, C22, ldc, C21, ldc, C22, ldc);             /* C22 final */
+    madd(h, C12, ldc, C12, ldc, C11, ldc);             /* C12 final */
+    msub(h, Y, ldt, Y, ldt, B21, ldb);
+    sw_rec(a, h, A22, lda, Y, ldt, C11, ldc);          /* C11 = M4 */
+    msub(h, C21, ldc, C21, ldc, C11, ldc);             /* C21 final */
+    sw_rec(a, h, A12, lda, B21, ldb, C11, ldc);        /* C11 = M2 */
+    madd(h, C11, ldc, X, ldt, C11, ldc);               /* C11 final */
+
+    a->arena->top = mark;
+}
+
+/**
+ * @brief Copies an n x n block into a zeroed p x p buffer.
+ */
+static void pad_copy(int n, int p, TYPE *dst, const TYPE *src, size_t ld) {
+    memset(dst, 0, (size_t)p * p * sizeof(TYPE));
+    for (int i = 0; i < n; i++) {
+        memcpy(dst + (size_t)i * p, src + i * ld, (size_t)n * sizeof(TYPE));
+    }
+}
+
+void strassen_mult(const strassen_plan *plan, strassen_arena *arena, int crossover, int bl, int order,
+                   const TYPE *A, size_t lda, const TYPE *B, size_t ldb, TYPE *C, size_t ldc) {
+    sw_args args = { arena, crossover, bl, order };
+    const int n = plan->n, p = plan->padded;
+
+    if (p == n) {
+        sw_rec(&args, n, A, lda, B, ldb, C, ldc);
+        return;
+    }
+
+    size_t mark = arena->top;
+    TYPE *Ap = arena_alloc(arena, (size_t)p * p);
+    TYPE *Bp = arena_alloc(arena, (size_t)p * p);
+    TYPE *Cp = arena_alloc(arena, (size_t)p * p);
+    pad_copy(n, p, Ap, A, lda);
+    pad_copy(n, p, Bp, B, ldb);
+    sw_rec(&args, p, Ap, p, Bp, p, Cp, p);
+    for (int i = 0; i < n; i++) {
+        memcpy(C + i * ldc, Cp + (size_t)i * p, (size_t)n * sizeof(TYPE));
+    }
+    arena->top = mark;
+}
@@ -0,0 +1,61 @@
+/**
+ * @file strassen.h
+ * @brief Strassen-Winograd multiplication on top of blocked_mult() with arena-allocated temporaries.
+ */
+
+#ifndef STRASSEN_H
+#define STRASSEN_H
+
+#include "matrix_ops.h"
+
+#ifndef STRASSEN_CROSSOVER
+#define STRASSEN_CROSSOVER 256 /**< Default size at or below which blocked_mult() is called instead of recursing */
+#endif
+
+/**
+ * @brief Bump allocator holding every temporary of one multiplication (no malloc inside the recursion).
+ */
+typedef struct {
+    TYPE *base; /**< MATRIX_ALIGN-aligned storage */
+    size_t cap; /**< Elements available */
+    size_t top; /**< Elements in use */
+} strassen_arena;
+
+/**
+ * @brief Recursion plan for one size: the operands are zero-padded to padded = leaf * 2^levels.
+ */
+typedef struct {
+    int n;         /**< Logical size */
+    int levels;    /**< Strassen-Winograd recursion levels */
+    int padded;    /**< Size the recursion runs on (n if no padding is needed) */
+    size_t arena;  /**< Arena elements needed (padded copies + temporaries of every level) */
+} strassen_plan;
+
+/**
+ * @brief Plans the recursion for n x n operands and a crossover size.
+ */
+void strassen_plan_init(strassen_plan *plan, int n, int crossover);
+
+/**
+ * @brief Allocates an arena of @p elems elements.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int strassen_arena_init(strassen_arena *arena, size_t elems);
+
+/**
+ * @brief Releases the arena storage.
+ */
+void strassen_arena_free(strassen_arena *arena);
+
+/**
+ * @brief C = A * B with Strassen-Winograd (7 products, 15 additions per level, two temporaries).
+ * @param plan Plan from strassen_plan_init() for n = plan->n.
+ * @param arena Arena with at least plan->arena elements; it is left empty on return.
+ * @param crossover Size at or below which blocked_mult() is used.
+ * @param bl Block size passed to blocked_mult().
+ * @param order Loop order passed to blocked_mult().
+ */
+void strassen_mult(const strassen_plan *plan, strassen_arena *arena, int crossover, int bl, int order,
+                   const TYPE *A, size_t lda, const TYPE *B, size_t ldb, TYPE *C, size_t ldc);
+
+#endif /* STRASSEN_H */
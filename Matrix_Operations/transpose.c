@@ -0,0 +1,64 @@
+/**
+ * @file transpose.c
+ * @brief Implementation of the blocked transposes and their benchmark.
+ */
+
+#include "transpose.h"
+#include "simd_kernels.h"
+#include <string.h>
+
+static inline int min(int a, int b) {
+    return (a < b) ? a : b;
+}
+
+/**
+ * @brief Block transpose for element types without a SIMD tile kernel.
+ */
+static void tr_generic(TYPE *dst, size_t ldd, const TYPE *src, size_t lds, int rows, int cols) {
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            dst[j * ldd + i] = src[i * lds + j];
+        }
+    }
+}
+
+/** @brief Block transpose for TYPE. */
+#define TRANSPOSE_TILE _Generic((TYPE)0, float: simd.tr_f32, double: simd.tr_f64, default: tr_generic)
+
+void transpose_naive(int rows, int cols, const TYPE *src, size_t lds, TYPE *dst, size_t ldd) {
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            dst[j * ldd + i] = src[i * lds + j];
+        }
+    }
+}
+
+void transpose(int rows, int cols, const TYPE *src, size_t lds, TYPE *dst, size_t ldd) {
+    for (int ii = 0; ii < rows; ii += TRANSPOSE_BL) {
+        for (int jj = 0; jj < cols; jj += TRANSPOSE_BL) {
+            TRANSPOSE_TILE(dst + jj * ldd + ii, ldd, src + ii * lds + jj, lds,
+                           min(TRANSPOSE_BL, rows - ii), min(TRANSPOSE_BL, cols - jj));
+        }
+    }
+}
+
+void transpose_inplace(int n, TYPE *A, size_t lda) {
+    TYPE tmp[TRANSPOSE_BL * TRANSPOSE_BL] __attribute__((aligned(MATRIX_ALIGN)));
+
+    for (int ii = 0; ii < n; ii += TRANSPOSE_BL) {
+        const int bi = min(TRANSPOSE_BL, n - ii);
+        for (int jj = ii; jj < n; jj += TRANSPOSE_BL) {
+            const int bj = min(TRANSPOSE_BL, n - jj);
+            TYPE *Aij = A + ii * lda + jj, *Aji = A + jj * lda + ii;
+
+            /* tmp (bj x bi) = Aij^T, Aij = Aji^T, Aji = tmp; a diagonal block only goes through tmp. */
+            TRANSPOSE_TILE(tmp, bi, Aij, lda, bi, bj);
+            if (ii != jj) {
+                TRANSPOSE_TILE(Aij, lda, Aji, lda, bj, bi);
+            }
+            for (int r = 0; r < bj; r++) {
+                memcpy(Aji + r * lda, tmp + r * bi, (size_t)bi * sizeof(TYPE));
+            }
+        }
+    }
+}
@@ -0,0 +1,36 @@
+/**
+ * @file transpose.h
+ * @brief Cache-blocked out-of-place and in-place matrix transposes built on the SIMD tile transposes.
+ */
+
+#ifndef TRANSPOSE_H
+#define TRANSPOSE_H
+
+#include "matrix_ops.h"
+
+#ifndef TRANSPOSE_BL
+#define TRANSPOSE_BL 32 /**< Cache block edge; a source and a destination block stay in L1 */
+#endif
+
+/**
+ * @brief Element-by-element dst = src^T (reads rows, writes columns); the baseline of transpose().
+ */
+void transpose_naive(int rows, int cols, const TYPE *src, size_t lds, TYPE *dst, size_t ldd);
+
+/**
+ * @brief dst = src^T for a rows x cols source with row stride lds (dst has cols rows of stride ldd).
+ *
+ * The matrices are walked in TRANSPOSE_BL x TRANSPOSE_BL blocks, and each block is
+ * transposed with the selected simd.tr_f32/tr_f64 (scalar for other element types).
+ * src and dst must not overlap.
+ */
+void transpose(int rows, int cols, const TYPE *src, size_t lds, TYPE *dst, size_t ldd);
+
+/**
+ * @brief A = A^T for an n x n matrix with row stride lda.
+ *
+ * Each pair of mirrored blocks is swapped through one block-sized stack buffer.
+ */
+void transpose_inplace(int n, TYPE *A, size_t lda);
+
+#endif /* TRANSPOSE_H */
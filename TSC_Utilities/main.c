@@ -3,12 +3,16 @@
  * @brief Main program to evaluate TSC performance.
  * @details Compile with 'gcc -O3 -o tsc_test.elf main.c tsc.c -lm'.
  * Run with 'taskset -c N ./tsc_test.elf' with N being the core number.
- * The program will output the mean, minimum, and maximum elapsed CPU cycles. Use the minimum value for the overhead adjustment (TSCCYCLES) in tsc.h.
+ * The program calibrates the TSC on that core (overhead, invariant/constant flags, frequency),
+ * then outputs the mean, minimum, and maximum elapsed CPU cycles left after subtracting the
+ * measured overhead, which should be close to zero.
  */
 
 #include "tsc.h"
 
 int main() {
+    calibrate_tsc();
+    print_tsc_calibration(stdout);
     eval_tsc_cycles();
     return 0;
 }
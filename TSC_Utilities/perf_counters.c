@@ -0,0 +1,156 @@
+/**
+ * @file perf_counters.c
+ * @brief Implementation of the perf_event_open counter group.
+ */
+
+#include "perf_counters.h"
+#include <linux/perf_event.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define HW_CACHE(cache, op, result) \
+    (PERF_COUNT_HW_CACHE_##cache | (PERF_COUNT_HW_CACHE_OP_##op << 8) | (PERF_COUNT_HW_CACHE_RESULT_##result << 16))
+
+static const struct {
+    unsigned int type;
+    unsigned long long config;
+    const char *name;
+} events[PC_EVENTS] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instructions" },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles" },
+    { PERF_TYPE_HW_CACHE, HW_CACHE(L1D, READ, MISS), "l1d_miss" },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, "llc_miss" },
+    { PERF_TYPE_HW_CACHE, HW_CACHE(DTLB, READ, MISS), "dtlb_miss" },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, "branch_miss" },
+};
+
+const char *perf_event_name(int id) {
+    return id >= 0 && id < PC_EVENTS ? events[id].name : "?";
+}
+
+static int open_event(int id, int group_fd) {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = events[id].type;
+    attr.config = events[id].config;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+/**
+ * @brief Opens every supported event, either as members of the first one or each on its own.
+ */
+static void open_events(perf_group *g, int grouped) {
+    int leader = -1;
+
+    g->grouped = grouped;
+    g->available = 0;
+    for (int i = 0; i < PC_EVENTS; i++) {
+        g->fd[i] = open_event(i, grouped && leader >= 0 ? g->fd[leader] : -1);
+        if (g->fd[i] < 0) {
+            g->leader[i] = -1;
+            continue;
+        }
+        if (!grouped || leader < 0) {
+            leader = i;
+        }
+        g->leader[i] = leader;
+        g->available++;
+    }
+}
+
+/**
+ * @brief Whether every opened event counts during about a millisecond of user work.
+ */
+static int all_scheduled(const perf_group *g) {
+    perf_sample a, b;
+    volatile double x = 0.0;
+
+    perf_group_read(g, &a);
+    for (int i = 0; i < 1000000; i++) {
+        x += i;
+    }
+    perf_group_read(g, &b);
+    for (int i = 0; i < PC_EVENTS; i++) {
+        if (g->fd[i] >= 0 && !(b.running[i] > a.running[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int perf_group_open(perf_group *g) {
+    open_events(g, 1);
+    if (g->available > 1 && !all_scheduled(g)) {
+        perf_group_close(g);
+        open_events(g, 0);
+    }
+    return g->available;
+}
+
+void perf_group_close(perf_group *g) {
+    for (int i = 0; i < PC_EVENTS; i++) {
+        if (g->fd[i] >= 0) {
+            close(g->fd[i]);
+            g->fd[i] = -1;
+        }
+    }
+    g->available = 0;
+}
+
+void perf_group_read(const perf_group *g, perf_sample *s) {
+    uint64_t buf[3 + PC_EVENTS]; /* nr, time_enabled, time_running, values[nr] */
+
+    for (int i = 0; i < PC_EVENTS; i++) {
+        s->value[i] = NAN;
+        s->enabled[i] = s->running[i] = 0.0;
+    }
+    for (int i = 0; i < PC_EVENTS; i++) {
+        if (g->fd[i] < 0 || g->leader[i] != i) {
+            continue;
+        }
+        ssize_t got = read(g->fd[i], buf, sizeof(buf));
+        uint64_t slot = 0;
+        for (int j = i; j < PC_EVENTS; j++) {
+            if (g->fd[j] < 0 || g->leader[j] != i) {
+                continue;
+            }
+            if (got >= (ssize_t)((4 + slot) * sizeof(uint64_t)) && slot < buf[0]) {
+                s->value[j] = (double)buf[3 + slot];
+                s->enabled[j] = (double)buf[1];
+                s->running[j] = (double)buf[2];
+            }
+            slot++;
+        }
+    }
+}
+
+double perf_group_delta(const perf_group *g, const perf_sample *start, const perf_sample *stop,
+                        double count[PC_EVENTS]) {
+    double coverage = 1.0;
+
+    for (int i = 0; i < PC_EVENTS; i++) {
+        count[i] = NAN;
+        if (g->fd[i] < 0) {
+            continue;
+        }
+        double enabled = stop->enabled[i] - start->enabled[i];
+        double running = stop->running[i] - start->running[i];
+        if (!(running > 0.0) || isnan(stop->value[i]) || isnan(start->value[i])) {
+            coverage = 0.0;
+            continue;
+        }
+        count[i] = (stop->value[i] - start->value[i]) * (enabled / running);
+        if (running / enabled < coverage) {
+            coverage = running / enabled;
+        }
+    }
+    return coverage;
+}
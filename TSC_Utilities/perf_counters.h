@@ -0,0 +1,82 @@
+/**
+ * @file perf_counters.h
+ * @brief Hardware performance counters (perf_event_open) read around the same regions as the TSC timers.
+ *
+ * The events are opened as one group so that they count exactly the same instructions. When the
+ * PMU cannot schedule the whole group at once (too few programmable counters, or counters taken
+ * by the NMI watchdog or another perf user), every event is reopened as its own group and the
+ * kernel multiplexes them: each delta is then scaled by time_enabled / time_running of its event.
+ * Only user-space events of the calling thread are counted, so perf_event_paranoid <= 2 suffices.
+ */
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+/**
+ * @brief Events read by a perf_group.
+ */
+typedef enum {
+    PC_INSTRUCTIONS = 0, /**< Retired instructions */
+    PC_CYCLES,           /**< Core cycles (not TSC cycles: they follow the actual frequency) */
+    PC_L1D_MISSES,       /**< L1 data cache read misses */
+    PC_LLC_MISSES,       /**< Last-level cache misses */
+    PC_DTLB_MISSES,      /**< Data TLB read misses */
+    PC_BRANCH_MISSES,    /**< Mispredicted branches */
+    PC_EVENTS            /**< Number of events */
+} perf_event_id;
+
+/**
+ * @brief Open counters of the calling thread.
+ */
+typedef struct {
+    int fd[PC_EVENTS];     /**< Descriptor of each event, -1 if not supported */
+    int leader[PC_EVENTS]; /**< Event whose descriptor reads the group of each event */
+    int grouped;           /**< 1 if all events form one group, 0 if multiplexed one by one */
+    int available;         /**< Events opened */
+} perf_group;
+
+/**
+ * @brief Cumulative counts and group times at one point (see perf_group_read()).
+ */
+typedef struct {
+    double value[PC_EVENTS];   /**< Raw counts */
+    double enabled[PC_EVENTS]; /**< time_enabled of the event's group, in ns */
+    double running[PC_EVENTS]; /**< time_running of the event's group, in ns */
+} perf_sample;
+
+/**
+ * @brief Opens and starts the counters on the calling thread.
+ *
+ * Events the PMU does not support are skipped. On failure errno is left as set by the
+ * last perf_event_open() (EACCES: perf_event_paranoid too high, ENOENT: no hardware PMU).
+ * @return The number of events opened; 0 if none (nothing to close).
+ */
+int perf_group_open(perf_group *g);
+
+/**
+ * @brief Closes the counters.
+ */
+void perf_group_close(perf_group *g);
+
+/**
+ * @brief Reads the counters: one read() per group (one in total unless multiplexed).
+ *
+ * Call it just outside start_timer()/stop_timer() so that the system calls are not timed.
+ */
+void perf_group_read(const perf_group *g, perf_sample *s);
+
+/**
+ * @brief Counts between two samples, each scaled by its event's time_enabled / time_running.
+ * @param count Scaled counts; NAN for the events that are unsupported or were never scheduled.
+ * @return The smallest fraction of the interval during which an opened event was counting
+ *         (1 when the group was scheduled throughout).
+ */
+double perf_group_delta(const perf_group *g, const perf_sample *start, const perf_sample *stop,
+                        double count[PC_EVENTS]);
+
+/**
+ * @brief Short name of an event ("instructions", "l1d_miss", ...).
+ */
+const char *perf_event_name(int id);
+
+#endif /* PERF_COUNTERS_H */
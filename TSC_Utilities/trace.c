@@ -0,0 +1,148 @@
+/**
+ * @file trace.c
+ * @brief Implementation of the trace rings and of their trace_event JSON export.
+ */
+
+#include "trace.h"
+#include "tsc.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+__thread trace_ring *trace_self;
+__thread int trace_no_ring;
+int trace_enabled;
+
+static trace_ring *rings;
+static int nrings;
+static atomic_int next_ring;   /* Rings ever claimed (high-water mark) */
+static atomic_int *ring_busy;  /* [nrings] 0 once released; never-claimed rings count as busy */
+static const char *trace_path;
+
+static void flush_at_exit(void) {
+    trace_flush();
+}
+
+int trace_init(const char *path, int max_threads) {
+    if (max_threads <= 0 || rings) {
+        return -1;
+    }
+    rings = calloc((size_t)max_threads, sizeof(trace_ring));
+    ring_busy = calloc((size_t)max_threads, sizeof(atomic_int));
+    if (!rings || !ring_busy) {
+        free(rings);
+        free(ring_busy);
+        rings = NULL;
+        ring_busy = NULL;
+        return -1;
+    }
+    for (int t = 0; t < max_threads; t++) {
+        rings[t].tid = t;
+        atomic_init(&ring_busy[t], 1);
+        rings[t].records = calloc(TRACE_CAPACITY, sizeof(trace_record));
+        if (!rings[t].records) {
+            for (int u = 0; u < t; u++) {
+                free(rings[u].records);
+            }
+            free(rings);
+            free(ring_busy);
+            rings = NULL;
+            ring_busy = NULL;
+            return -1;
+        }
+    }
+    nrings = max_threads;
+    atomic_init(&next_ring, 0);
+    trace_path = path;
+    trace_enabled = 1;
+    atexit(flush_at_exit);
+    return 0;
+}
+
+trace_ring *trace_attach(void) {
+    if (!trace_enabled) {
+        return NULL;
+    }
+    /* First a ring released by an exited thread, then a fresh one. */
+    int used = atomic_load(&next_ring);
+    for (int t = 0; t < used && t < nrings; t++) {
+        int free_ring = 0;
+        if (atomic_compare_exchange_strong(&ring_busy[t], &free_ring, 1)) {
+            trace_self = &rings[t];
+            return trace_self;
+        }
+    }
+    int t = atomic_fetch_add(&next_ring, 1);
+    if (t >= nrings) {
+        trace_no_ring = 1;
+        return NULL;
+    }
+    trace_self = &rings[t];
+    return trace_self;
+}
+
+void trace_detach(void) {
+    if (trace_self) {
+        atomic_store(&ring_busy[trace_self->tid], 0);
+        trace_self = NULL;
+    }
+}
+
+int trace_flush(void) {
+    if (!rings || !trace_enabled) {
+        return -1;
+    }
+    trace_enabled = 0;
+    if (!tsc_cal.calibrated) {
+        calibrate_tsc();
+    }
+
+    int used = atomic_load(&next_ring);
+    if (used > nrings) {
+        used = nrings;
+    }
+    /* Time origin: the oldest record still in any ring. */
+    unsigned long long origin = ~0ULL;
+    for (int t = 0; t < used; t++) {
+        trace_ring *r = &rings[t];
+        if (r->head > 0) {
+            unsigned long long first = r->head > TRACE_CAPACITY ? r->head - TRACE_CAPACITY : 0;
+            unsigned long long tsc = r->records[first & (TRACE_CAPACITY - 1)].tsc;
+            if (tsc < origin) origin = tsc;
+        }
+    }
+
+    FILE *f = fopen(trace_path, "w");
+    if (!f) {
+        fprintf(stderr, "Cannot write trace file %s\n", trace_path);
+        return -1;
+    }
+    const double us_per_tick = tsc_cal.hz > 0.0 ? 1e6 / tsc_cal.hz : 1.0;
+    int records = 0;
+    fprintf(f, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+    for (int t = 0; t < used; t++) {
+        trace_ring *r = &rings[t];
+        unsigned long long first = r->head > TRACE_CAPACITY ? r->head - TRACE_CAPACITY : 0;
+        int depth = 0;
+        fprintf(f, "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+                   "\"args\": {\"name\": \"thread %d\"}}", records++ ? "," : "", t, t);
+        for (unsigned long long i = first; i < r->head; i++) {
+            const trace_record *e = &r->records[i & (TRACE_CAPACITY - 1)];
+            /* Ends whose begin was overwritten would close unrelated scopes. */
+            if (e->phase == 'E' && depth == 0) {
+                continue;
+            }
+            depth += e->phase == 'B' ? 1 : -1;
+            fprintf(f, ",\n{\"name\": \"%s\", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d, "
+                       "\"args\": {\"cpu\": %u}}",
+                    e->name, (char)e->phase, (double)(e->tsc - origin) * us_per_tick, t, e->cpu);
+            records++;
+        }
+    }
+    fprintf(f, "\n]}\n");
+    if (fclose(f) != 0) {
+        fprintf(stderr, "Cannot write trace file %s\n", trace_path);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+/**
+ * @file trace.h
+ * @brief Per-thread TSC trace ring buffers for scoped phases, exported as Chrome/Perfetto trace_event JSON.
+ *
+ * trace_begin()/trace_end() write one fixed-size record into the calling thread's ring:
+ * no lock, no allocation and one rdtscp. Rings are allocated by trace_init() and claimed
+ * by each thread on its first event; when a ring is full the oldest records are overwritten.
+ * A thread that exits calls trace_detach() so a later thread reuses its ring (and its trace
+ * thread id); a thread that found every ring taken stops trying.
+ * Rings stay allocated until the process exits, so threads still running after trace_flush()
+ * keep writing harmlessly into them.
+ * Scope names must have static storage duration (string literals): only the pointer is kept.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <x86intrin.h>
+
+#ifndef TRACE_CAPACITY
+#define TRACE_CAPACITY 65536 /**< Records per thread (power of two) */
+#endif
+
+/**
+ * @brief One begin ('B') or end ('E') record.
+ */
+typedef struct {
+    unsigned long long tsc; /**< rdtscp value */
+    const char *name;       /**< Scope name */
+    uint32_t cpu;           /**< CPU reported by rdtscp (IA32_TSC_AUX) */
+    uint32_t phase;         /**< 'B' or 'E' */
+} trace_record;
+
+/**
+ * @brief Ring buffer of one thread.
+ */
+typedef struct {
+    unsigned long long head; /**< Records written so far (the ring keeps the last TRACE_CAPACITY) */
+    int tid;                 /**< Index of the ring, used as the trace thread id */
+    trace_record *records;
+} trace_ring;
+
+extern __thread trace_ring *trace_self; /**< Ring of the calling thread, NULL until its first event */
+extern __thread int trace_no_ring;      /**< 1 once trace_attach() failed for the calling thread */
+extern int trace_enabled;               /**< 1 between trace_init() and trace_flush() */
+
+/**
+ * @brief Allocates @p max_threads rings and writes @p path at exit (or at trace_flush()).
+ * @return 0 on success, -1 on allocation failure (tracing stays disabled).
+ */
+int trace_init(const char *path, int max_threads);
+
+/**
+ * @brief Claims a ring for the calling thread (called by the first event of each thread).
+ * @return The ring, or NULL if tracing is disabled or all rings are taken.
+ */
+trace_ring *trace_attach(void);
+
+/**
+ * @brief Gives the calling thread's ring back for reuse by a later thread (call before it exits).
+ *
+ * The records stay in the ring and are exported by trace_flush().
+ */
+void trace_detach(void);
+
+/**
+ * @brief Writes the trace file and disables tracing (idempotent; also run at exit).
+ *
+ * Timestamps are in microseconds from the oldest retained record, converted with the
+ * calibrated TSC frequency (calibrate_tsc() is run first if needed).
+ *
+ * @return 0 on success, -1 if tracing is not active or the file cannot be written.
+ */
+int trace_flush(void);
+
+static inline void trace_event(const char *name, uint32_t phase) {
+    trace_ring *r = trace_self;
+    if (!r) {
+        if (!trace_enabled || trace_no_ring || !(r = trace_attach())) {
+            return;
+        }
+    }
+    unsigned int cpu;
+    trace_record *e = &r->records[r->head & (TRACE_CAPACITY - 1)];
+    e->tsc = __rdtscp(&cpu);
+    e->name = name;
+    e->cpu = cpu & 0xfff;
+    e->phase = phase;
+    r->head++;
+}
+
+/**
+ * @brief Opens scope @p name on the calling thread.
+ */
+static inline void trace_begin(const char *name) {
+    trace_event(name, 'B');
+}
+
+/**
+ * @brief Closes scope @p name on the calling thread.
+ */
+static inline void trace_end(const char *name) {
+    trace_event(name, 'E');
+}
+
+#endif /* TRACE_H */
@@ -3,16 +3,23 @@
  * @brief Implementation of TSC performance measurement functions.
  */
 
+#define _GNU_SOURCE
 #include "tsc.h"
+#include <cpuid.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
+#include <time.h>
 
 /**
  * @brief Number of iterations for performance evaluation.
  */
 #define SIZE 100000
 
+tsc_calibration tsc_cal = { 0, -1, TSCCYCLES, TSCCYCLES, TSCCYCLES, 0, 0, 0.0 };
+
 unsigned long long start_timer() {
     unsigned int hi = 0, lo = 0;
     asm volatile("cpuid\n\trdtscp\n\tmov %%edx, %0\n\tmov %%eax, %1\n"
@@ -30,7 +37,7 @@ unsigned long long stop_timer() {
 }
 
 double dtime(long long start, long long end) {
-    return (double)(end - start - TSCCYCLES);
+    return (double)(end - start) - tsc_cal.overhead;
 }
 
 int cmp(const void *x, const void *y) {
@@ -43,9 +50,9 @@ double tmean(double ar[], int n) {
     double q1 = ar[n / 4], q2 = ar[n / 2], q3 = ar[3 * n / 4];
     double sum = 0.0, k = 1.0;
     int i = 0;
-    while (ar[i++] < q2 - k * (q3 - q1));
+    while (i < n && ar[i] < q2 - k * (q3 - q1)) i++;
     int j = i;
-    while (ar[j] < q2 + k * (q3 - q1) && j < n) {
+    while (j < n && ar[j] <= q2 + k * (q3 - q1)) {
         sum += ar[j++];
     }
     return sum / (double)(j - i);
@@ -72,3 +79,98 @@ void eval_tsc_cycles() {
 
     printf("Average: %f\tMin: %f\tMax: %f\tVariance: %f\tTrimmed Avg: %f\n", avg, tmin, tmax, var, ttavg);
 }
+
+/**
+ * @brief Whether /proc/cpuinfo lists @p flag for the first CPU.
+ */
+static int cpuinfo_flag(const char *flag) {
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if (!f) {
+        return 0;
+    }
+    char line[4096];
+    int found = 0;
+    size_t len = strlen(flag);
+    while (!found && fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "flags", 5) != 0) {
+            continue;
+        }
+        for (char *p = strstr(line, flag); p; p = strstr(p + 1, flag)) {
+            if (p[-1] == ' ' && (p[len] == ' ' || p[len] == '\n')) {
+                found = 1;
+                break;
+            }
+        }
+        break;
+    }
+    fclose(f);
+    return found;
+}
+
+static double monotonic_raw_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * @brief TSC ticks per second over one TSC_CAL_MS interval.
+ *
+ * Each end point reads the TSC between two clock reads and uses their midpoint.
+ */
+static double measure_hz(void) {
+    double a0 = monotonic_raw_ns();
+    unsigned long long c0 = __rdtsc();
+    double b0 = monotonic_raw_ns();
+    struct timespec pause = { 0, TSC_CAL_MS * 1000000L };
+    nanosleep(&pause, NULL);
+    double a1 = monotonic_raw_ns();
+    unsigned long long c1 = __rdtsc();
+    double b1 = monotonic_raw_ns();
+    return (double)(c1 - c0) * 1e9 / (0.5 * (a1 + b1) - 0.5 * (a0 + b0));
+}
+
+void calibrate_tsc(void) {
+    double *samples = malloc(TSC_CAL_SAMPLES * sizeof(double));
+    double hz[5];
+    unsigned int eax, ebx, ecx, edx;
+
+    tsc_cal.cpu = sched_getcpu();
+    if (samples) {
+        for (int i = 0; i < 1000; i++) {
+            start_timer();
+            stop_timer();
+        }
+        double tmin = 1e30;
+        for (int i = 0; i < TSC_CAL_SAMPLES; i++) {
+            long long start = start_timer();
+            long long end = stop_timer();
+            samples[i] = (double)(end - start);
+            if (samples[i] < tmin) tmin = samples[i];
+        }
+        tsc_cal.overhead_min = tmin;
+        tsc_cal.overhead_tmean = tmean(samples, TSC_CAL_SAMPLES);
+        tsc_cal.overhead = tmin;
+        free(samples);
+    }
+
+    tsc_cal.invariant = __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) && (edx & (1u << 8));
+    tsc_cal.constant = cpuinfo_flag("constant_tsc");
+
+    for (int i = 0; i < 5; i++) {
+        hz[i] = measure_hz();
+    }
+    qsort(hz, 5, sizeof(double), cmp);
+    tsc_cal.hz = hz[2];
+    tsc_cal.calibrated = 1;
+}
+
+double cycles_to_ns(double cycles) {
+    return tsc_cal.hz > 0.0 ? cycles * 1e9 / tsc_cal.hz : 0.0;
+}
+
+void print_tsc_calibration(FILE *out) {
+    fprintf(out, "TSC_CALIBRATION\tcpu=%d\toverhead_min=%.0f\toverhead_tmean=%.1f\tGHz=%.4f\tinvariant=%s\tconstant=%s\n",
+            tsc_cal.cpu, tsc_cal.overhead_min, tsc_cal.overhead_tmean, tsc_cal.hz * 1e-9,
+            tsc_cal.invariant ? "yes" : "no", tsc_cal.constant ? "yes" : "no");
+}
@@ -6,13 +6,41 @@
 #ifndef TSC_H
 #define TSC_H
 
+#include <stdio.h>
 #include <x86intrin.h>
 
 /**
- * @brief Define adjustment for RDTSC measurement overhead.
+ * @brief RDTSC measurement overhead assumed by dtime() until calibrate_tsc() has measured it.
  */
 #define TSCCYCLES 13.0
 
+#ifndef TSC_CAL_SAMPLES
+#define TSC_CAL_SAMPLES 20000 /**< start_timer()/stop_timer() pairs timed by calibrate_tsc() */
+#endif
+
+#ifndef TSC_CAL_MS
+#define TSC_CAL_MS 20 /**< Length in ms of each of the five TSC frequency measurements */
+#endif
+
+/**
+ * @brief Result of calibrate_tsc().
+ */
+typedef struct {
+    int calibrated;        /**< 1 once calibrate_tsc() has run */
+    int cpu;               /**< CPU the calibration ran on (-1 if unknown) */
+    double overhead;       /**< Cycles subtracted by dtime() (overhead_min once calibrated) */
+    double overhead_min;   /**< Smallest back-to-back start_timer()/stop_timer() difference */
+    double overhead_tmean; /**< Trimmed mean of the same differences */
+    int invariant;         /**< CPUID 0x80000007 EDX[8]: the TSC ticks at a constant rate in all P/C-states */
+    int constant;          /**< Linux "constant_tsc" flag: constant rate across P-states */
+    double hz;             /**< TSC frequency measured against CLOCK_MONOTONIC_RAW */
+} tsc_calibration;
+
+/**
+ * @brief Current calibration (TSCCYCLES overhead and no frequency until calibrate_tsc()).
+ */
+extern tsc_calibration tsc_cal;
+
 #ifdef __i386__
     #define RDTSC_DIRTY "%eax", "%ebx", "%ecx", "%edx"
 #elif __x86_64__
@@ -41,6 +69,32 @@ unsigned long long stop_timer();
  */
 double dtime(long long start, long long end);
 
+/**
+ * @brief Trimmed mean: the mean of the samples within one interquartile range of the median.
+ * @param ar Samples; sorted in place.
+ * @param n Number of samples (> 0).
+ * @return The trimmed mean.
+ */
+double tmean(double ar[], int n);
+
+/**
+ * @brief Measures the timer overhead on the current CPU, checks the TSC flags and measures its frequency.
+ *
+ * Run it pinned to the CPU that will be measured (taskset), before any timing. From then on,
+ * dtime() subtracts the measured minimum overhead instead of TSCCYCLES.
+ */
+void calibrate_tsc(void);
+
+/**
+ * @brief Converts cycles to nanoseconds with the measured TSC frequency (0 if not calibrated).
+ */
+double cycles_to_ns(double cycles);
+
+/**
+ * @brief Prints the calibration on one line ("TSC_CALIBRATION\t...").
+ */
+void print_tsc_calibration(FILE *out);
+
 /**
  * @brief Evaluates the overhead of TSC measurement.
  */